@@ -0,0 +1,210 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+#include <telling/histogram.h>
+#include <telling/alloc_tracking.h>
+#include <telling/msg_writer.h>
+#include <telling/msg_view.h>
+
+
+/*
+	Benchmark suite.
+		Each scenario runs one or more configurations and adds a Result per run.
+		Results are printed as they finish and may be written as JSON for regression tracking.
+*/
+namespace telling_bench
+{
+	using namespace telling;
+
+	using Clock = LatencyHistogram::Clock;
+
+
+	/*
+		Command-line options shared by all scenarios.
+	*/
+	struct Options
+	{
+		unsigned    duration_ms = 1000;  // Measured time per run
+		unsigned    warmup_ms   = 200;   // Unmeasured time before each run
+		bool        quick       = false; // Fewer sizes and counts
+		std::string filter;              // Only runs whose names contain this
+		std::string jsonPath;            // Write results here as JSON
+		std::string httpsURL;            // HTTPS server for TLS scenarios; skipped if empty
+		uint16_t    tcpPort     = 27100; // First TCP port to use
+	};
+
+
+	/*
+		Result of one run.
+	*/
+	struct Result
+	{
+		std::string name;
+		std::vector<std::pair<std::string, std::string>> params;
+		std::vector<std::pair<std::string, double>>      metrics;
+
+		uint64_t messages    = 0; // Completed messages
+		uint64_t bytes       = 0; // Payload bytes in completed messages
+		uint64_t errors      = 0;
+		uint64_t allocations = 0; // operator new calls during the run
+
+		// With TELLING_ALLOC_TRACKING, allocations by pipeline stage.
+		uint64_t stageAllocations[AllocTracking::STAGE_COUNT] = {};
+		double   seconds     = 0;
+
+		// Latency in microseconds
+		uint64_t p50 = 0, p99 = 0, p999 = 0, mean = 0, max = 0;
+
+
+		void param (std::string key, std::string value)    {params.emplace_back(std::move(key), std::move(value));}
+		void param (std::string key, uint64_t    value)    {param(std::move(key), std::to_string(value));}
+		void metric(std::string key, double      value)    {metrics.emplace_back(std::move(key), value);}
+
+		void latency(const LatencyHistogram &h) noexcept
+		{
+			p50  = h.percentile(0.50);
+			p99  = h.percentile(0.99);
+			p999 = h.percentile(0.999);
+			mean = h.mean();
+			max  = h.max();
+		}
+
+		double msgsPerSec  () const noexcept    {return seconds > 0 ? double(messages) / seconds : 0;}
+		double mbPerSec    () const noexcept    {return seconds > 0 ? double(bytes) / seconds / 1048576.0 : 0;}
+		double allocsPerMsg() const noexcept    {return messages ? double(allocations) / double(messages) : 0;}
+
+		double allocsPerMsg(unsigned stage) const noexcept    {return messages ? double(stageAllocations[stage]) / double(messages) : 0;}
+	};
+
+
+	/*
+		Collects results, printing each as it is added.
+	*/
+	class Report
+	{
+	public:
+		const Options &options;
+
+	public:
+		explicit Report(const Options &_options)    : options(_options) {}
+
+		// Check a run name against the filter.
+		bool want(std::string_view name) const noexcept
+		{
+			return options.filter.empty() || name.find(options.filter) != std::string_view::npos;
+		}
+
+		void add(Result &&result);
+
+		void writeJSON(std::ostream &out) const;
+
+		const std::vector<Result> &results() const noexcept    {return _results;}
+
+		// Give each run its own TCP ports.
+		uint16_t nextPort() noexcept    {uint16_t p = _port; _port += 8; return p;}
+
+	private:
+		std::vector<Result> _results;
+		uint16_t            _port = options.tcpPort;
+	};
+
+
+	/*
+		Scenario registry.  Scenarios register themselves at static initialization.
+	*/
+	using ScenarioFn = void (*)(Report&);
+
+	struct Scenario
+	{
+		const char *name;
+		ScenarioFn  run;
+	};
+
+	std::vector<Scenario> &Scenarios();
+
+	struct RegisterScenario
+	{
+		RegisterScenario(const char *name, ScenarioFn run)    {Scenarios().push_back(Scenario{name, run});}
+	};
+
+
+	// Number of operator new calls in the process so far.  Allocations made by NNG are not counted.
+	uint64_t Allocations() noexcept;
+
+	// Resident set size of the process, or 0 where it can't be read.
+	uint64_t ResidentBytes() noexcept;
+
+
+	/*
+		Measures time and allocations over a run.
+	*/
+	class Meter
+	{
+	public:
+		Meter() noexcept    {start();}
+
+		void start() noexcept
+		{
+			for (unsigned i = 0; i < AllocTracking::STAGE_COUNT; ++i)
+				_stages[i] = AllocTracking::read(AllocTracking::STAGE(i)).allocations;
+			_allocs = Allocations();
+			_start  = Clock::now();
+		}
+		void stop(Result &result) const noexcept
+		{
+			result.seconds     = std::chrono::duration<double>(Clock::now() - _start).count();
+			result.allocations = Allocations() - _allocs;
+			for (unsigned i = 0; i < AllocTracking::STAGE_COUNT; ++i)
+				result.stageAllocations[i] = AllocTracking::read(AllocTracking::STAGE(i)).allocations - _stages[i];
+		}
+
+	private:
+		uint64_t          _allocs;
+		uint64_t          _stages[AllocTracking::STAGE_COUNT];
+		Clock::time_point _start;
+	};
+
+
+	/*
+		Message timestamps, for latency across threads and sockets.
+	*/
+	inline uint64_t Now_us() noexcept
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count());
+	}
+	inline void Stamp(MsgWriter &writer)
+	{
+		writer.writeHeader("Bench-Time", std::to_string(Now_us()));
+	}
+	inline uint64_t Stamped(const MsgView &msg) noexcept
+	{
+		for (auto &header : msg.headers()) if (header.is("Bench-Time")) return uint64_t(header.value_dec(0));
+		return 0;
+	}
+	inline void RecordSince(LatencyHistogram &h, uint64_t stamp) noexcept
+	{
+		if (stamp) {uint64_t now = Now_us(); h.record(now > stamp ? now - stamp : 0);}
+	}
+
+
+	// A payload of the given size.  Shared; don't modify.
+	const std::string &Payload(size_t size);
+
+	inline void WritePayload(MsgWriter &writer, size_t size)
+	{
+		const std::string &payload = Payload(size);
+		writer.writeBody().write(payload.data(), std::streamsize(payload.size()));
+	}
+
+
+	// Sizes and counts swept by the pattern scenarios.
+	std::vector<size_t> MessageSizes(const Options &options);
+}
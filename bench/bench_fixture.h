@@ -0,0 +1,376 @@
+#pragma once
+
+
+#include <thread>
+#include <memory>
+#include <future>
+
+#include <telling/server.h>
+#include <telling/service.h>
+#include <telling/service_reactor.h>
+#include <telling/client.h>
+
+#include "bench.h"
+
+
+namespace telling_bench
+{
+	/*
+		Reactor which echoes a payload back to requests and records pushed messages.
+	*/
+	class EchoReactor : public Reactor
+	{
+	public:
+		struct Sink
+		{
+			LatencyHistogram      latency; // One-way latency of pulled messages
+			std::atomic<uint64_t> count = 0, bytes = 0;
+		};
+
+		size_t   replySize;
+		unsigned work_us   = 0;     // Busy time per request
+		bool     blocking  = false; // Sleep for work_us rather than spin
+		Sink    &sink;
+
+	public:
+		EchoReactor(std::string_view uri, size_t _replySize, Sink &_sink,
+			Concurrency concurrency = Concurrency::SERIALIZED) :
+			Reactor(uri, concurrency), replySize(_replySize), sink(_sink) {}
+
+		Methods allowed(UriView) const noexcept override    {return MethodCode::GET;}
+
+		void async_get(Query query, Msg::Request &&request) override
+		{
+			_work();
+
+			uint64_t stamp = Stamped(request);
+
+			if (query.reply)
+			{
+				auto reply = WriteReply();
+				if (stamp) reply.writeHeader("Bench-Time", std::to_string(stamp));
+				WritePayload(reply, replySize);
+				query.reply(reply.release());
+			}
+			else
+			{
+				RecordSince(sink.latency, stamp);
+				sink.count.fetch_add(1, std::memory_order_relaxed);
+				sink.bytes.fetch_add(request.bodySize(), std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		void _work() const
+		{
+			if (!work_us) return;
+			if (blocking) {std::this_thread::sleep_for(std::chrono::microseconds(work_us)); return;}
+			auto until = Clock::now() + std::chrono::microseconds(work_us);
+			while (Clock::now() < until) {}
+		}
+	};
+
+
+	/*
+		A server reachable over one transport, with echo services at /bench/0, /bench/1...
+	*/
+	class Fixture
+	{
+	public:
+		enum TRANSPORT
+		{
+			INPROC,
+			IPC,
+			TCP,
+		};
+
+		static const char *Name(TRANSPORT t)
+		{
+			switch (t)
+			{
+			case INPROC: return "inproc";
+			case IPC:    return "ipc";
+			default:     return "tcp";
+			}
+		}
+
+		struct ServiceConfig
+		{
+			size_t                replySize     = 16;
+			unsigned              replyContexts = 1;
+			unsigned              work_us       = 0;
+			bool                  blocking      = false;
+			Reactor::Concurrency  concurrency   = Reactor::Concurrency::SERIALIZED;
+		};
+
+
+	public:
+		const std::string        serverID;
+		Server                   server;
+		const HostAddress::Base  address;
+
+		EchoReactor::Sink        sink;
+
+		std::vector<std::shared_ptr<ServiceHandler_Base>> handlers;
+		std::vector<std::unique_ptr<Service>>             services;
+
+
+	public:
+		Fixture(Report &report, TRANSPORT transport, std::ostream *log = nullptr) :
+			serverID(NewID()),
+			server(log, serverID, false),
+			address(MakeAddress(report, transport, serverID))
+		{
+			server.open(address);
+		}
+
+		Fixture(Report &report, TRANSPORT transport, unsigned count, const ServiceConfig &config) :
+			Fixture(report, transport)
+		{
+			for (unsigned i = 0; i < count; ++i) addService(uri(i), config);
+		}
+
+		~Fixture()
+		{
+			// Services close before the server.
+			services.clear();
+			handlers.clear();
+		}
+
+		static std::string uri(unsigned i)    {return "/bench/" + std::to_string(i);}
+
+		EchoReactor &addService(const std::string &uri, const ServiceConfig &config)
+		{
+			auto reactor = std::make_shared<EchoReactor>(uri, config.replySize, sink, config.concurrency);
+			reactor->work_us  = config.work_us;
+			reactor->blocking = config.blocking;
+
+			addService(uri, reactor, config.replyContexts);
+			return *reactor;
+		}
+		Service &addService(const std::string &uri, std::shared_ptr<ServiceHandler_Base> handler, unsigned replyContexts)
+		{
+			auto service = std::make_unique<Service>(uri, serverID);
+			service->initialize(handler, replyContexts);
+
+			handlers.push_back(std::move(handler));
+			services.push_back(std::move(service));
+			return *services.back();
+		}
+
+		/*
+			Add a replica of the service at routeURI.  Its own uri must be unique.
+		*/
+		EchoReactor &addReplica(const std::string &uri, const std::string &routeURI, const ServiceConfig &config)
+		{
+			auto reactor = std::make_shared<EchoReactor>(routeURI, config.replySize, sink, config.concurrency);
+			reactor->work_us  = config.work_us;
+			reactor->blocking = config.blocking;
+
+			auto service = std::make_unique<Service>(uri, "");
+			service->registerReplica(routeURI, serverID);
+			service->initialize(reactor, config.replyContexts);
+
+			handlers.push_back(reactor);
+			services.push_back(std::move(service));
+			return *reactor;
+		}
+
+		/*
+			Wait until a URI is routed to a service.  Returns false on timeout.
+		*/
+		bool waitRoutable(const std::string &uri, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+		{
+			Client_Box probe;
+			probe.dial(address);
+
+			auto until = Clock::now() + timeout;
+			while (Clock::now() < until)
+			{
+				try
+				{
+					auto reply = probe.request(WriteRequest(uri).release());
+					if (reply.wait_for(std::chrono::milliseconds(250)) == std::future_status::ready)
+					{
+						auto msg = reply.get();
+						if (MsgView::Reply(msg).status() != StatusCode::NotFound) return true;
+					}
+				}
+				catch (std::exception&)
+				{
+					// Not connected yet
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			return false;
+		}
+		bool waitRoutable()
+		{
+			for (unsigned i = 0; i < services.size(); ++i)
+				if (!waitRoutable(services[i]->uri)) return false;
+			return true;
+		}
+
+
+	private:
+		static std::string NewID()
+		{
+			static std::atomic<unsigned> counter = 0;
+			return "telling_bench_" + std::to_string(counter.fetch_add(1));
+		}
+		static HostAddress::Base MakeAddress(Report &report, TRANSPORT transport, const std::string &id)
+		{
+			switch (transport)
+			{
+			case INPROC: return HostAddress::Base::InProc(id + "/api");
+			case IPC:    return HostAddress::Base::IPC(id);
+			default:     return HostAddress::Base::TCP("127.0.0.1", report.nextPort());
+			}
+		}
+	};
+
+
+	/*
+		Shared state of a closed-loop run.
+	*/
+	struct LoopState
+	{
+		LatencyHistogram      latency;
+		std::atomic<uint64_t> count = 0, bytes = 0, errors = 0;
+		std::atomic<int64_t>  outstanding = 0;
+		std::atomic<bool>     measuring = false, running = true;
+
+		// Stop issuing and wait for messages in flight.
+		void drain(std::chrono::milliseconds timeout = std::chrono::seconds(5))
+		{
+			running = false;
+			auto until = Clock::now() + timeout;
+			while (outstanding.load() > 0 && Clock::now() < until)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	};
+
+
+	/*
+		Run the warmup and measured phases of a run.
+	*/
+	template<class Begin, class End>
+	void Measure(const Options &options, LoopState &state, Result &result, Begin &&begin, End &&end)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.warmup_ms));
+
+		begin();
+		state.measuring = true;
+		Meter meter;
+		std::this_thread::sleep_for(std::chrono::milliseconds(options.duration_ms));
+		state.measuring = false;
+		meter.stop(result);
+		end();
+	}
+	inline void Measure(const Options &options, LoopState &state, Result &result)
+	{
+		Measure(options, state, result, []{}, []{});
+	}
+
+
+	/*
+		Closed-loop requester: keeps `window` requests in flight while the state is running.
+			Error replies (4xx, 5xx) count as errors.
+	*/
+	class Requester
+	{
+	public:
+		Client      client;
+		std::string uri;
+		size_t      size;
+		LoopState  &state;
+
+		std::vector<std::pair<std::string, std::string>> headers; // Added to each request
+		bool                                             trace = false; // Add a Trace header
+		bool                                             expectError = false; // Error replies count as completed
+
+	public:
+		Requester(const HostAddress::Base &address, std::string _uri, size_t _size, LoopState &_state) :
+			uri(std::move(_uri)), size(_size), state(_state)
+		{
+			client.dial(address);
+		}
+
+		void start(unsigned window)    {for (unsigned i = 0; i < window; ++i) send();}
+
+		void send()
+		{
+			auto msg = WriteRequest(uri);
+			if (trace) msg.writeHeader_Trace();
+			for (auto &h : headers) msg.writeHeader(h.first, h.second);
+			Stamp(msg);
+			WritePayload(msg, size);
+
+			state.outstanding.fetch_add(1);
+			try
+			{
+				client.request(msg.release(), [this](AsyncError status, nng::msg &&reply)
+				{
+					_replied(status, std::move(reply));
+				});
+			}
+			catch (nng::exception&)
+			{
+				state.errors.fetch_add(1);
+				state.outstanding.fetch_sub(1);
+			}
+		}
+
+	private:
+		void _replied(AsyncError status, nng::msg &&reply)
+		{
+			if (state.measuring)
+			{
+				if (status == nng::error::success)
+				{
+					try
+					{
+						MsgView::Reply view(reply);
+						if (view.status().isError() && !expectError)
+						{
+							state.errors.fetch_add(1);
+						}
+						else
+						{
+							RecordSince(state.latency, Stamped(view));
+							state.count.fetch_add(1, std::memory_order_relaxed);
+							state.bytes.fetch_add(view.bodySize(), std::memory_order_relaxed);
+						}
+					}
+					catch (MsgException&)
+					{
+						state.errors.fetch_add(1);
+					}
+				}
+				else state.errors.fetch_add(1);
+			}
+
+			if (state.running) send();
+			state.outstanding.fetch_sub(1);
+		}
+	};
+
+	using Requesters = std::vector<std::unique_ptr<Requester>>;
+
+
+	/*
+		Run requesters through a measured phase and fill in the result.
+	*/
+	inline void RequestLoop(const Options &options, LoopState &state, Requesters &requesters, unsigned window, Result &result)
+	{
+		for (auto &r : requesters) r->start(window);
+
+		Measure(options, state, result, [&]{state.latency.reset();}, []{});
+		state.drain();
+
+		result.messages = state.count;
+		result.bytes    = state.bytes;
+		result.errors   = state.errors;
+		result.latency(state.latency);
+	}
+}
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <functional>
+
+#include <telling/http_client.h>
+
+#include "bench_fixture.h"
+
+
+using namespace telling_bench;
+
+
+/*
+	HTTP: the server's HTTP/1.1 gateway driven by HttpClient, with and without
+		connection pooling; streamed versus buffered large responses; TLS connection setup.
+*/
+namespace
+{
+	using ms = std::chrono::milliseconds;
+
+
+	/*
+		Closed loop of requests through one HttpClient.
+	*/
+	class HttpLoop
+	{
+	public:
+		HttpClient &client;
+		std::string uri, hostHeader;
+		LoopState  &state;
+
+	public:
+		HttpLoop(HttpClient &_client, std::string _uri, LoopState &_state) :
+			client(_client), uri(std::move(_uri)), hostHeader(_client.host->u_host), state(_state) {}
+
+		void start(unsigned window)    {for (unsigned i = 0; i < window; ++i) send();}
+
+		void send()
+		{
+			auto msg = HttpRequest(uri);
+			msg.writeHeader("Host", hostHeader);
+			Stamp(msg);
+
+			state.outstanding.fetch_add(1);
+			try
+			{
+				client.request(msg.release(), [this](AsyncError status, nng::msg &&reply)
+				{
+					_replied(status, std::move(reply));
+				});
+			}
+			catch (nng::exception&)
+			{
+				state.errors.fetch_add(1);
+				state.outstanding.fetch_sub(1);
+			}
+		}
+
+	private:
+		void _replied(AsyncError status, nng::msg &&reply)
+		{
+			if (state.measuring)
+			{
+				bool ok = false;
+				if (status == nng::error::success) try
+				{
+					MsgView::Reply view(reply);
+					ok = !view.status().isError();
+					if (ok)
+					{
+						RecordSince(state.latency, Stamped(view));
+						state.count.fetch_add(1, std::memory_order_relaxed);
+						state.bytes.fetch_add(view.bodySize(), std::memory_order_relaxed);
+					}
+				}
+				catch (MsgException&) {}
+				if (!ok) state.errors.fetch_add(1);
+			}
+
+			if (state.running) send();
+			state.outstanding.fetch_sub(1);
+		}
+	};
+
+
+	/*
+		A server with an HTTP gateway and one echo service.
+	*/
+	class HttpFixture : public Fixture
+	{
+	public:
+		const uint16_t    port;
+		const std::string url;
+
+	public:
+		HttpFixture(Report &report, size_t replySize) :
+			Fixture(report, INPROC),
+			port(report.nextPort()),
+			url("http://127.0.0.1:" + std::to_string(port))
+		{
+			ServiceConfig config;
+			config.replySize = replySize;
+			addService(uri(0), config);
+			if (!waitRoutable()) throw nng::exception(nng::error::timedout, "http (service not routable)");
+
+			server.openHttp("tcp://127.0.0.1:" + std::to_string(port));
+		}
+	};
+
+	// Wait until the gateway answers.
+	bool WaitHttp(HttpClient &client, const std::string &uri)
+	{
+		for (auto until = Clock::now() + std::chrono::seconds(5); Clock::now() < until; )
+		{
+			LoopState state;
+			state.running   = false;
+			state.measuring = true;
+			HttpLoop probe(client, uri, state);
+			probe.send();
+			while (state.outstanding.load() > 0) std::this_thread::sleep_for(ms(1));
+			if (state.count) return true;
+			std::this_thread::sleep_for(ms(10));
+		}
+		return false;
+	}
+
+
+	/*
+		Requests per second and latency by pool configuration.
+	*/
+	void RunPool(Report &report, const char *label, const HttpClient::PoolConfig &pool, unsigned window)
+	{
+		std::string name = std::string("http/") + label;
+		if (!report.want(name)) return;
+
+		HttpFixture fixture(report, 256);
+
+		HttpClient client(nng::url(fixture.url.c_str()));
+		client.configurePool(pool);
+		if (!WaitHttp(client, Fixture::uri(0))) throw nng::exception(nng::error::timedout, "http (gateway not reachable)");
+
+		LoopState state;
+		HttpLoop  loop(client, Fixture::uri(0), state);
+		loop.start(window);
+
+		Result result;
+		result.name = name;
+		result.param("max_connections", pool.maxConnections);
+		result.param("keep_alive",      pool.keepAlive ? "true" : "false");
+		result.param("window",          window);
+		Measure(report.options, state, result, [&]{state.latency.reset();}, []{});
+		state.drain();
+
+		result.messages = state.count;
+		result.bytes    = state.bytes;
+		result.errors   = state.errors;
+		result.latency(state.latency);
+		result.metric("open_connections", double(client.openConnections()));
+		report.add(std::move(result));
+	}
+
+	void Pooling(Report &report)
+	{
+		HttpClient::PoolConfig pool;
+
+		pool.maxConnections = 1;
+		RunPool(report, "pool/connections=1", pool, 16);
+
+		pool.maxConnections = 8;
+		RunPool(report, "pool/connections=8", pool, 16);
+
+		pool.keepAlive = false;
+		RunPool(report, "nopool/connections=8", pool, 16);
+	}
+
+
+	/*
+		Time to first byte and allocations for large responses, streamed or buffered.
+	*/
+	class StreamHandler : public HttpClient::Handler
+	{
+	public:
+		LoopState        &state;
+		LatencyHistogram  firstByte;
+		Clock::time_point sent;
+		uint64_t          bodyBytes = 0;
+		bool              streaming;
+
+		std::function<void()> next;
+
+	public:
+		StreamHandler(LoopState &_state, bool _streaming)    : state(_state), streaming(_streaming) {}
+
+		void async_response_head(HttpRequesting, const MsgView::Reply&) override
+		{
+			if (streaming && state.measuring) firstByte.recordSince(sent);
+		}
+		void async_response_body(HttpRequesting, nng::view segment) override
+		{
+			bodyBytes += segment.size();
+		}
+		void async_recv(HttpRequesting, nng::msg &&response) override
+		{
+			if (state.measuring)
+			{
+				if (!streaming)
+				{
+					firstByte.recordSince(sent);
+					bodyBytes += MsgView::Reply(response).bodySize();
+				}
+				state.latency.recordSince(sent);
+				state.count.fetch_add(1, std::memory_order_relaxed);
+				state.bytes.fetch_add(bodyBytes, std::memory_order_relaxed);
+			}
+			_done();
+		}
+		void async_error(HttpRequesting, AsyncError) override
+		{
+			state.errors.fetch_add(1);
+			_done();
+		}
+
+	private:
+		void _done()
+		{
+			if (state.running) next();
+			state.outstanding.fetch_sub(1);
+		}
+	};
+
+	void RunStream(Report &report, bool streaming)
+	{
+		std::string name = std::string("http/") + (streaming ? "stream" : "buffered") + "/size=1048576";
+		if (!report.want(name)) return;
+
+		HttpFixture fixture(report, 1 << 20);
+
+		LoopState state;
+		auto handler = std::make_shared<StreamHandler>(state, streaming);
+
+		HttpClient client(nng::url(fixture.url.c_str()), handler);
+		if (!WaitHttp(client, Fixture::uri(0))) throw nng::exception(nng::error::timedout, "http (gateway not reachable)");
+
+		std::string host = client.host->u_host;
+		handler->next = [&]
+		{
+			auto msg = HttpRequest(Fixture::uri(0));
+			msg.writeHeader("Host", host);
+			handler->sent      = Clock::now();
+			handler->bodyBytes = 0;
+			state.outstanding.fetch_add(1);
+			try
+			{
+				if (streaming) client.requestStreaming(msg.release());
+				else           client.request         (msg.release());
+			}
+			catch (nng::exception&)
+			{
+				state.errors.fetch_add(1);
+				state.outstanding.fetch_sub(1);
+			}
+		};
+		handler->next();
+
+		Result result;
+		result.name = name;
+		result.param("mode", streaming ? "stream" : "buffered");
+		result.param("size", 1 << 20);
+		Measure(report.options, state, result, [&]{state.latency.reset(); handler->firstByte.reset();}, []{});
+		state.drain();
+
+		result.messages = state.count;
+		result.bytes    = state.bytes;
+		result.errors   = state.errors;
+		result.latency(state.latency);
+		result.metric("ttfb_p50_us", double(handler->firstByte.percentile(0.50)));
+		result.metric("ttfb_p99_us", double(handler->firstByte.percentile(0.99)));
+		report.add(std::move(result));
+	}
+
+	void Streaming(Report &report)
+	{
+		RunStream(report, false);
+		RunStream(report, true);
+	}
+
+
+	/*
+		TLS connection setup against an external HTTPS server (--https).
+			Without pooling, each request pays for a TCP connection and a handshake.
+	*/
+	void RunTls(Report &report, bool pooled)
+	{
+		std::string name = std::string("tls/") + (pooled ? "pool" : "handshake");
+		if (!report.want(name)) return;
+
+		if (report.options.httpsURL.empty())
+		{
+			std::cout << name << ": skipped (use --https URL)" << std::endl;
+			return;
+		}
+
+		HttpClient client(nng::url(report.options.httpsURL.c_str()));
+		HttpClient::PoolConfig pool;
+		pool.maxConnections = 1;
+		pool.keepAlive      = pooled;
+		client.configurePool(pool);
+
+		std::string uri = client.host->u_requri;
+		if (uri.empty()) uri = "/";
+
+		LoopState state;
+		HttpLoop  loop(client, uri, state);
+		loop.start(1);
+
+		Result result;
+		result.name = name;
+		result.param("url",        report.options.httpsURL);
+		result.param("keep_alive", pooled ? "true" : "false");
+		Measure(report.options, state, result, [&]{state.latency.reset();}, []{});
+		state.drain();
+
+		result.messages = state.count;
+		result.bytes    = state.bytes;
+		result.errors   = state.errors;
+		result.latency(state.latency);
+		report.add(std::move(result));
+	}
+
+	void Tls(Report &report)
+	{
+		RunTls(report, false);
+		RunTls(report, true);
+	}
+
+
+	RegisterScenario registerPooling  ("http",   &Pooling);
+	RegisterScenario registerStreaming("stream", &Streaming);
+	RegisterScenario registerTls      ("tls",    &Tls);
+}
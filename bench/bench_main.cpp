@@ -0,0 +1,276 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <map>
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+
+#include "bench.h"
+
+#if defined(__linux__)
+	#include <unistd.h>
+#endif
+
+
+using namespace telling_bench;
+
+
+/*
+	Allocation counting.
+		Replaces the global operator new for this executable only,
+		unless the library does so itself (TELLING_ALLOC_TRACKING).
+*/
+#if TELLING_ALLOC_TRACKING
+
+uint64_t telling_bench::Allocations() noexcept
+{
+	return AllocTracking::total().allocations;
+}
+
+#else
+
+namespace
+{
+	std::atomic<uint64_t> allocationCount = 0;
+}
+
+void *operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept                 {std::free(p);}
+void operator delete(void *p, std::size_t) noexcept    {std::free(p);}
+
+uint64_t telling_bench::Allocations() noexcept
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+#endif
+
+
+uint64_t telling_bench::ResidentBytes() noexcept
+{
+#if defined(__linux__)
+	// Second field of statm is resident pages.
+	unsigned long long size = 0, resident = 0;
+	if (FILE *statm = std::fopen("/proc/self/statm", "r"))
+	{
+		if (std::fscanf(statm, "%llu %llu", &size, &resident) != 2) resident = 0;
+		std::fclose(statm);
+	}
+	return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+#else
+	return 0;
+#endif
+}
+
+
+std::vector<Scenario> &telling_bench::Scenarios()
+{
+	static std::vector<Scenario> scenarios;
+	return scenarios;
+}
+
+const std::string &telling_bench::Payload(size_t size)
+{
+	static std::mutex                    mtx;
+	static std::map<size_t, std::string> payloads;
+
+	std::lock_guard<std::mutex> g(mtx);
+	auto &payload = payloads[size];
+	if (payload.size() != size)
+	{
+		payload.resize(size);
+		for (size_t i = 0; i < size; ++i) payload[i] = char('a' + i % 26);
+	}
+	return payload;
+}
+
+std::vector<size_t> telling_bench::MessageSizes(const Options &options)
+{
+	if (options.quick) return {16, 4096, 1 << 20};
+	return {16, 256, 4096, 65536, 1 << 20};
+}
+
+
+void Report::add(Result &&result)
+{
+	std::cout
+		<< std::left  << std::setw(48) << result.name << std::right
+		<< std::setw(12) << uint64_t(result.msgsPerSec()) << " msg/s"
+		<< std::setw(10) << std::fixed << std::setprecision(1) << result.mbPerSec() << " MiB/s"
+		<< "  p50 "  << std::setw(7) << result.p50
+		<< "  p99 "  << std::setw(7) << result.p99
+		<< "  p999 " << std::setw(7) << result.p999 << " us"
+		<< std::setw(8) << std::setprecision(2) << result.allocsPerMsg() << " alloc/msg";
+	if (result.errors) std::cout << "  (" << result.errors << " errors)";
+	for (auto &m : result.metrics) std::cout << "  " << m.first << '=' << std::setprecision(2) << m.second;
+	std::cout << std::endl;
+
+	if (AllocTracking::Enabled)
+	{
+		std::cout << "    alloc/msg by stage:";
+		for (unsigned i = 0; i < AllocTracking::STAGE_COUNT; ++i)
+			std::cout << "  " << AllocTracking::StageName(AllocTracking::STAGE(i)) << ' ' << std::setprecision(2) << result.allocsPerMsg(i);
+		std::cout << std::endl;
+	}
+
+	_results.push_back(std::move(result));
+}
+
+namespace
+{
+	void WriteString(std::ostream &out, std::string_view s)
+	{
+		out << '"';
+		for (char c : s)
+		{
+			if      (c == '"' || c == '\\') out << '\\' << c;
+			else if (c == '\n')             out << "\\n";
+			else if (uint8_t(c) < 0x20)     out << ' ';
+			else                            out << c;
+		}
+		out << '"';
+	}
+}
+
+void Report::writeJSON(std::ostream &out) const
+{
+	out << std::setprecision(6) << std::defaultfloat;
+	out << "{\n\t\"suite\": \"telling_bench\",\n";
+	out << "\t\"duration_ms\": " << options.duration_ms << ",\n";
+	out << "\t\"results\": [";
+
+	for (size_t i = 0; i < _results.size(); ++i)
+	{
+		auto &r = _results[i];
+		out << (i ? ",\n" : "\n") << "\t\t{\"name\": ";
+		WriteString(out, r.name);
+
+		out << ", \"params\": {";
+		for (size_t j = 0; j < r.params.size(); ++j)
+		{
+			if (j) out << ", ";
+			WriteString(out, r.params[j].first);
+			out << ": ";
+			WriteString(out, r.params[j].second);
+		}
+		out << "}";
+
+		out << ", \"messages\": "       << r.messages
+			<< ", \"errors\": "         << r.errors
+			<< ", \"seconds\": "        << r.seconds
+			<< ", \"msgs_per_sec\": "   << r.msgsPerSec()
+			<< ", \"mib_per_sec\": "    << r.mbPerSec()
+			<< ", \"allocs_per_msg\": " << r.allocsPerMsg()
+			<< ", \"latency_us\": {\"p50\": " << r.p50 << ", \"p99\": " << r.p99 << ", \"p999\": " << r.p999
+			<< ", \"mean\": " << r.mean << ", \"max\": " << r.max << "}";
+
+		if (AllocTracking::Enabled)
+		{
+			out << ", \"allocs_per_msg_by_stage\": {";
+			for (unsigned j = 0; j < AllocTracking::STAGE_COUNT; ++j)
+			{
+				if (j) out << ", ";
+				WriteString(out, AllocTracking::StageName(AllocTracking::STAGE(j)));
+				out << ": " << r.allocsPerMsg(j);
+			}
+			out << "}";
+		}
+
+		out << ", \"metrics\": {";
+		for (size_t j = 0; j < r.metrics.size(); ++j)
+		{
+			if (j) out << ", ";
+			WriteString(out, r.metrics[j].first);
+			out << ": " << r.metrics[j].second;
+		}
+		out << "}}";
+	}
+	out << "\n\t]\n}\n";
+}
+
+
+namespace
+{
+	void Usage(const char *exe)
+	{
+		std::cout
+			<< "usage: " << exe << " [options]\n"
+			<< "  --list             list scenarios\n"
+			<< "  --filter TEXT      only runs whose names contain TEXT (eg. reqrep/tcp)\n"
+			<< "  --duration MS      measured time per run (default 1000)\n"
+			<< "  --warmup MS        unmeasured time before each run (default 200)\n"
+			<< "  --quick            fewer sizes and counts\n"
+			<< "  --json FILE        write results as JSON\n"
+			<< "  --https URL        HTTPS server for the TLS scenarios\n"
+			<< "  --port N           first TCP port to use (default 27100)\n";
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		auto value = [&]() -> const char*
+		{
+			if (i+1 >= argc) {std::cerr << "missing value for " << arg << std::endl; std::exit(2);}
+			return argv[++i];
+		};
+
+		if      (arg == "--filter")   options.filter      = value();
+		else if (arg == "--duration") options.duration_ms = unsigned(std::atoi(value()));
+		else if (arg == "--warmup")   options.warmup_ms   = unsigned(std::atoi(value()));
+		else if (arg == "--quick")    options.quick       = true;
+		else if (arg == "--json")     options.jsonPath    = value();
+		else if (arg == "--https")    options.httpsURL    = value();
+		else if (arg == "--port")     options.tcpPort     = uint16_t(std::atoi(value()));
+		else if (arg == "--list")
+		{
+			for (auto &s : Scenarios()) std::cout << s.name << std::endl;
+			return 0;
+		}
+		else
+		{
+			Usage(argv[0]);
+			return (arg == "--help" || arg == "-h") ? 0 : 2;
+		}
+	}
+
+	Report report(options);
+
+	for (auto &scenario : Scenarios())
+	{
+		try
+		{
+			scenario.run(report);
+		}
+		catch (std::exception &e)
+		{
+			std::cerr << scenario.name << ": failed (" << e.what() << ")" << std::endl;
+		}
+	}
+
+	if (options.jsonPath.size())
+	{
+		std::ofstream out(options.jsonPath);
+		if (!out)
+		{
+			std::cerr << "could not write " << options.jsonPath << std::endl;
+			return 1;
+		}
+		report.writeJSON(out);
+	}
+
+	return 0;
+}
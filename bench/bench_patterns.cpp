@@ -0,0 +1,321 @@
+#include <thread>
+
+#include "bench_fixture.h"
+
+
+using namespace telling_bench;
+
+
+/*
+	Request-reply, push-pull and publish-subscribe through a Server,
+		over each transport, across message sizes and client/service counts.
+*/
+namespace
+{
+	struct Config
+	{
+		Fixture::TRANSPORT transport;
+		size_t             size;
+		unsigned           clients, services;
+		unsigned           window; // Messages in flight per client
+	};
+
+	std::vector<Config> Configs(const Options &options)
+	{
+		std::vector<Config> configs;
+
+		for (auto transport : {Fixture::INPROC, Fixture::IPC, Fixture::TCP})
+		{
+			// Latency and bandwidth by message size
+			for (size_t size : MessageSizes(options))
+				configs.push_back({transport, size, 1, 1, 1});
+
+			// Scaling by clients and services
+			std::pair<unsigned, unsigned> counts[] = {{8,1}, {64,1}, {8,8}, {64,8}, {64,64}};
+			for (auto &c : counts)
+			{
+				if (options.quick && c.first != c.second) continue;
+				configs.push_back({transport, 256, c.first, c.second, 4});
+			}
+		}
+		return configs;
+	}
+
+	std::string RunName(const char *pattern, const Config &config)
+	{
+		return std::string(pattern)
+			+ '/' + Fixture::Name(config.transport)
+			+ "/size="     + std::to_string(config.size)
+			+ "/clients="  + std::to_string(config.clients)
+			+ "/services=" + std::to_string(config.services);
+	}
+
+	void Describe(Result &result, const char *pattern, const Config &config)
+	{
+		result.param("pattern",   pattern);
+		result.param("transport", Fixture::Name(config.transport));
+		result.param("size",      config.size);
+		result.param("clients",   config.clients);
+		result.param("services",  config.services);
+		result.param("window",    config.window);
+	}
+
+
+	void RunReqRep(Report &report, const Config &config)
+	{
+		auto name = RunName("reqrep", config);
+		if (!report.want(name)) return;
+
+		Fixture::ServiceConfig sc;
+		sc.replySize = config.size;
+		Fixture fixture(report, config.transport, config.services, sc);
+		if (!fixture.waitRoutable()) throw nng::exception(nng::error::timedout, "reqrep (services not routable)");
+
+		LoopState  state;
+		Requesters requesters;
+		for (unsigned i = 0; i < config.clients; ++i)
+			requesters.push_back(std::make_unique<Requester>(
+				fixture.address, Fixture::uri(i % config.services), config.size, state));
+
+		Result result;
+		result.name = name;
+		Describe(result, "reqrep", config);
+		RequestLoop(report.options, state, requesters, config.window, result);
+		report.add(std::move(result));
+	}
+
+
+	/*
+		Push-pull: clients push while fewer than `window` of their messages are unreceived.
+	*/
+	void RunPushPull(Report &report, const Config &config)
+	{
+		auto name = RunName("pushpull", config);
+		if (!report.want(name)) return;
+
+		Fixture fixture(report, config.transport, config.services, Fixture::ServiceConfig());
+		if (!fixture.waitRoutable()) throw nng::exception(nng::error::timedout, "pushpull (services not routable)");
+
+		auto &sink = fixture.sink;
+		std::atomic<uint64_t> pushed = 0, errors = 0;
+		std::atomic<bool>     running = true;
+		const uint64_t        cap = uint64_t(config.clients) * config.window;
+
+		std::vector<std::thread> threads;
+		for (unsigned i = 0; i < config.clients; ++i)
+		{
+			threads.emplace_back([&, i]
+			{
+				Client client;
+				client.dial(fixture.address);
+				std::string uri = Fixture::uri(i % config.services);
+
+				while (running)
+				{
+					if (pushed.load() - sink.count.load() >= cap) {std::this_thread::yield(); continue;}
+
+					auto msg = WriteRequest(uri);
+					Stamp(msg);
+					WritePayload(msg, config.size);
+					try
+					{
+						client.push(msg.release());
+						pushed.fetch_add(1);
+					}
+					catch (nng::exception&)
+					{
+						errors.fetch_add(1);
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+				}
+			});
+		}
+
+		LoopState state;
+		uint64_t  count0 = 0, bytes0 = 0, errors0 = 0;
+
+		Result result;
+		result.name = name;
+		Describe(result, "pushpull", config);
+		Measure(report.options, state, result,
+			[&]
+			{
+				sink.latency.reset();
+				count0 = sink.count; bytes0 = sink.bytes; errors0 = errors;
+			},
+			[&]
+			{
+				result.messages = sink.count  - count0;
+				result.bytes    = sink.bytes  - bytes0;
+				result.errors   = errors      - errors0;
+				result.latency(sink.latency);
+			});
+
+		running = false;
+		for (auto &t : threads) t.join();
+
+		report.add(std::move(result));
+	}
+
+
+	/*
+		Publish-subscribe: each service publishes to its topic; every client subscribes to all.
+			Reports carry a sequence number.  Publishers hold back while the slowest client's
+			latest report is `window` or more behind, so dropped reports don't shrink the window.
+			If nothing is delivered for LostAfter_us, they publish anyway.
+			Only reports published after measurement begins are counted.
+	*/
+	struct PubSubFlow
+	{
+		static constexpr uint64_t LostAfter_us = 20000;
+
+		std::atomic<uint64_t> published    = 0;              // Last sequence number sent
+		std::atomic<uint64_t> measureFrom  = ~uint64_t(0);   // First sequence number counted
+		std::atomic<uint64_t> lastProgress = Now_us();       // Last delivery, or publish past the window
+	};
+
+	class Subscriber : public ClientHandler
+	{
+	public:
+		LoopState  &state;
+		PubSubFlow &flow;
+
+		Subscriber(LoopState &_state, PubSubFlow &_flow)    : state(_state), flow(_flow) {}
+
+		std::atomic<uint64_t> received = 0, latest = 0;
+
+		void async_recv(Subscribing, nng::msg &&msg) final
+		{
+			received.fetch_add(1);
+			try
+			{
+				MsgView::Report view(msg);
+
+				uint64_t seq = 0;
+				for (auto &header : view.headers()) if (header.is("Bench-Seq")) seq = uint64_t(header.value_dec(0));
+				uint64_t prev = latest.load();
+				while (seq > prev && !latest.compare_exchange_weak(prev, seq)) {}
+				flow.lastProgress = Now_us();
+
+				if (!state.measuring || seq < flow.measureFrom.load()) return;
+				RecordSince(state.latency, Stamped(view));
+				state.count.fetch_add(1, std::memory_order_relaxed);
+				state.bytes.fetch_add(view.bodySize(), std::memory_order_relaxed);
+			}
+			catch (MsgException&)
+			{
+				if (state.measuring) state.errors.fetch_add(1);
+			}
+		}
+		void async_recv(Requesting, nng::msg &&) final {}
+	};
+
+	void RunPubSub(Report &report, const Config &config)
+	{
+		auto name = RunName("pubsub", config);
+		if (!report.want(name)) return;
+
+		Fixture fixture(report, config.transport, config.services, Fixture::ServiceConfig());
+		if (!fixture.waitRoutable()) throw nng::exception(nng::error::timedout, "pubsub (services not routable)");
+
+		LoopState  state;
+		PubSubFlow flow;
+		std::vector<std::shared_ptr<Subscriber>> handlers;
+		std::vector<std::unique_ptr<Client>>     clients;
+		for (unsigned i = 0; i < config.clients; ++i)
+		{
+			handlers.push_back(std::make_shared<Subscriber>(state, flow));
+			clients.push_back(std::make_unique<Client>(handlers.back()));
+			clients.back()->dial(fixture.address);
+			clients.back()->subscribe("/bench/");
+		}
+
+		auto publish = [&](unsigned service, size_t size)
+		{
+			auto report = WriteReport(fixture.services[service]->uri);
+			report.writeHeader("Bench-Seq", std::to_string(++flow.published));
+			Stamp(report);
+			WritePayload(report, size);
+			fixture.services[service]->publish(report.release());
+		};
+
+		// Reports the slowest client has yet to see, counting lost ones as seen once a later one arrives.
+		auto behind = [&]() -> uint64_t
+		{
+			uint64_t slowest = ~uint64_t(0);
+			for (auto &h : handlers) slowest = std::min<uint64_t>(slowest, h->latest.load());
+			uint64_t published = flow.published.load();
+			return (published > slowest) ? published - slowest : 0;
+		};
+
+		// Wait for subscriptions to reach the server.
+		for (auto until = Clock::now() + std::chrono::seconds(5); Clock::now() < until; )
+		{
+			bool all = true;
+			for (auto &h : handlers) all = all && h->received;
+			if (all) break;
+			publish(0, 16);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		std::vector<std::thread> threads;
+		for (unsigned s = 0; s < config.services; ++s)
+		{
+			threads.emplace_back([&, s]
+			{
+				while (state.running)
+				{
+					if (behind() >= config.window)
+					{
+						// Assume the reports in flight were dropped if nothing arrives for a while.
+						uint64_t now = Now_us(), last = flow.lastProgress.load();
+						bool stalled = (now - std::min(now, last) >= PubSubFlow::LostAfter_us);
+						if (!stalled || !flow.lastProgress.compare_exchange_strong(last, now)) {std::this_thread::yield(); continue;}
+					}
+					try
+					{
+						publish(s, config.size);
+					}
+					catch (nng::exception&)
+					{
+						state.errors.fetch_add(1);
+					}
+				}
+			});
+		}
+
+		Result result;
+		result.name = name;
+		Describe(result, "pubsub", config);
+		Measure(report.options, state, result,
+			[&]
+			{
+				// Reports from the warmup may still arrive; they aren't counted.
+				flow.measureFrom = flow.published.load() + 1;
+				state.latency.reset();
+			},
+			[]{});
+		state.running = false;
+		for (auto &t : threads) t.join();
+
+		// Reports may be dropped; delivered is the fraction received during the run.
+		result.messages = state.count;
+		result.bytes    = state.bytes;
+		result.errors   = state.errors;
+		result.latency(state.latency);
+		report.add(std::move(result));
+	}
+
+
+	void Patterns(Report &report)
+	{
+		for (auto &config : Configs(report.options))
+		{
+			RunReqRep  (report, config);
+			RunPushPull(report, config);
+			RunPubSub  (report, config);
+		}
+	}
+
+	RegisterScenario registerPatterns("patterns", &Patterns);
+}
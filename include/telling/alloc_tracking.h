@@ -0,0 +1,81 @@
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace telling
+{
+	/*
+		Heap allocation counts by pipeline stage.  Enabled by building with TELLING_ALLOC_TRACKING.
+			The library then replaces the global operator new and counts each allocation
+			against the stage active on the calling thread.  Stages nest; code enters
+			one for the rest of a scope with TELLING_ALLOC_STAGE(STAGE).
+
+		Without the option, stages compile to nothing and all counts stay zero.
+			Allocations made inside NNG use its own allocator and are not counted.
+	*/
+	class AllocTracking
+	{
+	public:
+		enum STAGE
+		{
+			UNTAGGED = 0, // Outside any stage
+			WRITE,        // Composing messages with MsgWriter
+			QUEUE,        // Queueing messages and requests
+			ROUTE,        // Server routing and relaying
+			HANDLER,      // Delivering messages to handlers
+			STAGE_COUNT
+		};
+
+		struct Counts
+		{
+			uint64_t allocations = 0, bytes = 0;
+		};
+
+#if TELLING_ALLOC_TRACKING
+		static constexpr bool Enabled = true;
+#else
+		static constexpr bool Enabled = false;
+#endif
+
+		static const char *StageName(STAGE stage) noexcept;
+
+		// Counts since the last reset.
+		static Counts read (STAGE stage) noexcept;
+		static Counts total()            noexcept;
+		static void   reset()            noexcept;
+
+		// Count an allocation against the calling thread's stage.
+		static void count(size_t bytes) noexcept;
+
+
+		/*
+			Scoped stage.
+		*/
+		class Stage
+		{
+		public:
+			explicit Stage(STAGE stage) noexcept    : _prev(_current) {_current = stage;}
+			~Stage() noexcept                                          {_current = _prev;}
+
+			Stage(const Stage&) = delete;
+			void operator=(const Stage&) = delete;
+
+		private:
+			STAGE _prev;
+		};
+
+
+	private:
+		static thread_local STAGE _current;
+	};
+}
+
+
+#if TELLING_ALLOC_TRACKING
+	#define TELLING_ALLOC_STAGE(STAGE) ::telling::AllocTracking::Stage _tellingAllocStage(::telling::AllocTracking::STAGE)
+#else
+	#define TELLING_ALLOC_STAGE(STAGE) ((void) 0)
+#endif
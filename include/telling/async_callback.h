@@ -0,0 +1,119 @@
+#pragma once
+
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include "async.h"
+
+
+namespace telling
+{
+	/*
+		A move-only callable with small-buffer optimization.
+			Functors up to Capacity bytes are stored inline and never allocate.
+			Larger functors fall back to the heap.
+
+		Used for continuations, which are invoked directly from AIO callbacks.
+	*/
+	template<typename Signature, size_t Capacity = 6*sizeof(void*)>
+	class Callback;
+
+	template<typename Result, typename... Args, size_t Capacity>
+	class Callback<Result(Args...), Capacity>
+	{
+	public:
+		Callback()               noexcept    : _ops(nullptr) {}
+		Callback(std::nullptr_t) noexcept    : _ops(nullptr) {}
+		~Callback()              noexcept    {reset();}
+
+		template<typename Fn, typename = std::enable_if_t<
+			!std::is_same_v<std::decay_t<Fn>, Callback> &&
+			std::is_invocable_r_v<Result, std::decay_t<Fn>&, Args...>>>
+		Callback(Fn &&fn)
+		{
+			using Functor = std::decay_t<Fn>;
+			if constexpr (_fits_inline<Functor>())
+			{
+				new (&_store) Functor(std::forward<Fn>(fn));
+				_ops = &_ops_inline<Functor>;
+			}
+			else
+			{
+				*reinterpret_cast<Functor**>(&_store) = new Functor(std::forward<Fn>(fn));
+				_ops = &_ops_heap<Functor>;
+			}
+		}
+
+		Callback(Callback &&o) noexcept    : _ops(o._ops)
+		{
+			if (_ops) {_ops->move(&_store, &o._store); o._ops = nullptr;}
+		}
+		Callback &operator=(Callback &&o) noexcept
+		{
+			if (this != &o)
+			{
+				reset();
+				if ((_ops = o._ops)) {_ops->move(&_store, &o._store); o._ops = nullptr;}
+			}
+			return *this;
+		}
+		Callback &operator=(std::nullptr_t) noexcept    {reset(); return *this;}
+
+		Callback(const Callback&)      = delete;
+		void operator=(const Callback&) = delete;
+
+
+		// Destroy the contained functor, if any.
+		void reset() noexcept    {if (_ops) {_ops->destroy(&_store); _ops = nullptr;}}
+
+		explicit operator bool() const noexcept    {return _ops != nullptr;}
+
+		Result operator()(Args... args)            {return _ops->invoke(&_store, std::forward<Args>(args)...);}
+
+
+	private:
+		struct Ops
+		{
+			Result (*invoke) (void*, Args&&...);
+			void   (*move)   (void *dst, void *src) noexcept;
+			void   (*destroy)(void*)                noexcept;
+		};
+
+		template<typename F>
+		static constexpr bool _fits_inline()
+		{
+			return sizeof(F) <= Capacity
+				&& alignof(F) <= alignof(std::max_align_t)
+				&& std::is_nothrow_move_constructible_v<F>;
+		}
+
+		template<typename F>
+		static constexpr Ops _ops_inline =
+		{
+			[](void *s, Args&&... a) -> Result    {return (*static_cast<F*>(s))(std::forward<Args>(a)...);},
+			[](void *d, void *s) noexcept         {new (d) F(std::move(*static_cast<F*>(s))); static_cast<F*>(s)->~F();},
+			[](void *s) noexcept                  {static_cast<F*>(s)->~F();},
+		};
+
+		template<typename F>
+		static constexpr Ops _ops_heap =
+		{
+			[](void *s, Args&&... a) -> Result    {return (**static_cast<F**>(s))(std::forward<Args>(a)...);},
+			[](void *d, void *s) noexcept         {*static_cast<F**>(d) = *static_cast<F**>(s);},
+			[](void *s) noexcept                  {delete *static_cast<F**>(s);},
+		};
+
+		const Ops *_ops;
+		std::aligned_storage_t<(Capacity < sizeof(void*) ? sizeof(void*) : Capacity), alignof(std::max_align_t)> _store;
+	};
+
+
+	/*
+		Continuation for a single request.
+			Receives the response, or an error status with an empty message.
+	*/
+	using ResponseCallback = Callback<void(AsyncError status, nng::msg &&response)>;
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+
+/*
+	C++20 coroutine support.  Enabled by building with TELLING_COROUTINES.
+		Awaiters resume directly on the NNG AIO thread that completes them.
+		Apart from the coroutine frame, awaiting does not allocate.
+*/
+#if TELLING_COROUTINES
+
+
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <exception>
+#include <coroutine>
+
+#include "async_callback.h"
+#include "io_queue.h"
+
+
+namespace telling
+{
+	/*
+		Fire-and-forget coroutine.
+			Runs eagerly until it first suspends, and frees itself when finished.
+			Exceptions must be handled inside the coroutine; escaping ones terminate.
+	*/
+	struct Task
+	{
+		struct promise_type
+		{
+			Task               get_return_object()   noexcept    {return {};}
+			std::suspend_never initial_suspend()     noexcept    {return {};}
+			std::suspend_never final_suspend()       noexcept    {return {};}
+			void               return_void()         noexcept    {}
+			void               unhandled_exception() noexcept    {std::terminate();}
+		};
+	};
+
+
+	/*
+		Awaiter for a request through any communicator with request(msg, ResponseCallback).
+			Yields the response message or throws nng::exception.
+	*/
+	template<class Comm>
+	class RequestAwaiter
+	{
+	public:
+		RequestAwaiter(Comm &comm, nng::msg &&msg)    : _comm(comm), _msg(std::move(msg)) {}
+
+		bool await_ready() const noexcept    {return false;}
+
+		void await_suspend(std::coroutine_handle<> coro)
+		{
+			nng::msg msg = std::move(_msg);
+			_comm.request(std::move(msg), [this, coro](AsyncError status, nng::msg &&response)
+			{
+				_status = status.nng_status;
+				_msg    = std::move(response);
+				coro.resume();
+			});
+		}
+
+		nng::msg await_resume()
+		{
+			if (_status != nng::error::success)
+				throw nng::exception(_status, "Request could not be fulfilled.");
+			return std::move(_msg);
+		}
+
+	private:
+		Comm      &_comm;
+		nng::msg   _msg;
+		nng::error _status = nng::error::success;
+	};
+
+
+	/*
+		Receive handler which may be awaited from a coroutine.
+			Messages are queued until next() is awaited.
+			Only one coroutine may await next() at a time.
+	*/
+	template<typename Tag>
+	class AsyncRecvAwaitable : public AsyncRecv<Tag>
+	{
+	public:
+		class Next
+		{
+		public:
+			explicit Next(AsyncRecvAwaitable &source)    : _source(source) {}
+
+			bool await_ready()                                {return _source._take(*this);}
+			bool await_suspend(std::coroutine_handle<> coro)  {_coro = coro; return _source._wait(*this);}
+
+			nng::msg await_resume()
+			{
+				if (_status != nng::error::success)
+					throw nng::exception(_status, "Receive could not be completed.");
+				return std::move(_msg);
+			}
+
+		private:
+			friend class AsyncRecvAwaitable;
+			AsyncRecvAwaitable     &_source;
+			std::coroutine_handle<> _coro;
+			nng::msg                _msg;
+			nng::error              _status = nng::error::success;
+		};
+
+	public:
+		~AsyncRecvAwaitable() override {}
+
+		/*
+			Await the next message.
+				Throws nng::exception once receiving has stopped and the queue is empty.
+		*/
+		Next next() noexcept    {return Next(*this);}
+
+
+		void async_recv(Tag, nng::msg &&msg) override
+		{
+			std::unique_lock g(_mtx);
+			if (Next *waiter = std::exchange(_waiter, nullptr))
+			{
+				g.unlock();
+				waiter->_msg = std::move(msg);
+				waiter->_coro.resume();
+			}
+			else _queue.push_back(std::move(msg));
+		}
+		void async_error(Tag, AsyncError error) override
+		{
+			// Timeouts are reported to a waiting coroutine but do not stop receiving.
+			_wake(error.nng_status, false);
+		}
+		void async_stop(Tag, AsyncError) override
+		{
+			_wake(nng::error::closed, true);
+		}
+
+
+	private:
+		std::mutex           _mtx;
+		RingQueue<nng::msg>  _queue;
+		Next                *_waiter  = nullptr;
+		nng::error           _stopped = nng::error::success;
+
+		bool _take(Next &next)
+		{
+			std::lock_guard g(_mtx);
+			if (_queue.size())
+			{
+				next._msg = std::move(_queue.front());
+				_queue.pop_front();
+				return true;
+			}
+			next._status = _stopped;
+			return _stopped != nng::error::success;
+		}
+		bool _wait(Next &next)
+		{
+			std::lock_guard g(_mtx);
+			if (_queue.size() || _stopped != nng::error::success)
+			{
+				// Raced with a delivery; don't suspend.
+				if (_queue.size()) {next._msg = std::move(_queue.front()); _queue.pop_front();}
+				else               next._status = _stopped;
+				return false;
+			}
+			_waiter = &next;
+			return true;
+		}
+		void _wake(nng::error status, bool stop)
+		{
+			std::unique_lock g(_mtx);
+			if (stop) _stopped = status;
+			if (Next *waiter = std::exchange(_waiter, nullptr))
+			{
+				g.unlock();
+				waiter->_status = status;
+				waiter->_coro.resume();
+			}
+		}
+	};
+
+
+	/*
+		Coroutine which produces a reply to a query.  Tag is usually Replying.
+			co_return the reply message; it is sent with Tag::comm->respondTo.
+			The coroutine starts eagerly.  Pass the tag with respond() after starting it.
+			Take request messages by value, since the coroutine may outlive the caller.
+	*/
+	template<typename Tag>
+	class ReplyTask
+	{
+	public:
+		// Converts an exception escaping the coroutine into a reply.
+		using ExceptionReply = nng::msg (*)(std::exception_ptr);
+
+		struct promise_type
+		{
+			enum STATE {RUNNING = 0, ATTACHED = 1, FINISHED = 2};
+
+			std::atomic<int>   state = RUNNING;
+			Tag                tag = {};
+			ExceptionReply     onException = nullptr;
+			nng::msg           reply;
+			std::exception_ptr exception;
+
+			ReplyTask get_return_object() noexcept    {return ReplyTask(Handle::from_promise(*this));}
+
+			std::suspend_never initial_suspend() noexcept    {return {};}
+
+			auto final_suspend() noexcept
+			{
+				struct Final
+				{
+					bool await_ready()               noexcept    {return false;}
+					void await_resume()              noexcept    {}
+					bool await_suspend(Handle coro)  noexcept
+					{
+						// Send now if already attached; otherwise respond() will do it.
+						auto &p = coro.promise();
+						if (p.state.exchange(FINISHED) != ATTACHED) return true;
+						p._send(false);
+						return false;
+					}
+				};
+				return Final{};
+			}
+
+			void return_value(nng::msg &&msg) noexcept    {reply = std::move(msg);}
+			void unhandled_exception()        noexcept    {exception = std::current_exception();}
+
+			void _send(bool immediate) noexcept
+			{
+				try
+				{
+					if (exception && onException) reply = onException(exception);
+					if (!reply || !tag.comm) return;
+					if (immediate && tag.send) tag.send(std::move(reply));
+					else                       tag.comm->respondTo(tag.id, std::move(reply));
+				}
+				catch (...)
+				{
+					// The communicator refused the reply.
+				}
+			}
+		};
+
+		using Handle = std::coroutine_handle<promise_type>;
+
+
+	public:
+		ReplyTask(ReplyTask &&o) noexcept    : _coro(std::exchange(o._coro, nullptr)) {}
+		~ReplyTask()                         {if (_coro) _attach(Tag{}, nullptr);}
+
+		ReplyTask(const ReplyTask&)     = delete;
+		void operator=(const ReplyTask&) = delete;
+
+		/*
+			Send the reply to this query when the coroutine finishes.
+				If it has already finished, the reply goes out through tag.send.
+		*/
+		void respond(Tag tag, ExceptionReply onException = nullptr)    {_attach(tag, onException);}
+
+
+	private:
+		explicit ReplyTask(Handle coro) noexcept    : _coro(coro) {}
+
+		void _attach(Tag tag, ExceptionReply onException)
+		{
+			Handle coro = std::exchange(_coro, nullptr);
+			if (!coro) return;
+
+			auto &p = coro.promise();
+			p.tag         = tag;
+			p.onException = onException;
+			if (p.state.exchange(promise_type::ATTACHED) == promise_type::FINISHED)
+			{
+				p._send(true);
+				coro.destroy();
+			}
+		}
+
+		Handle _coro;
+	};
+}
+
+
+#endif
@@ -2,12 +2,15 @@
 
 
 #include "async.h"
+#include "metrics.h"
+#include "alloc_tracking.h"
 
 
 namespace telling
 {
 	/*
 		Optional base class for AIO receiver that calls an AsyncRecv object.
+			The AIO is created when receiving starts.
 	*/
 	template<typename Tag, class T_RecvCtx = nng::socket_view>
 	class AsyncRecvLoop
@@ -16,7 +19,7 @@ namespace telling
 		using Handler = AsyncRecv<Tag>;
 
 	public:
-		AsyncRecvLoop(T_RecvCtx &&_ctx, Tag);
+		AsyncRecvLoop(T_RecvCtx &&_ctx, Tag, CommMetrics *metrics = nullptr);
 		~AsyncRecvLoop();
 
 		// Start/stop receiving.  Start may throw exceptions on failure.
@@ -33,10 +36,14 @@ namespace telling
 		nng::aio               _aio;
 		T_RecvCtx              _ctx;
 		std::weak_ptr<Handler> _handler;
+		CommMetrics           *_metrics;
+
+		void _makeAio();
 	};
 
 	/*
 		Optional base class for AIO sender that calls an AsyncSend object.
+			The AIO is created by send_init.
 	*/
 	template<typename Tag, class T_SendCtx = nng::socket_view>
 	class AsyncSendLoop
@@ -45,7 +52,7 @@ namespace telling
 		using Handler = AsyncSend<Tag>;
 
 	public:
-		AsyncSendLoop(T_SendCtx &&_ctx, Tag);
+		AsyncSendLoop(T_SendCtx &&_ctx, Tag, CommMetrics *metrics = nullptr);
 		~AsyncSendLoop();
 
 		/*
@@ -66,6 +73,9 @@ namespace telling
 		nng::aio               _aio;
 		T_SendCtx              _ctx;
 		std::weak_ptr<Handler> _handler;
+		CommMetrics           *_metrics;
+
+		void _makeAio();
 	};
 
 
@@ -78,7 +88,8 @@ namespace telling
 			auto Member_tag,
 			auto Member_aio,
 			auto Member_ctx,
-			auto Member_handler, typename T_Self>
+			auto Member_handler,
+			auto Member_metrics, typename T_Self>
 		void AsyncRecv_Callback_Self(void *_self)
 		{
 			auto *self = static_cast<T_Self*>(_self);
@@ -86,6 +97,7 @@ namespace telling
 			nng::aio   &aio      =  self->*Member_aio;
 			auto       &ctx      =  self->*Member_ctx;
 			const auto  handler = (self->*Member_handler).lock();
+			auto       *metrics  =  self->*Member_metrics;
 
 			nng::error aioResult = aio.result();
 
@@ -102,11 +114,16 @@ namespace telling
 			{
 			case nng::error::success:
 				// Receive and continue
-				handler->async_recv(tag, aio.release_msg());
+				if (metrics) metrics->countRecv(nng_aio_get_msg(aio.get()));
+				{
+					TELLING_ALLOC_STAGE(HANDLER);
+					handler->async_recv(tag, aio.release_msg());
+				}
 				break;
 
 			case nng::error::timedout:
 				// Note error and continue
+				if (metrics) metrics->countError();
 				handler->async_error(tag, aioResult);
 				break;
 
@@ -128,6 +145,7 @@ namespace telling
 			auto Member_aio,
 			auto Member_ctx,
 			auto Member_handler,
+			auto Member_metrics,
 			typename T_Self>
 		void AsyncSend_Callback_Self(void *_self)
 		{
@@ -136,6 +154,7 @@ namespace telling
 			nng::aio   &aio      =  self->*Member_aio;
 			auto       &ctx      =  self->*Member_ctx;
 			const auto  handler = (self->*Member_handler).lock();
+			auto       *metrics  =  self->*Member_metrics;
 
 			nng::error aioResult = aio.result();
 
@@ -156,6 +175,7 @@ namespace telling
 
 			default:
 			case nng::error::timedout:
+				if (metrics) metrics->countError();
 				tag.send.setDest(nextMsg);
 				handler->async_error(tag, aioResult);
 				break;
@@ -168,6 +188,7 @@ namespace telling
 
 			if (nextMsg)
 			{
+				if (metrics) metrics->countSend(nextMsg.get());
 				aio.set_msg(std::move(nextMsg));
 				ctx.send(aio);
 			}
@@ -176,14 +197,20 @@ namespace telling
 
 
 	template<typename Tag, typename T_RecvCtx>
-	AsyncRecvLoop<Tag, T_RecvCtx>::AsyncRecvLoop(T_RecvCtx &&_ctx, Tag tag) :
-		_tag(tag), _ctx(std::move(_ctx))
+	AsyncRecvLoop<Tag, T_RecvCtx>::AsyncRecvLoop(T_RecvCtx &&_ctx, Tag tag, CommMetrics *metrics) :
+		_tag(tag), _ctx(std::move(_ctx)), _metrics(metrics)
 	{
+	}
+	template<typename Tag, typename T_RecvCtx>
+	void AsyncRecvLoop<Tag, T_RecvCtx>::_makeAio()
+	{
+		if (_aio) return;
 		_aio = nng::make_aio(&detail::AsyncRecv_Callback_Self<
 			&AsyncRecvLoop::_tag,
 			&AsyncRecvLoop::_aio,
 			&AsyncRecvLoop::_ctx,
 			&AsyncRecvLoop::_handler,
+			&AsyncRecvLoop::_metrics,
 			AsyncRecvLoop>, this);
 	}
 	template<typename Tag, typename T_RecvCtx>
@@ -202,6 +229,7 @@ namespace telling
 		if (!handler)
 			throw nng::exception(nng::error::closed, "Receive start: handler has expired");
 
+		_makeAio();
 		_handler = std::move(new_handler);
 		handler->async_start(_tag); // May throw
 		_ctx.recv(_aio);
@@ -209,27 +237,33 @@ namespace telling
 	template<typename Tag, typename T_RecvCtx>
 	void AsyncRecvLoop<Tag, T_RecvCtx>::recv_stop() noexcept
 	{
-		_aio.stop();
+		if (_aio) _aio.stop();
 		if (auto handler = _handler.lock())
 			handler->async_stop(_tag, nng::error::success);
 	}
 
 
 	template<typename Tag, typename T_SendCtx>
-	AsyncSendLoop<Tag, T_SendCtx>::AsyncSendLoop(T_SendCtx &&_ctx, Tag tag) :
-		_tag(tag), _ctx(_ctx)
+	AsyncSendLoop<Tag, T_SendCtx>::AsyncSendLoop(T_SendCtx &&_ctx, Tag tag, CommMetrics *metrics) :
+		_tag(tag), _ctx(_ctx), _metrics(metrics)
+	{
+	}
+	template<typename Tag, typename T_SendCtx>
+	void AsyncSendLoop<Tag, T_SendCtx>::_makeAio()
 	{
+		if (_aio) return;
 		_aio = nng::make_aio(&detail::AsyncSend_Callback_Self<
 			&AsyncSendLoop::_tag,
 			&AsyncSendLoop::_aio,
 			&AsyncSendLoop::_ctx,
 			&AsyncSendLoop::_handler,
+			&AsyncSendLoop::_metrics,
 			AsyncSendLoop>, this);
 	}
 	template<typename Tag, typename T_SendCtx>
 	AsyncSendLoop<Tag, T_SendCtx>::~AsyncSendLoop()
 	{
-		_aio.stop();
+		if (_aio) _aio.stop();
 		if (auto handler = _handler.lock())
 			handler->async_stop(_tag, nng::error::success);
 	}
@@ -244,6 +278,7 @@ namespace telling
 		if (!handler)
 			throw nng::exception(nng::error::closed, "Send init: handler has expired");
 
+		_makeAio();
 		_handler = std::move(new_handler);
 		handler->async_start(_tag);
 	}
@@ -262,6 +297,7 @@ namespace telling
 
 		if (msg)
 		{
+			if (_metrics) _metrics->countSend(msg.get());
 			_aio.set_msg(std::move(msg));
 			_ctx.send(_aio);
 		}
@@ -269,6 +305,6 @@ namespace telling
 	template<typename Tag, typename T_SendCtx>
 	void AsyncSendLoop<Tag, T_SendCtx>::send_stop() noexcept
 	{
-		_aio.stop();
+		if (_aio) _aio.stop();
 	}
 }
@@ -26,6 +26,11 @@ namespace telling
 		*/
 		std::future<nng::msg> request(nng::msg &&msg)    {return _requester.request(std::move(msg));}
 
+		/*
+			Create a request with a continuation, called on the AIO thread.
+		*/
+		QueryID request(nng::msg &&msg, ResponseCallback &&cb)    {return _requester.request(std::move(msg), std::move(cb));}
+
 
 		/*
 			Check for messages from subscribed topics.
@@ -74,6 +79,11 @@ namespace telling
 		*/
 		QueryID request(nng::msg &&msg)                   {return _requester.request(std::move(msg));}
 
+		/*
+			Create a request with a continuation, bypassing the handler.
+		*/
+		QueryID request(nng::msg &&msg, ResponseCallback &&cb)    {return _requester.request(std::move(msg), std::move(cb));}
+
 		/*
 			Use subscribe(string topic) to set up subscriptions.
 				Handler may then get subscribe_recv or subscribe_error.
@@ -0,0 +1,96 @@
+#pragma once
+
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
+
+#include "client_request.h"
+
+
+namespace telling
+{
+	/*
+		Scatter-gather requests through a Request communicator.
+			Issues several requests at once and completes when a quorum of them
+			has been answered, when all have finished, or when the deadline passes.
+			Stragglers are canceled on completion.
+
+		Responses are collected in place; no futures or per-request maps are used.
+		A Request_Gather may be reused after it completes.
+	*/
+	class Request_Gather
+	{
+	public:
+		using Deadline = std::chrono::milliseconds;
+
+		struct Result
+		{
+			AsyncError status;   // timedout past the deadline; canceled if completion came first
+			nng::msg   response; // empty unless status is success
+			bool       done = false;
+		};
+
+		using Completion = Callback<void(Request_Gather&)>;
+
+
+	public:
+		explicit Request_Gather(Request &requester);
+		~Request_Gather();
+
+		/*
+			Issue one request per message.
+				quorum   -- number of successful responses needed; 0 means all.
+				deadline -- give up on unanswered requests after this time; 0 means never.
+				complete -- optional; called from the AIO thread on completion.
+			Requests which can't be sent are recorded as failed results.
+			Throws nng::exception if a gather is already in progress.
+		*/
+		void start(std::vector<nng::msg> &&requests,
+			size_t     quorum   = 0,
+			Deadline   deadline = Deadline::zero(),
+			Completion complete = nullptr);
+
+		/*
+			Block until complete, or until the given timeout.  Returns complete().
+		*/
+		bool wait();
+		bool wait(Deadline timeout);
+
+		/*
+			Cancel all outstanding requests.  Completion follows shortly after.
+		*/
+		void cancel();
+
+		// Check whether the gather has completed.
+		bool complete() const    {std::lock_guard g(_mtx); return _complete;}
+
+		// Number of successful responses.
+		size_t successes() const    {std::lock_guard g(_mtx); return _successes;}
+
+		/*
+			Results, in the order requests were given.
+				Safe to access after completion.
+		*/
+		std::vector<Result>       &results()       noexcept    {return _results;}
+		const std::vector<Result> &results() const noexcept    {return _results;}
+
+
+	private:
+		Request                &_requester;
+		nng::aio                _timer;
+
+		mutable std::mutex      _mtx;
+		std::condition_variable _cond;
+		std::vector<Result>     _results;
+		std::vector<QueryID>    _queries;
+		Completion              _onComplete;
+		size_t                  _quorum = 0, _successes = 0, _finished = 0, _outstanding = 0;
+		bool                    _complete = true, _canceled = false, _expired = false;
+
+		void _finish(size_t index, AsyncError status, nng::msg &&response);
+		void _cancel_stragglers();
+		static void _timerCallback(void*);
+	};
+}
@@ -37,9 +37,9 @@ namespace telling
 		/*
 			Construct with asynchronous I/O handler and optional socket-sharing.
 		*/
-		Push()                                                     : Push_Base(),       AsyncSendLoop(socketView(),{this}) {}
+		Push()                                                     : Push_Base(),       AsyncSendLoop(socketView(),{this},&metrics) {}
 		Push(std::weak_ptr<AsyncPush> p)                           : Push() {initialize(p);}
-		Push(const Push_Pattern &shared)                           : Push_Base(shared), AsyncSendLoop(socketView(),{this}) {}
+		Push(const Push_Pattern &shared)                           : Push_Base(shared), AsyncSendLoop(socketView(),{this},&metrics) {}
 		Push(const Push_Pattern &s, std::weak_ptr<AsyncPush> p)    : Push(s) {initialize(p);}
 		~Push() {}
 
@@ -57,6 +57,8 @@ namespace telling
 			if (!isReady()) throw nng::exception(nng::error::closed, "Push Communicator is not ready.");
 			send_msg(std::move(msg));
 		}
+
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
 	};
 
 
@@ -71,6 +73,8 @@ namespace telling
 		Push_Box(const Push_Base &shareSocket)    : Push(shareSocket) {_init();}
 		~Push_Box() {}
 
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
+
 
 	protected:
 		void _init()    {initialize(_queue.weak());}
@@ -1,14 +1,20 @@
 #pragma once
 
 
-#include <deque>
+#include <map>
 #include <mutex>
+#include <atomic>
 #include <future>
+#include <vector>
 #include <life_lock.hpp>
 #include <unordered_set>
+#include <unordered_map>
 #include "socket.h"
 
 #include "async_loop.h"
+#include "async_callback.h"
+#include "async_coro.h"
+#include "histogram.h"
 
 
 namespace telling
@@ -78,12 +84,77 @@ namespace telling
 		*/
 		QueryID request(nng::msg &&msg);
 
+		/*
+			Initiate a request with a continuation.
+				The callback is invoked once, on the AIO thread, with the response or an error.
+				The handler is not involved and need not be installed.
+				May fail, throwing nng::exception.
+		*/
+		QueryID request(nng::msg &&msg, ResponseCallback &&callback);
+
+		/*
+			Cancel an outstanding request.
+				Its handler or callback receives nng::error::canceled.
+				Returns false if the request is no longer outstanding.
+		*/
+		bool cancel(QueryID);
+
+		/*
+			Pre-allocate contexts for at least this many concurrent requests.
+		*/
+		void reserve(size_t concurrent);
+
+
+		/*
+			Hedged requests.
+				When enabled, continuation requests with idempotent methods are sent a second
+				time if no reply arrives within a percentile of their URI's observed latency.
+				The first reply wins and the other attempt is canceled.
+		*/
+		struct HedgePolicy
+		{
+			double   percentile    = 0.95; // Hedge once this fraction of replies would have arrived
+			unsigned minDelay_ms   = 1;
+			unsigned maxDelay_ms   = 1000;
+			unsigned startDelay_ms = 50;   // Used until a URI has minSamples latencies
+			uint64_t minSamples    = 32;
+			uint64_t window        = 4096; // Older latencies fade out past this many samples
+			size_t   maxUris       = 256;  // Further URIs share one histogram
+		};
+		struct HedgeStats
+		{
+			uint64_t
+				requests, // Requests eligible for hedging
+				hedges,   // Duplicate requests sent
+				wins;     // Duplicates which replied first
+		};
+
+		void       enableHedging()    {enableHedging(HedgePolicy());}
+		void       enableHedging(const HedgePolicy &policy);
+		void       disableHedging();
+		HedgeStats hedgeStats() const noexcept;
+
+		// Observed latency for a URI, or null if none has been recorded.
+		const LatencyHistogram *hedgeLatency(std::string_view uri) const;
+
+
+#if TELLING_COROUTINES
+		/*
+			Initiate a request from a coroutine:  co_await request.send(msg)
+				Resumes on the AIO thread with the response, or throws nng::exception.
+		*/
+		RequestAwaiter<Request> send(nng::msg &&msg)    {return RequestAwaiter<Request>(*this, std::move(msg));}
+#endif
+
 
 		/*
 			Stats implementation
 		*/
 		MsgStats msgStats() const noexcept final;
 
+		// Estimated bytes held, including pooled contexts (hedging statistics excluded).
+		size_t footprint() const noexcept override;
+
 
 	protected:
 		std::weak_ptr<AsyncReq> _handler;
@@ -95,11 +166,44 @@ namespace telling
 			RECV = 2,
 		};
 
+		/*
+			Contexts and AIOs are created by the first request, not at construction.
+				Idle ones are pooled in a stack (a deque would allocate up front).
+		*/
 		struct Action;
 		friend struct Action;
 		mutable std::mutex          mtx;
 		std::unordered_set<Action*> active;
-		std::deque<Action*>         idle;
+		std::vector<Action*>        idle;
+
+		// Get an idle action or create a new one.  Call with mtx locked.
+		Action *_acquire();
+
+		// Hedging state.  Hedges are pooled under mtx; the rest is under hedge_mtx.
+		struct Hedge;
+		friend struct Hedge;
+		std::vector<Hedge*>         hedges;
+		std::vector<Hedge*>         hedgeIdle;
+		std::unordered_map<QueryID, Hedge*> hedgeQueries; // Undelivered hedges, by their QueryID
+		QueryID                             _nextHedgeID = 0;
+
+		// NNG context IDs stay below 2^31, so hedge IDs with the top bit set can't collide with them.
+		static constexpr QueryID HedgeIDBit = QueryID(1) << (8*sizeof(QueryID) - 1);
+
+		using LatencyMap = std::map<std::string, LatencyHistogram, std::less<>>;
+		mutable std::mutex    hedge_mtx;
+		HedgePolicy           _hedgePolicy;
+		LatencyMap            _hedgeLatency;
+		std::atomic<bool>     _hedging = false;
+		std::atomic<uint64_t> _hedgeRequests = 0, _hedgeCount = 0, _hedgeWins = 0;
+
+		QueryID _hedged     (nng::msg &&msg, ResponseCallback &&callback, std::string_view uri);
+		void    _hedgeFinish(Hedge*, unsigned leg, AsyncError status, nng::msg &&response);
+		void    _hedgeLaunch(Hedge*, unsigned leg, nng::msg &&msg);
+		void    _hedgeRelease(Hedge*);
+
+		// Mark a hedge done, stop its timer and take its callback.  Call with mtx locked.
+		ResponseCallback _hedgeDeliver(Hedge*);
 	};
 
 
@@ -120,6 +224,13 @@ namespace telling
 		*/
 		std::future<nng::msg> request(nng::msg &&msg);
 
+		size_t footprint() const noexcept override;
+
+		/*
+			Continuation-style requests bypass the future machinery.
+		*/
+		using Request::request;
+
 
 	protected:
 		class Delegate;
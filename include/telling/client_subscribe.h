@@ -8,6 +8,7 @@
 #include "socket.h"
 #include "async_loop.h"
 #include "async_queue.h"
+#include "async_coro.h"
 
 
 namespace telling
@@ -55,9 +56,9 @@ namespace telling
 			Construct with asynchronous I/O handler and optional socket-sharing.
 				Begins listening for messages immediately.
 		*/
-		Subscribe()                                                         : Subscribe_Base(),       AsyncRecvLoop(make_ctx(),{this}) {}
+		Subscribe()                                                         : Subscribe_Base(),       AsyncRecvLoop(make_ctx(),{this},&metrics) {}
 		Subscribe(std::weak_ptr<AsyncSub> p)                                : Subscribe() {initialize(p);}
-		Subscribe(const Subscribe_Pattern &shared)                          : Subscribe_Base(shared), AsyncRecvLoop(make_ctx(),{this}) {}
+		Subscribe(const Subscribe_Pattern &shared)                          : Subscribe_Base(shared), AsyncRecvLoop(make_ctx(),{this},&metrics) {}
 		Subscribe(const Subscribe_Pattern &s, std::weak_ptr<AsyncSub> p)    : Subscribe(s) {initialize(p);}
 		~Subscribe() {}
 
@@ -71,6 +72,8 @@ namespace telling
 		*/
 		void subscribe  (std::string_view topic) final;
 		void unsubscribe(std::string_view topic) final;
+
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
 	};
 
 
@@ -91,9 +94,40 @@ namespace telling
 		*/
 		bool consume(nng::msg &msg)    {return _queue->pull(msg);}
 
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
+
 
 	protected:
 		void _init()    {initialize(_queue.weak());}
 		edb::life_locked<AsyncRecvQueue<Subscribing>> _queue;
 	};
+
+
+#if TELLING_COROUTINES
+	/*
+		Client socket for subscriptions, consumed from a coroutine.
+			co_await next() yields each message from subscribed topics.
+	*/
+	class Subscribe_Coro : public Subscribe
+	{
+	public:
+		explicit Subscribe_Coro()                               : Subscribe()            {_init();}
+		Subscribe_Coro(const Subscribe_Pattern &shareSocket)    : Subscribe(shareSocket) {_init();}
+		~Subscribe_Coro() {}
+
+		/*
+			Await the next message.
+				Only one coroutine may await at a time.
+				Throws nng::exception when the subscription stops.
+		*/
+		AsyncRecvAwaitable<Subscribing>::Next next() noexcept    {return _awaitable->next();}
+
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
+
+
+	protected:
+		void _init()    {initialize(_awaitable.weak());}
+		edb::life_locked<AsyncRecvAwaitable<Subscribing>> _awaitable;
+	};
+#endif
 }
\ No newline at end of file
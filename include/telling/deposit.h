@@ -19,11 +19,11 @@ namespace telling
 		
 		A ClaimNumber of 0 is invalid and indicates failure.
 	*/
-	ClaimNumber Deposit(std::any&&, DepositDuration);
+	ClaimNumber Deposit(std::any, DepositDuration);
 
 	/*
 		Claim an object previously deposited.  (thread-safe)
-			The item may only be Claimed once.
+			The item may only be Claimed once; claiming removes it.
 			any::has_value() will be false for claimed or expired items.
 	*/
 	std::any    Claim  (ClaimNumber);
@@ -46,7 +46,8 @@ namespace telling
 
 #if TELLING_DEPOSIT_IMPL
 
-#include <queue>
+#include <atomic>
+#include <vector>
 #include <unordered_map>
 #include <mutex>
 #include <condition_variable>
@@ -59,71 +60,103 @@ namespace telling
 	*/
 	namespace detail
 	{
+		/*
+			Lockers are split into shards by the low bits of the claim number.
+				Each shard has its own mutex, map and hierarchical timer wheel.
+				Expiry costs O(1) per item; claimed items are skipped lazily.
+		*/
 		class Depository
 		{
 		private:
-			using ExpireTime = DepositClock::time_point;
-			struct Expiration
+			using Tick = uint64_t;
+
+			static constexpr unsigned ShardBits  = 4,  Shards = 1u << ShardBits;
+			static constexpr unsigned SlotBits   = 6,  Slots  = 1u << SlotBits;
+			static constexpr unsigned Levels     = 4;
+			static constexpr Tick     WheelSpan  = Tick(1) << (SlotBits * Levels);
+
+			// Resolution of expiration.  Items never expire early.
+			static constexpr auto TickLength = std::chrono::milliseconds(10);
+
+			struct Locker
+			{
+				std::any object;
+				Tick     expire;
+			};
+			struct Timer
 			{
 				ClaimNumber number;
-				ExpireTime  expire;
+				Tick        expire;
+			};
+			using Lockers = std::unordered_map<ClaimNumber, Locker>;
+			using Slot    = std::vector<Timer>;
 
-				// Earlier expire times have greater priority in the queue
-				bool operator<(const Expiration &o) const noexcept    {return expire > o.expire;}
+			struct Shard
+			{
+				std::mutex mtx;
+				Lockers    lockers;
+				Slot       wheel[Levels][Slots];
+				Tick       current = 0; // Last tick processed
+				size_t     timers  = 0; // Entries in the wheel, including claimed ones
 			};
 
-			using Lockers     = std::unordered_map<ClaimNumber, std::any>;
-			using ExpireQueue = std::priority_queue<Expiration>;
+			Shard                   shards[Shards];
+			std::atomic<ClaimNumber> claimNumberGen = 0;
+			std::atomic<size_t>     pending = 0;
+
+			DepositClock::time_point epoch = DepositClock::now();
 
 			std::mutex              mtx;
-			Lockers                 lockers;
-			ExpireQueue             expireQueue;
 			std::thread             expireThread;
 			std::condition_variable expireCond;
 			bool                    terminate = false;
-
-			ClaimNumber             claimNumberGen = 0;
 			
 
 		public:
 			Depository()
 			{
-				expireThread = std::thread(&run_expire_thread, this);
+				expireThread = std::thread(&Depository::run_expire_thread, this);
 			}
 			~Depository()
 			{
-				terminate = true;
+				{
+					std::lock_guard g(mtx);
+					terminate = true;
+				}
 				expireCond.notify_one();
 				expireThread.join();
 			}
 
 			void run_expire_thread()
 			{
+				std::vector<std::any> expired;
+
 				std::unique_lock lock(mtx);
 
 				while (!terminate)
 				{
-					if (expireQueue.empty())
+					if (pending.load() == 0)
 					{
+						// Nothing to expire; sleep until something is deposited.
 						expireCond.wait(lock);
+						continue;
 					}
-					else
+
+					expireCond.wait_for(lock, TickLength);
+					lock.unlock();
+
+					Tick now = _now();
+					for (auto &shard : shards)
 					{
-						auto &top = expireQueue.top();
-						
-						if (top.expire < DepositClock::now())
 						{
-							// Destroy the item and proceed.
-							lockers.erase(top.number);
-							expireQueue.pop();
-							continue;
-						}
-						else
-						{
-							// Wait until the next item expires or the queue is changed.
-							expireCond.wait_until(lock, top.expire);
+							std::lock_guard g(shard.mtx);
+							_advance(shard, now, expired);
 						}
+						// Destroy expired objects outside the shard lock.
+						expired.clear();
 					}
+
+					lock.lock();
 				}
 			}
 
@@ -131,42 +164,125 @@ namespace telling
 			{
 				if (duration <= DepositDuration::zero()) return 0;
 
-				std::lock_guard g(mtx);
+				// Round up so that items never expire early.
+				Tick now    = _now();
+				Tick expire = now + Tick((duration + TickLength - DepositDuration(1)) / TickLength);
 
-				// Generate an unused nonzero claim number
-				ClaimNumber claimNumber;
-				do
+				while (true)
 				{
-					// TODO something cleverer?  More secure?
-					claimNumber = ++claimNumberGen;
-				}
-				while (claimNumber != 0 && !lockers.count(claimNumber));
+					// Generate a nonzero claim number; consecutive numbers use different shards.
+					ClaimNumber claimNumber = ++claimNumberGen;
+					if (claimNumber == 0) continue;
 
-				// Configure expiration
-				Expiration expiration = {claimNumber, DepositClock::now() + duration};
-				bool wakeExpiration = (!expireQueue.size() || expiration < expireQueue.top());
-				expireQueue.emplace(std::move(expiration));
+					Shard &shard = _shard(claimNumber);
+					std::lock_guard g(shard.mtx);
 
-				// Add to map
-				lockers.emplace(claimNumber, std::move(object));
+					// Skip numbers still in use after wrapping around.
+					auto [pos, inserted] = shard.lockers.try_emplace(claimNumber);
+					if (!inserted) continue;
+					pos->second = Locker{std::move(object), expire};
 
-				// Wake expiration queue if this new item expires next
-				if (wakeExpiration) expireCond.notify_one();
+					// An idle shard's wheel may be behind the clock.
+					if (shard.timers == 0 && shard.current < now) shard.current = now;
+					_place(shard, Timer{claimNumber, expire});
+					++shard.timers;
+
+					// Wake the expiry thread if it was idle.
+					if (pending.fetch_add(1) == 0)
+					{
+						std::lock_guard g(mtx);
+						expireCond.notify_one();
+					}
+					return claimNumber;
+				}
 			}
 
 			std::any claim(ClaimNumber number)
 			{
-				std::lock_guard g(mtx);
+				Shard &shard = _shard(number);
+				std::lock_guard g(shard.mtx);
 
-				// Locate the item...
+				// Locate and remove the item.  Its timer is discarded when it comes due.
 				std::any result;
-				auto pos = lockers.find(number);
-				if (pos != lockers.end()) result = std::move(pos->second);
+				auto pos = shard.lockers.find(number);
+				if (pos != shard.lockers.end())
+				{
+					result = std::move(pos->second.object);
+					shard.lockers.erase(pos);
+				}
 				return result;
 			}
 
 			// Thread-safe C++ initialization
 			static Depository &Get() {static Depository manager; return manager;}
+
+
+		private:
+			Shard &_shard(ClaimNumber n) noexcept    {return shards[n & (Shards-1)];}
+
+			Tick _now() const noexcept    {return Tick((DepositClock::now() - epoch) / TickLength);}
+
+			// Put a timer into the wheel level covering its remaining time.
+			static void _place(Shard &shard, const Timer &timer)
+			{
+				Tick delta = (timer.expire > shard.current) ? (timer.expire - shard.current) : 1;
+				if (delta >= WheelSpan) delta = WheelSpan - 1;
+				Tick at = shard.current + delta;
+
+				unsigned level = 0;
+				while (level+1 < Levels && delta >= (Tick(1) << (SlotBits * (level+1)))) ++level;
+
+				shard.wheel[level][(at >> (SlotBits * level)) & (Slots-1)].push_back(timer);
+			}
+
+			// Process ticks up to now, collecting expired objects.
+			void _advance(Shard &shard, Tick now, std::vector<std::any> &expired)
+			{
+				if (shard.timers == 0) {shard.current = now; return;}
+
+				while (shard.current < now && shard.timers)
+				{
+					++shard.current;
+
+					// Cascade higher levels as lower ones wrap around.
+					for (unsigned level = 1; level < Levels; ++level)
+					{
+						if ((shard.current >> (SlotBits * (level-1))) & (Slots-1)) break;
+
+						Slot cascade;
+						cascade.swap(shard.wheel[level][(shard.current >> (SlotBits * level)) & (Slots-1)]);
+						for (auto &timer : cascade)
+						{
+							if (timer.expire <= shard.current) _expire(shard, timer, expired);
+							else                               _place (shard, timer);
+						}
+					}
+
+					Slot &slot = shard.wheel[0][shard.current & (Slots-1)];
+					for (auto &timer : slot)
+					{
+						if (timer.expire <= shard.current) _expire(shard, timer, expired);
+						else                               _place (shard, timer); // Clamped; not yet due
+					}
+					slot.clear();
+				}
+
+				if (shard.timers == 0) shard.current = now;
+			}
+
+			void _expire(Shard &shard, const Timer &timer, std::vector<std::any> &expired)
+			{
+				--shard.timers;
+				pending.fetch_sub(1);
+
+				// Lazy deletion: the item may have been claimed, or its number reused.
+				auto pos = shard.lockers.find(timer.number);
+				if (pos != shard.lockers.end() && pos->second.expire == timer.expire)
+				{
+					expired.push_back(std::move(pos->second.object));
+					shard.lockers.erase(pos);
+				}
+			}
 		};
 	}
 
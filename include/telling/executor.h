@@ -0,0 +1,183 @@
+#pragma once
+
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <condition_variable>
+
+#include "async_callback.h"
+
+
+namespace telling
+{
+	/*
+		Work-stealing thread pool.
+			Used to run handlers off of NNG's AIO threads, so slow handlers don't stall
+			NNG's task pool or other sockets.
+
+		Jobs wait in Queues, each with its own FIFO, typically one per service.
+			Each worker keeps lists of runnable queues, one per priority class, and
+			takes turns among them round-robin: one job per turn, after which the queue
+			goes to the back of the list.  So a backlog in one queue delays other queues
+			by at most one job per turn, not by the whole backlog.
+			Idle workers steal whole queue turns from other workers, so a busy queue's
+			jobs still run in parallel.  Higher priority queues are always served first.
+	*/
+	class Executor
+	{
+	public:
+		enum PRIORITY
+		{
+			HIGH   = 0,
+			NORMAL = 1,
+			LOW    = 2,
+			PRIORITY_COUNT
+		};
+
+		// Jobs large enough to hold a handler event without allocating.
+		using Job = Callback<void(), 8*sizeof(void*)>;
+
+		struct Config
+		{
+			unsigned threads    = 0;     // 0 uses hardware concurrency
+			bool     pinThreads = false; // Pin worker N to CPU N (modulo CPU count)
+		};
+
+		class Queue;
+
+
+	public:
+		Executor()    : Executor(Config()) {}
+		explicit Executor(const Config &config);
+		~Executor(); // Runs queued jobs, then joins the workers.
+
+		Executor(const Executor&)      = delete;
+		void operator=(const Executor&) = delete;
+
+		/*
+			Run a job on the pool, through a shared unbounded queue for its priority.
+				Jobs should not throw; exceptions are discarded.
+		*/
+		void post(Job &&job, PRIORITY priority = NORMAL);
+
+		unsigned threadCount() const noexcept    {return unsigned(_workers.size());}
+		size_t   pending()     const noexcept    {return _pending.load(std::memory_order_relaxed);}
+
+
+	private:
+		struct Worker;
+
+		std::vector<std::unique_ptr<Worker>> _workers;
+		std::unique_ptr<Queue>               _shared[PRIORITY_COUNT];
+		std::atomic<size_t>                  _pending  = 0;
+		std::atomic<unsigned>                _sleepers = 0;
+		std::atomic<unsigned>                _nextWorker = 0;
+		std::mutex                           _idle_mtx;
+		std::condition_variable              _idle_cond;
+		bool                                 _stop = false;
+
+		void _schedule(Queue *queue, unsigned worker);
+		bool _take    (unsigned self, Job &job, Queue* &queue);
+		void _run     (unsigned self);
+	};
+
+
+	/*
+		A bounded FIFO of work on an Executor, typically one per service.
+			post() refuses work once capacity jobs are queued or running.
+			The destructor waits for this queue's jobs to finish.
+	*/
+	class Executor::Queue
+	{
+	public:
+		Queue(Executor &executor, PRIORITY priority = NORMAL, size_t capacity = 4096);
+		~Queue();
+
+		Queue(const Queue&)         = delete;
+		void operator=(const Queue&) = delete;
+
+		/*
+			Run a job on the executor.  Returns false if the queue is full.
+		*/
+		bool post(Job &&job);
+
+		// Block until all jobs posted so far have finished.
+		void drain();
+
+		Executor &executor() const noexcept    {return _executor;}
+		PRIORITY  priority() const noexcept    {return _priority;}
+		size_t    capacity() const noexcept    {return _capacity;}
+		size_t    depth()    const noexcept    {return _inFlight.load(std::memory_order_relaxed);}
+
+
+	private:
+		friend class Executor;
+
+		Executor               &_executor;
+		const PRIORITY          _priority;
+		const size_t            _capacity;
+		std::atomic<size_t>     _inFlight = 0;
+		std::mutex              _mtx;
+		std::deque<Job>         _jobs;              // Under _mtx
+		bool                    _scheduled = false; // In a runnable list or being taken; under _mtx
+		std::mutex              _drain_mtx;
+		std::condition_variable _drain_cond;
+
+		void _finished();
+	};
+
+
+	/*
+		Receive handler decorator which delivers messages on an Executor.
+			Suitable for Subscribe and Pull.  Other events are forwarded directly.
+			Messages refused by the queue are dropped and reported as nng::error::again.
+			Exceptions from the inner handler are reported as nng::error::internal.
+	*/
+	template<typename Tag>
+	class AsyncRecv_Executor : public AsyncRecv<Tag>
+	{
+	public:
+		AsyncRecv_Executor(std::shared_ptr<AsyncRecv<Tag>> inner,
+			Executor &executor, Executor::PRIORITY priority = Executor::NORMAL, size_t capacity = 4096) :
+			_inner(std::move(inner)), _queue(executor, priority, capacity) {}
+		~AsyncRecv_Executor() override    {_queue.drain();}
+
+		Executor::Queue &queue() noexcept    {return _queue;}
+
+		void async_recv (Tag tag, nng::msg &&msg) override
+		{
+			bool posted = _queue.post([this, tag, msg = std::move(msg)]() mutable
+			{
+				try
+				{
+					_inner->async_recv(tag, std::move(msg));
+				}
+				catch (std::exception &e)
+				{
+					AsyncError error(nng::error::internal);
+					error.error_msg = e.what();
+					_inner->async_error(tag, error);
+				}
+				catch (...)
+				{
+					AsyncError error(nng::error::internal);
+					error.error_msg = "unknown exception";
+					_inner->async_error(tag, error);
+				}
+			});
+			if (!posted) _inner->async_error(tag, nng::error::again);
+		}
+		void async_error(Tag tag, AsyncError error) override    {_inner->async_error(tag, error);}
+		void async_start(Tag tag)                   override    {_inner->async_start(tag);}
+		void async_stop (Tag tag, AsyncError error) override    {_inner->async_stop(tag, error);}
+
+
+	protected:
+		std::shared_ptr<AsyncRecv<Tag>> _inner;
+		Executor::Queue                 _queue;
+	};
+}
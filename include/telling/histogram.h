@@ -0,0 +1,130 @@
+#pragma once
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+namespace telling
+{
+	/*
+		Lock-free latency histogram with log-linear buckets.
+			Values are in microseconds, from 0 up to roughly 9 hours.
+			Each power of two is split into SubBuckets, so error stays under 12.5%.
+
+		Recording is wait-free and may be done from any thread.
+			Readings taken during concurrent recording are approximate.
+	*/
+	class LatencyHistogram
+	{
+	public:
+		static constexpr unsigned SubBits    = 3;
+		static constexpr unsigned SubBuckets = 1u << SubBits;
+		static constexpr unsigned Octaves    = 32;
+		static constexpr unsigned Buckets    = (Octaves+1) * SubBuckets;
+
+		using Clock = std::chrono::steady_clock;
+
+
+	public:
+		LatencyHistogram() noexcept    {reset();}
+
+		LatencyHistogram(const LatencyHistogram&) = delete;
+		void operator=(const LatencyHistogram&)   = delete;
+
+
+		// Record one sample.
+		void record(uint64_t micros) noexcept
+		{
+			_buckets[Index(micros)].fetch_add(1, std::memory_order_relaxed);
+			_count.fetch_add(1,      std::memory_order_relaxed);
+			_sum  .fetch_add(micros, std::memory_order_relaxed);
+
+			uint64_t prev = _max.load(std::memory_order_relaxed);
+			while (micros > prev && !_max.compare_exchange_weak(prev, micros, std::memory_order_relaxed)) {}
+		}
+		void record(Clock::duration d) noexcept
+		{
+			auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+			record(uint64_t(us > 0 ? us : 0));
+		}
+		void recordSince(Clock::time_point start) noexcept    {record(Clock::now() - start);}
+
+		// Statistics.
+		uint64_t count() const noexcept    {return _count.load(std::memory_order_relaxed);}
+		uint64_t max  () const noexcept    {return _max  .load(std::memory_order_relaxed);}
+		uint64_t mean () const noexcept    {auto n = count(); return n ? _sum.load(std::memory_order_relaxed) / n : 0;}
+
+		/*
+			Estimate a percentile (0 < p <= 1) in microseconds.
+				Returns the upper bound of the bucket containing it, or 0 when empty.
+		*/
+		uint64_t percentile(double p) const noexcept
+		{
+			uint64_t total = 0;
+			for (auto &b : _buckets) total += b.load(std::memory_order_relaxed);
+			if (!total) return 0;
+
+			uint64_t target = uint64_t(p * double(total));
+			if (target < 1)     target = 1;
+			if (target > total) target = total;
+
+			uint64_t seen = 0;
+			for (unsigned i = 0; i < Buckets; ++i)
+			{
+				seen += _buckets[i].load(std::memory_order_relaxed);
+				if (seen >= target) return UpperBound(i);
+			}
+			return max();
+		}
+
+		/*
+			Clear all samples, or halve them so that old samples fade out.
+		*/
+		void reset() noexcept
+		{
+			for (auto &b : _buckets) b.store(0, std::memory_order_relaxed);
+			_count.store(0, std::memory_order_relaxed);
+			_sum  .store(0, std::memory_order_relaxed);
+			_max  .store(0, std::memory_order_relaxed);
+		}
+		void decay() noexcept
+		{
+			for (auto &b : _buckets) b.store(b.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+			_count.store(_count.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+			_sum  .store(_sum  .load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+		}
+
+		// Raw bucket access, eg. for reporting.
+		uint64_t bucketCount(unsigned i) const noexcept    {return _buckets[i].load(std::memory_order_relaxed);}
+
+
+		/*
+			Bucket mapping.
+		*/
+		static unsigned Index(uint64_t v) noexcept
+		{
+			if (v < SubBuckets) return unsigned(v);
+
+			unsigned msb = 0;
+			for (uint64_t t = v; t >>= 1;) ++msb;
+
+			unsigned shift = msb - SubBits;
+			unsigned i = (shift+1) * SubBuckets + unsigned((v >> shift) - SubBuckets);
+			return (i < Buckets) ? i : Buckets-1;
+		}
+		static uint64_t UpperBound(unsigned i) noexcept
+		{
+			if (i < SubBuckets) return i;
+
+			unsigned shift = i / SubBuckets - 1, sub = i % SubBuckets;
+			return ((uint64_t(SubBuckets + sub) << shift) + (uint64_t(1) << shift)) - 1;
+		}
+
+
+	private:
+		std::atomic<uint64_t> _buckets[Buckets];
+		std::atomic<uint64_t> _count, _sum, _max;
+	};
+}
@@ -139,6 +139,38 @@ namespace telling
 		static Base InProc   (const std::string_view name)                   {return Base(HostAddress::InProc(name));}
 		static Base IPC      (const std::string_view name)                   {return Base(HostAddress::IPC(name));}
 		
+		/*
+			Parse a base address from "tcp://host:port", "ipc://name" or "inproc://name".
+				A string without a scheme is taken as an inproc name.
+				Returns a nil address if the string can't be parsed.
+		*/
+		static Base Parse(std::string_view uri)
+		{
+			auto scheme = uri.find("://");
+			if (scheme == std::string_view::npos) return InProc(uri);
+
+			auto type = uri.substr(0, scheme), rest = uri.substr(scheme+3);
+			if (type == "inproc") return InProc(rest);
+			if (type == "ipc")
+			{
+				// Addresses from this class include a directory.
+				auto slash = rest.rfind('/');
+				return IPC((slash == std::string_view::npos) ? rest : rest.substr(slash+1));
+			}
+			if (type == "tcp")
+			{
+				auto colon = rest.rfind(':');
+				if (colon == std::string_view::npos) return Base();
+				unsigned port = 0;
+				for (char c : rest.substr(colon+1))
+				{
+					if (c < '0' || c > '9' || (port = port*10 + unsigned(c-'0')) > 0xFFFF) return Base();
+				}
+				return TCP(rest.substr(0, colon), uint16_t(port));
+			}
+			return Base();
+		}
+
 		// Nil check / comparison
 		operator bool() const                   {return base;}
 		bool operator==(const Base &o) const    {return base==o.base;}
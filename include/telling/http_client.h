@@ -4,6 +4,7 @@
 #include <mutex>
 #include <future>
 #include <deque>
+#include <chrono>
 #include <unordered_set>
 
 #include <nngpp/http/client.h>
@@ -14,6 +15,8 @@
 #include <nngpp/url.h>
 
 #include "async_loop.h"
+#include "async_callback.h"
+#include "async_coro.h"
 #include "msg_view.h"
 #include "host_address.h"
 
@@ -82,6 +85,16 @@ namespace telling
 			// Optional progress notification
 			virtual void async_response_progress(HttpRequesting, MsgCompletion, const MsgView::Reply&) {}
 
+			/*
+				Streaming responses (see requestStreaming).
+					head -- the start-line and headers, once parsed.
+					body -- a segment of the body, viewing the receive buffer.
+						Chunked bodies are delivered decoded.  Copy what you need to keep.
+				async_recv follows with the head alone, once the body is complete.
+			*/
+			virtual void async_response_head(HttpRequesting, const MsgView::Reply &head) {}
+			virtual void async_response_body(HttpRequesting, nng::view segment)         {}
+
 			void async_prep (HttpRequesting, nng::msg &query) override     {}
 			void async_sent (HttpRequesting)                  override     {}
 			//void async_recv (HttpRequesting, nng::msg &&response)   override     = 0;
@@ -108,6 +121,64 @@ namespace telling
 		*/
 		QueryID request(nng::msg &&msg);
 
+		/*
+			Initiate a request with a continuation.
+				The callback is invoked once, on the AIO thread, with the response or an error.
+				The handler is not involved and need not be installed.
+				May fail, throwing nng::exception.
+		*/
+		QueryID request(nng::msg &&msg, ResponseCallback &&callback);
+
+		/*
+			Initiate a request whose response is streamed to the handler.
+				The body is passed to async_response_body as it arrives and is not buffered,
+				so memory use stays constant for large responses.
+				May fail, throwing nng::exception.
+		*/
+		QueryID requestStreaming(nng::msg &&msg);
+
+#if TELLING_COROUTINES
+		/*
+			Initiate a request from a coroutine:  co_await client.send(msg)
+				Resumes on the AIO thread with the response, or throws nng::exception.
+		*/
+		RequestAwaiter<HttpClient> send(nng::msg &&msg)    {return RequestAwaiter<HttpClient>(*this, std::move(msg));}
+#endif
+
+
+		/*
+			Connection pooling.
+				Connections are kept alive after framed responses and reused for later
+				requests, most recent first.  Requests beyond maxConnections wait for a
+				connection to be released.  A request on a reused connection which fails
+				while it is being written is retried once on a new connection.  Once it is
+				written the server may already have run it, so a failure before any
+				response arrives is retried only for idempotent methods (GET, PUT, DELETE...);
+				others, such as POST and PATCH, report the error.
+		*/
+		struct PoolConfig
+		{
+			unsigned maxConnections = 8;     // 0 means unlimited
+			uint32_t idleTimeout_ms = 30000; // Idle connections older than this are not reused
+			bool     keepAlive      = true;  // If false, close connections after each request
+		};
+
+		void       configurePool(const PoolConfig &config);
+		PoolConfig poolConfig() const;
+
+		size_t openConnections() const;
+		size_t idleConnections() const;
+
+
+		/*
+			Process-wide TLS configurations, shared by all clients for a host.
+				The default for a host is client mode with its name set for SNI and
+				certificate checks, and authentication disabled.
+				SetSharedTlsConfig installs a configuration for clients created later.
+		*/
+		static nng::tls::config_view SharedTlsConfig   (std::string_view hostname);
+		static void                  SetSharedTlsConfig(std::string_view hostname, nng::tls::config &&config);
+
 
 		/*
 			Stats implementation
@@ -116,8 +187,8 @@ namespace telling
 
 
 	protected:
-		nng::http::client client;
-		nng::tls::config  tls;
+		nng::http::client     client;
+		nng::tls::config_view tls; // Owned by the shared cache
 
 		std::weak_ptr<Handler> _handler;
 
@@ -127,6 +198,13 @@ namespace telling
 			CONNECT = 1,
 			SEND    = 2,
 			RECV    = 3,
+			WAIT    = 4, // Waiting for a pooled connection
+		};
+
+		struct PooledConn
+		{
+			nng::http::conn                       conn;
+			std::chrono::steady_clock::time_point since;
 		};
 
 		struct Action;
@@ -135,6 +213,18 @@ namespace telling
 		mutable std::mutex          mtx;
 		std::unordered_set<Action*> active;
 		std::deque<Action*>         idle;
+
+		PoolConfig                  pool;
+		std::deque<PooledConn>      pooledConns;
+		std::deque<Action*>         waiting;
+		size_t                      connCount = 0; // Connections open or being opened
+
+		// These are called with mtx locked.
+		Action *_acquire();                              // Get an idle action or create a new one.
+		void    _start      (Action*);                   // Find a connection and send the request.
+		void    _send       (Action*);                   // Write the request on the action's connection.
+		void    _releaseConn(nng::http::conn &&conn);    // Pool a connection or pass it on.
+		void    _dropConn   ();                          // A connection closed or failed to open.
 	};
 
 
@@ -154,6 +244,11 @@ namespace telling
 		*/
 		std::future<nng::msg> request(nng::msg &&req);
 
+		/*
+			Continuation-style requests bypass the future machinery.
+		*/
+		using HttpClient::request;
+
 
 	protected:
 		class Delegate;
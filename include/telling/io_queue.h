@@ -1,14 +1,65 @@
 #pragma once
 
-#include <deque>
+#include <vector>
 #include <mutex>
+#include <utility>
 #include <nngpp/msg.h>
 #include <nngpp/aio.h>
 #include <nngpp/ctx.h>
 
+#include "alloc_tracking.h"
+
 
 namespace telling
 {
+	/*
+		FIFO ring buffer which doubles its capacity as needed and never shrinks.
+			Unlike std::deque, a queue in steady state does not allocate.
+			Popped slots are reset to T(), releasing what they held.
+	*/
+	template<typename T>
+	class RingQueue
+	{
+	public:
+		bool   empty() const noexcept    {return !_size;}
+		size_t size () const noexcept    {return _size;}
+
+		T       &front()       noexcept    {return _slots[_head];}
+		const T &front() const noexcept    {return _slots[_head];}
+
+		void push_back(T &&value)
+		{
+			if (_size == _slots.size()) _grow();
+			_slots[(_head + _size) & (_slots.size()-1)] = std::move(value);
+			++_size;
+		}
+		template<class... Args>
+		void emplace_back(Args&&... args)    {push_back(T(std::forward<Args>(args)...));}
+
+		void pop_front() noexcept
+		{
+			_slots[_head] = T();
+			_head = (_head+1) & (_slots.size()-1);
+			--_size;
+		}
+
+		void clear() noexcept    {while (_size) pop_front();}
+
+	private:
+		std::vector<T> _slots; // Size is zero or a power of two
+		size_t         _head = 0, _size = 0;
+
+		void _grow()
+		{
+			std::vector<T> slots(_slots.empty() ? 8 : 2*_slots.size());
+			for (size_t i = 0; i < _size; ++i)
+				slots[i] = std::move(_slots[(_head + i) & (_slots.size()-1)]);
+			_slots.swap(slots);
+			_head = 0;
+		}
+	};
+
+
 	/*
 		A message queue which also manages some asynchronous message handler.
 			When producing 
@@ -22,6 +73,7 @@ namespace telling
 		*/
 		void push(T &&msg)
 		{
+			TELLING_ALLOC_STAGE(QUEUE);
 			std::lock_guard<std::mutex> g(mtx);
 			deq.emplace_back(std::move(msg));
 		}
@@ -39,6 +91,24 @@ namespace telling
 			return true;
 		}
 
+		/*
+			Dequeue up to `max` messages at once, passing each to a functor.
+				The functor is called under the queue's lock and should be quick.
+				Returns the number of messages dequeued.
+		*/
+		template<class Fn>
+		size_t pull_n(size_t max, Fn &&fn)
+		{
+			std::lock_guard<std::mutex> g(mtx);
+			size_t n = 0;
+			for (; n < max && !deq.empty(); ++n)
+			{
+				fn(std::move(deq.front()));
+				deq.pop_front();
+			}
+			return n;
+		}
+
 		/*
 			Purge all messages from the queue.
 		*/
@@ -59,7 +129,7 @@ namespace telling
 		
 	private:
 		std::mutex    mtx;
-		std::deque<T> deq;
+		RingQueue<T>  deq;
 	};
 
 	using RecvQueueMtx = RecvQueueMtx_<nng::msg>;
@@ -79,6 +149,7 @@ namespace telling
 		*/
 		bool produce(T &&msg)
 		{
+			TELLING_ALLOC_STAGE(QUEUE);
 			std::lock_guard<std::mutex> g(mtx);
 			if (_busy)
 			{
@@ -132,7 +203,7 @@ namespace telling
 		
 	private:
 		std::mutex    mtx;
-		std::deque<T> deq;
+		RingQueue<T>  deq;
 		bool          _busy = false;
 	};
 
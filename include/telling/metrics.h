@@ -0,0 +1,69 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <nngpp/nngpp.h>
+
+#include "histogram.h"
+
+
+namespace telling
+{
+	/*
+		Lock-free message counters for a communicator or route.
+			Each update is a few relaxed atomics; concurrent readings are approximate.
+			Copies start empty, so communicators sharing a socket count separately.
+
+		latency is the handler time for replies and the round-trip time for requests.
+			Its histogram is allocated by the first sample, so idle communicators stay small.
+	*/
+	class CommMetrics
+	{
+	public:
+		struct Snapshot
+		{
+			uint64_t sent, received;
+			uint64_t bytesSent, bytesReceived;
+			uint64_t errors;
+			uint64_t latencyCount, latency_p50, latency_p99, latency_max; // Microseconds
+		};
+
+
+	public:
+		CommMetrics() noexcept                      {}
+		CommMetrics(const CommMetrics&) noexcept    : CommMetrics() {}
+		void operator=(const CommMetrics&) = delete;
+		~CommMetrics()                              {delete _latency.load(std::memory_order_relaxed);}
+
+		void countSend (size_t bytes) noexcept    {_sent.fetch_add(1, std::memory_order_relaxed); _bytesSent.fetch_add(bytes, std::memory_order_relaxed);}
+		void countRecv (size_t bytes) noexcept    {_recv.fetch_add(1, std::memory_order_relaxed); _bytesRecv.fetch_add(bytes, std::memory_order_relaxed);}
+		void countError()             noexcept    {_errors.fetch_add(1, std::memory_order_relaxed);}
+
+		void countSend(const nng_msg *msg) noexcept    {countSend(msg ? nng_msg_len(msg) : 0);}
+		void countRecv(const nng_msg *msg) noexcept    {countRecv(msg ? nng_msg_len(msg) : 0);}
+
+		void recordLatency     (uint64_t micros)                        noexcept    {if (auto *h = _histogram()) h->record(micros);}
+		void recordLatencySince(LatencyHistogram::Clock::time_point t) noexcept    {if (auto *h = _histogram()) h->recordSince(t);}
+
+		// Null until a latency is recorded.
+		const LatencyHistogram *latency() const noexcept    {return _latency.load(std::memory_order_acquire);}
+
+		Snapshot snapshot() const noexcept;
+		void     reset()          noexcept;
+
+		// Heap bytes owned, beyond sizeof(CommMetrics).
+		size_t footprint() const noexcept    {return latency() ? sizeof(LatencyHistogram) : 0;}
+
+		// Write a snapshot as a JSON object.
+		static void WriteJSON(std::ostream &out, const Snapshot &snapshot);
+
+
+	private:
+		std::atomic<uint64_t> _sent = 0, _recv = 0, _bytesSent = 0, _bytesRecv = 0, _errors = 0;
+		std::atomic<LatencyHistogram*> _latency = nullptr;
+
+		LatencyHistogram *_histogram() noexcept;
+	};
+}
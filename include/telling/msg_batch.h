@@ -0,0 +1,84 @@
+#pragma once
+
+
+#include <vector>
+#include <nngpp/msg.h>
+
+#include "async.h"
+#include "msg_view.h"
+
+
+namespace telling
+{
+	/*
+		A batch of messages parsed together, for services which poll.
+			Layouts are kept in one contiguous array of 8-byte MsgLayout records,
+			with columns of method and content length alongside for bulk dispatch.
+			Views are made from the stored layouts without parsing again.
+
+		Messages which fail to parse stay in the batch with an invalid layout,
+			so that indices line up with query IDs.
+	*/
+	class MsgBatch
+	{
+	public:
+		using TYPE = MsgLayout::TYPE;
+
+	public:
+		explicit MsgBatch(TYPE type = TYPE::UNKNOWN) noexcept    : _type(type) {}
+
+		void   clear  () noexcept;
+		void   reserve(size_t capacity);
+
+		size_t size   () const noexcept    {return _msgs.size();}
+		bool   empty  () const noexcept    {return _msgs.empty();}
+		size_t errors () const noexcept    {return _errors;}
+
+		/*
+			Parse a message and add it to the batch.
+				Returns false if it could not be parsed.
+		*/
+		bool push(nng::msg &&msg, QueryID id = 0);
+
+
+		/*
+			Columns, each with size() elements.
+		*/
+		const MsgLayout  *layouts       () const noexcept    {return _layouts.data();}
+		const MethodCode *methods       () const noexcept    {return _methods.data();}
+		const uint32_t   *contentLengths() const noexcept    {return _lengths.data();}
+		const QueryID    *queryIDs      () const noexcept    {return _ids    .data();}
+
+		/*
+			Access individual messages.
+		*/
+		bool             valid  (size_t i) const noexcept    {return _layouts[i]._type() != TYPE::UNKNOWN;}
+		MsgView          view   (size_t i) const noexcept    {return MsgView(_msgs[i], _layouts[i]);}
+		std::string_view uri    (size_t i) const noexcept;
+		QueryID          id     (size_t i) const noexcept    {return _ids[i];}
+		nng::msg        &msg    (size_t i)       noexcept    {return _msgs[i];}
+		nng::msg         release(size_t i)       noexcept    {return std::move(_msgs[i]);}
+
+		/*
+			Collect indices of valid messages whose URI starts with the prefix.
+				Appends to `indices` and returns the number found.
+		*/
+		size_t selectPrefix(std::string_view prefix, std::vector<uint32_t> &indices) const;
+
+
+	public:
+		// Used by communicators: append raw messages, then parse them together.
+		void _append(nng::msg &&msg, QueryID id = 0)    {_msgs.push_back(std::move(msg)); _ids.push_back(id);}
+		void _parse (size_t first);
+
+
+	private:
+		TYPE                    _type;
+		size_t                  _errors = 0;
+		std::vector<nng::msg>   _msgs;
+		std::vector<QueryID>    _ids;
+		std::vector<MsgLayout>  _layouts;
+		std::vector<MethodCode> _methods;
+		std::vector<uint32_t>   _lengths;
+	};
+}
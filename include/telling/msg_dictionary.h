@@ -0,0 +1,94 @@
+#pragma once
+
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+
+namespace telling
+{
+	/*
+		Header dictionary for compressed binary framing.
+			Headers found in the dictionary are sent as an index instead of their text:
+			a whole name-value pair as one varint, or an indexed name followed by its value.
+			Index space begins with the built-in static table, followed by the dictionary's entries.
+
+		Dictionaries are shared, not per-connection.  SP sockets pick pipes for
+			each message, fan messages out, drop them under backpressure and resend
+			requests, and the Server relays between pipes; so both ends of a pipe
+			never see the same ordered stream an HPACK-style dynamic table needs.
+			Instead, every process reading the messages, including the Server,
+			registers the same dictionaries.  Messages name their dictionary by ID
+			and fingerprint, and a reader without a matching one rejects them.
+	*/
+	class HeaderDictionary
+	{
+	public:
+		struct Entry
+		{
+			std::string name;
+			std::string value; // Empty for a name-only entry
+		};
+
+		static constexpr size_t MaxEntries = 4096;
+
+
+	public:
+		/*
+			The static table (ID 0), which needs no registration.
+		*/
+		static const HeaderDictionary &Static() noexcept;
+
+		/*
+			Register a dictionary under an ID from 1 to 255, for the life of the process.
+				Registering identical entries again returns the existing dictionary.
+				Throws nng::exception if the ID holds different entries, or on too many entries.
+		*/
+		static const HeaderDictionary &Register(uint8_t id, std::vector<Entry> entries);
+
+		// Look up a registered dictionary, or null.
+		static const HeaderDictionary *Find(uint8_t id) noexcept;
+
+
+	public:
+		const uint8_t  id;
+		const uint16_t fingerprint;
+
+		// Number of indices, including the static table.
+		size_t size() const noexcept;
+
+		// The entry at an index, or null if out of range.
+		const Entry *at(size_t index) const noexcept;
+
+		/*
+			Find a header.  Returns the index of the matching pair, or else of the name, or -1.
+				`exact` reports whether the value matched too.
+		*/
+		int64_t find(std::string_view name, std::string_view value, bool &exact) const noexcept;
+
+
+	private:
+		struct PairHash
+		{
+			size_t operator()(const std::pair<std::string_view, std::string_view> &p) const noexcept
+			{
+				std::hash<std::string_view> h;
+				return h(p.first) * 31 + h(p.second);
+			}
+		};
+
+		const size_t             _base; // Index of the first entry (after the static table)
+		const std::vector<Entry> _entries;
+
+		std::unordered_map<std::string_view, uint32_t>                                     _names;
+		std::unordered_map<std::pair<std::string_view, std::string_view>, uint32_t, PairHash> _pairs;
+
+		HeaderDictionary(uint8_t id, size_t base, std::vector<Entry> &&entries);
+
+		static uint16_t Fingerprint(const std::vector<Entry> &entries) noexcept;
+	};
+}
@@ -5,6 +5,7 @@
 #include <nngpp/msg.h>
 
 #include "msg_util.h"
+#include "msg_dictionary.h"
 
 
 namespace telling
@@ -36,6 +37,8 @@ namespace telling
 
 	/*
 		A class for reading HTTP-formatted message headers.
+			Binary headers are a table of length-prefixed names and values (see detail::BinaryMagic).
+			With a dictionary, entries may instead be indices into it.
 	*/
 	class MsgHeaders
 	{
@@ -43,38 +46,63 @@ namespace telling
 		class iterator
 		{
 		public:
-			iterator(const char *p, const char *e)      : end(e) {setp(p);}
-			bool operator==(const iterator &o) const    {return getp()==o.getp();}
-			bool operator!=(const iterator &o) const    {return getp()!=o.getp();}
-			iterator& operator++()                      {auto *p = getp(); detail::ConsumeLine(p, end); setp(p); return *this;}
+			iterator(const char *p, const char *e, bool b = false, const HeaderDictionary *d = nullptr)    : end(e), binary(b), dictionary(d) {setp(p);}
+			bool operator==(const iterator &o) const    {return pos==o.pos;}
+			bool operator!=(const iterator &o) const    {return pos!=o.pos;}
+			iterator& operator++()                      {setp(next); return *this;}
 
 			const MsgHeaderView& operator* () const    {return header;}
 			const MsgHeaderView* operator->() const    {return &this->operator*();}
 
 		private:
 			mutable MsgHeaderView header;
-			const char *end;
+			const char *pos, *next, *end;
+			bool binary;
+			const HeaderDictionary *dictionary;
 
-			const char *getp() const           {return header.name.data();}
-			void        setp(const char *p)
+			void setp(const char *p)
 			{
 				header = MsgHeaderView();
-				if (p < end) {const char *tmp = p; header = MsgHeaderView(detail::ConsumeLine(tmp, end));}
+				pos = next = p;
+				if (p >= end) {header.name = std::string_view(p, 0); return;}
+
+				if      (!binary)    header = MsgHeaderView(detail::ConsumeLine(next, end));
+				else if (dictionary) {if (!readIndexed()) next = end;}
+				else if (!detail::ReadBinaryString(next, end, header.name) || !detail::ReadBinaryString(next, end, header.value))
+					next = end;
 				if (!header.name.length()) header.name = std::string_view(p, 0);
 			}
+
+			bool readIndexed()
+			{
+				uint64_t code;
+				if (!detail::ReadVarint(next, end, code)) return false;
+				if (code == 0) return detail::ReadBinaryString(next, end, header.name) && detail::ReadBinaryString(next, end, header.value);
+
+				auto *entry = dictionary->at((code-1) / 2);
+				if (!entry) return false;
+				header.name = entry->name;
+				if (code & 1) {header.value = entry->value; return true;}
+				return detail::ReadBinaryString(next, end, header.value);
+			}
 		};
 
 	public:
-		MsgHeaders(std::string_view string) : _string(string) {}
+		MsgHeaders(std::string_view string, bool binary = false, const HeaderDictionary *dictionary = nullptr) :
+			_string(string), _binary(binary), _dictionary(dictionary) {}
 
-		iterator begin() const noexcept    {return iterator(_string.data(), _string.data()+_string.length());}
-		iterator end  () const noexcept    {auto e = _string.data()+_string.length(); return iterator(e, e);}
+		iterator begin() const noexcept    {return iterator(_string.data(), _string.data()+_string.length(), _binary, _dictionary);}
+		iterator end  () const noexcept    {auto e = _string.data()+_string.length(); return iterator(e, e, _binary, _dictionary);}
 
 		size_t           length() const noexcept    {return _string.length();}
 		std::string_view string() const noexcept    {return _string;}
+		bool             binary() const noexcept    {return _binary;}
 
 	private:
 		std::string_view _string;
+		bool             _binary;
+
+		const HeaderDictionary *_dictionary;
 	};
 
 
@@ -45,9 +45,13 @@ namespace telling
 		void _parse_msg(nng::view, TYPE = TYPE::UNKNOWN);
 		void _parse_reset() noexcept    {*this = {};}
 
+		// Parse a message in binary framing (see detail::BinaryMagic).
+		void _parse_binary(nng::view, TYPE = TYPE::UNKNOWN);
+
 		// Classify message type.
 		TYPE _type() const
 		{
+			if (_binary())       return TYPE(_prt_rpos-1);
 			if (_has_method())   return TYPE::REQUEST; // Only requests have method
 			if (_has_uri())      return TYPE::REPORT;  // Only reports have URI but no method
 			if (_has_protocol()) return TYPE::REPLY;   // Only replies have status but no URI
@@ -69,6 +73,14 @@ namespace telling
 		bool _has_status()   const noexcept    {return _sts_rpos >= 3;}
 		bool _has_reason()   const noexcept    {return _sts_rpos > 4;}
 
+		/*
+			Binary framing has no newline after its start elements.
+				The header table follows them, and the start-line accessors above don't apply.
+		*/
+		bool   _binary()         const noexcept    {return !_sl_nl && _prt_rpos;}
+		bool   _binaryIndexed()  const noexcept    {return _sts_rpos;} // Header table uses a HeaderDictionary
+		size_t _binaryUriField() const noexcept    {return _uri_pos;} // Offset of the URI's length, or 0
+
 
 	public: // 64-bit representation of message structure
 
@@ -84,10 +96,15 @@ namespace telling
 			const char       *third_elem  = nullptr,
 			const char       *fourth_elem = nullptr);
 
+		// Design binary framing, given the offsets of the header table and the body.
+		void _setBinary(TYPE type, size_t tableOffset, size_t bodyOffset, bool indexed) noexcept;
+
 	private:
 		// Lengths of start-line components, including space where suffixed
 		uint16_t _sl_len;
 		uint8_t _uri_pos, _prt_rpos, _sts_rpos, _sl_nl;
 		// TODO: _prt_rpos is 0 for "GET x "
+		// In binary framing, _sl_nl is 0, _prt_rpos is the type plus one, _uri_pos locates the URI
+		//   and _sts_rpos is 1 if headers are indexed.
 	};
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ namespace telling
 		Http_1_0 = 2,
 		Http_1_1 = 3,
 		Http     = 3,
+		Binary   = 4, // Compact framing for in-process and IPC peers (see detail::BinaryMagic)
 	};
 
 
@@ -34,13 +35,14 @@ namespace telling
 		std::string_view   toString()        const noexcept;
 
 		// Check method validity
-		explicit operator bool() const noexcept    {return code > MsgProtocolCode::None && code <= MsgProtocolCode::Http;}
+		explicit operator bool() const noexcept    {return code > MsgProtocolCode::None && code <= MsgProtocolCode::Binary;}
 
 		// Properties...
 		std::string_view  preferred_newline() const noexcept    {return (code <= MsgProtocolCode::Telling) ? "\n" : "\r\n";}
 
 
-		bool is_http() const noexcept    {return code==MsgProtocolCode::Http_1_0 || code==MsgProtocolCode::Http_1_1;}
+		bool is_http()   const noexcept    {return code==MsgProtocolCode::Http_1_0 || code==MsgProtocolCode::Http_1_1;}
+		bool is_binary() const noexcept    {return code==MsgProtocolCode::Binary;}
 	};
 
 	/*
@@ -50,7 +52,8 @@ namespace telling
 		Http_1_0 = MsgProtocolCode::Http_1_0,
 		Http_1_1 = MsgProtocolCode::Http_1_1,
 		Http     = MsgProtocolCode::Http,
-		Telling  = MsgProtocolCode::Telling;
+		Telling  = MsgProtocolCode::Telling,
+		TellingBinary = MsgProtocolCode::Binary;
 	
 
 	inline std::string_view MsgProtocol::toString() const noexcept
@@ -60,6 +63,7 @@ namespace telling
 			case MsgProtocolCode::Telling:  return "Tell/0";
 			case MsgProtocolCode::Http_1_0: return "HTTP/1.0";
 			case MsgProtocolCode::Http_1_1: return "HTTP/1.1";
+			case MsgProtocolCode::Binary:   return "Tell/0b";
 
 			case MsgProtocolCode::None:     return "NoProtocol";
 			default:
@@ -75,6 +79,7 @@ namespace telling
 		if      (v[0] == 'T')
 		{
 			if (v == "Tell/0")   return MsgProtocolCode::Telling;
+			if (v == "Tell/0b")  return MsgProtocolCode::Binary;
 		}
 		else if (v[0] == 'H')
 		{
@@ -1,6 +1,7 @@
 #pragma once
 
 
+#include <cstdint>
 #include <string_view>
 #include <exception>
 
@@ -236,5 +237,100 @@ namespace telling
 		// Extract a line without end-of-data guard
 		template<typename T>
 		inline std::basic_string_view<T> ExtractWord_unsafe(const T* &pos)    {ConsumeWord<T,false>(pos, nullptr);}
+
+
+		/*
+			Binary framing (MsgProtocolCode::Binary):
+				magic    BinaryMagic, a UTF-8 continuation byte, so no text start-line begins with it
+				type     one byte, MsgLayout::TYPE (REPLY=0, REPORT=1, REQUEST=2), plus BinaryIndexed
+				request  method code (one byte), URI
+				report   status (three ASCII digits), URI, reason
+				reply    status (three ASCII digits), reason
+				table    header table size (16-bit little-endian), then name, value, name, value...
+				body     the rest of the message
+			URI, reason, names and values are each a varint length followed by their bytes.
+
+			With BinaryIndexed, the table begins with a dictionary ID (one byte) and, unless it
+				is 0, the dictionary's 16-bit fingerprint.  Each entry then begins with a varint:
+				0 for a literal name and value, 2i+1 for pair i, or 2i+2 for name i and a value.
+				See HeaderDictionary.
+		*/
+		static constexpr uint8_t BinaryMagic   = 0xB1;
+		static constexpr uint8_t BinaryIndexed = 0x80;
+		static constexpr size_t  MaxVarintSize = 10;
+
+		inline bool IsBinaryFrame(const void *data, size_t size) noexcept    {return size && *static_cast<const uint8_t*>(data) == BinaryMagic;}
+
+		// Write a LEB128 varint; returns its size.
+		inline size_t WriteVarint(char *out, uint64_t value) noexcept
+		{
+			size_t n = 0;
+			while (value >= 0x80) {out[n++] = char(uint8_t(value) | 0x80); value >>= 7;}
+			out[n++] = char(value);
+			return n;
+		}
+
+		// Read a LEB128 varint.  Returns false if it is truncated or too long.
+		inline bool ReadVarint(const char* &pos, const char *end, uint64_t &value) noexcept
+		{
+			value = 0;
+			for (unsigned shift = 0; pos < end && shift < 7*MaxVarintSize; shift += 7)
+			{
+				uint8_t b = uint8_t(*pos++);
+				value |= uint64_t(b & 0x7F) << shift;
+				if (!(b & 0x80)) return true;
+			}
+			return false;
+		}
+
+		// Read a length-prefixed string.  Returns false if it overruns the end.
+		inline bool ReadBinaryString(const char* &pos, const char *end, std::string_view &s) noexcept
+		{
+			uint64_t length;
+			if (!ReadVarint(pos, end, length) || length > uint64_t(end - pos)) return false;
+			s = std::string_view(pos, size_t(length));
+			pos += length;
+			return true;
+		}
+
+		/*
+			Skip a binary frame's magic, type and start elements, stopping at the header table size.
+				Returns false if they are malformed or incomplete.
+		*/
+		inline bool SkipBinaryStart(const char* &pos, const char *end) noexcept
+		{
+			if (end - pos < 3 || uint8_t(pos[0]) != BinaryMagic) return false;
+
+			std::string_view s;
+			switch (uint8_t(pos[1]) & ~BinaryIndexed)
+			{
+			case 2: // Method, URI
+				pos += 3;
+				return ReadBinaryString(pos, end, s);
+			case 1: // Status, URI, reason
+				if (end - pos < 5) return false;
+				pos += 5;
+				return ReadBinaryString(pos, end, s) && ReadBinaryString(pos, end, s);
+			case 0: // Status, reason
+				if (end - pos < 5) return false;
+				pos += 5;
+				return ReadBinaryString(pos, end, s);
+			default:
+				return false;
+			}
+		}
+
+		// Read an indexed header table's dictionary ID and fingerprint.
+		inline bool ReadBinaryDictionary(const char* &pos, const char *end, uint8_t &id, uint16_t &fingerprint) noexcept
+		{
+			if (pos >= end) return false;
+			id = uint8_t(*pos++);
+			fingerprint = 0;
+			if (!id) return true;
+			if (end - pos < 2) return false;
+			fingerprint = uint16_t(uint8_t(pos[0]) | (uint8_t(pos[1]) << 8));
+			pos += 2;
+			return true;
+		}
 	}
 }
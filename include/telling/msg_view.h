@@ -30,6 +30,8 @@ namespace telling
 
 	/*
 		MsgView parses a message according to Telling's HTTP-like format.
+			Messages in binary framing (see MsgProtocolCode::Binary) are detected
+			by their first byte and read through the same accessors.
 	*/
 	class MsgView : protected MsgLayout
 	{
@@ -48,6 +50,9 @@ namespace telling
 		MsgView(nng::msg_view _msg)               : msg(_msg) {if (msg) {_parse_msg(msg.body().get());}}
 		MsgView(nng::msg_view _msg, TYPE type)    : msg(_msg) {if (msg) {_parse_msg(msg.body().get(), type);}}
 
+		// View a message with a layout parsed earlier (eg. by MsgBatch).
+		MsgView(nng::msg_view _msg, const MsgLayout &layout) noexcept    : MsgLayout(layout), msg(_msg) {}
+
 		~MsgView() noexcept {}
 
 
@@ -69,23 +74,23 @@ namespace telling
 				headers are an unordered non-unique list of key-value properties based on HTTP headers.
 				data is the content of the message and can be anything (headers may describe it).
 		*/
-		Method           method        () const noexcept    {return Method     ::Parse(  methodString());}
+		Method           method        () const noexcept    {return _binary() ? _binaryMethod() : Method::Parse(methodString());}
 		UriView          uri           () const noexcept    {return UriView(                uriString());}
-		MsgProtocol      protocol      () const noexcept    {return MsgProtocol::Parse(protocolString());}
+		MsgProtocol      protocol      () const noexcept    {return _binary() ? TellingBinary : MsgProtocol::Parse(protocolString());}
 		Status           status        () const noexcept    {return Status     ::Parse(  statusString());}
-		std::string_view reason        () const noexcept    {return _string(_reason());}
+		std::string_view reason        () const noexcept    {return _string(_binary() ? _binaryReason() : _reason());}
 
-		// Raw elements of start-line.
-		std::string_view startLine     () const noexcept    {return _string(_startLine());}
-		std::string_view      uriString() const noexcept    {return _string(_uri());}
-		std::string_view   methodString() const noexcept    {return _string(_method());}
-		std::string_view protocolString() const noexcept    {return _string(_protocol());}
-		std::string_view   statusString() const noexcept    {return _string(_status());}
+		// Raw elements of start-line.  Binary messages have no start-line text.
+		std::string_view startLine     () const noexcept    {return _binary() ? std::string_view() : _string(_startLine());}
+		std::string_view      uriString() const noexcept    {return _string(_binary() ? _binaryUri() : _uri());}
+		std::string_view   methodString() const noexcept    {return _binary() ? (is_request() ? _binaryMethod().toString() : std::string_view()) : _string(_method());}
+		std::string_view protocolString() const noexcept    {return _binary() ? TellingBinary.toString() : _string(_protocol());}
+		std::string_view   statusString() const noexcept    {return _string(_binary() ? _binaryStatus() : _status());}
 
 		/*
 			Access the message headers, which can be iterated over.
 		*/
-		MsgHeaders        headers()    const noexcept    {return MsgHeaders(_string_rem_nl(_headers()));}
+		MsgHeaders        headers()    const noexcept    {return _binary() ? _binaryHeaders() : MsgHeaders(_string_rem_nl(_headers()));}
 
 		/*
 			Access the message body.
@@ -138,6 +143,37 @@ namespace telling
 			if (s.size() && s.back() == '\r') s.remove_suffix(1);
 			return s;
 		}
+
+		// Binary framing; the layout was validated when parsed.
+		Method    _binaryMethod() const noexcept    {return is_request() ? Method(MethodCode(uint8_t(_raw()[2]))) : Method();}
+		HeadRange _binaryStatus() const noexcept    {return is_request() ? HeadRange{0u, 0u} : HeadRange{2u, 3u};}
+		HeadRange _binaryUri   () const noexcept    {return _binaryUriField() ? _binaryField(_binaryUriField()) : HeadRange{0u, 0u};}
+		HeadRange _binaryReason() const noexcept
+		{
+			if (is_request()) return {0u, 0u};
+			HeadRange uri = _binaryUri();
+			return _binaryField(_binaryUriField() ? uri.start + uri.length : 5u);
+		}
+		MsgHeaders _binaryHeaders() const noexcept
+		{
+			auto table = _string(_headers());
+			if (!_binaryIndexed()) return MsgHeaders(table, true);
+
+			// Skip the dictionary ID and fingerprint.
+			const char *pos = table.data();
+			uint8_t  id;
+			uint16_t fingerprint;
+			detail::ReadBinaryDictionary(pos, table.data() + table.size(), id, fingerprint);
+			table.remove_prefix(size_t(pos - table.data()));
+			return MsgHeaders(table, true, HeaderDictionary::Find(id));
+		}
+		HeadRange _binaryField(size_t offset) const noexcept
+		{
+			const char *pos = _raw() + offset;
+			uint64_t length = 0;
+			detail::ReadVarint(pos, _raw() + _p_body, length);
+			return {size_t(pos - _raw()), size_t(length)};
+		}
 	};
 
 
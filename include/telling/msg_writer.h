@@ -7,6 +7,7 @@
 
 #include "msg_util.h"
 #include "msg.h"
+#include "msg_dictionary.h"
 
 #include "msg_status.h"
 #include "msg_method.h"
@@ -15,10 +16,22 @@
 
 namespace telling
 {
+	/*
+		Composes messages in Telling's HTTP-like format.
+			With the TellingBinary protocol, start elements and headers are written in
+			binary framing instead, which is quicker to write and to parse.  Any MsgView
+			reads both, so binary peers interoperate with textual ones through the Server.
+
+			Binary writers may also index headers in a HeaderDictionary, which
+			readers must have registered too.  Text writers ignore the dictionary.
+	*/
 	class MsgWriter : protected Msg
 	{
 	public:
-		MsgWriter(MsgProtocol protocol = Telling);
+		MsgWriter(MsgProtocol protocol = Telling, const HeaderDictionary *dictionary = nullptr);
+
+		// Bytes reserved when a message is started.
+		static constexpr size_t InitialCapacity = 256;
 
 		/*
 			STEP 1: call one of these methods to begin the message.
@@ -39,6 +52,9 @@ namespace telling
 		void writeHeader_Allow (Methods methods);
 		void writeHeader_Length(size_t  maxLength = ~uint32_t(0));
 
+		// Opt into latency tracing (see trace.h).  Must be the first header.
+		void writeHeader_Trace();
+
 
 		/*
 			STEP 3: append body data as desired.
@@ -64,16 +80,23 @@ namespace telling
 
 
 	protected:
-		MsgProtocol protocol;
+		MsgProtocol             protocol;
+		const HeaderDictionary *dictionary;
 
 	private:
+		enum class Indexing : uint8_t {NONE, NAME, PAIR};
+
 		struct
 		{
 			uint16_t lengthOffset, lengthSize;
+			uint16_t tableOffset; // Binary header table size
 		}
 			head = {};
 
 		void _startMsg();
+		void _startBinary(TYPE type, Method method, Status status, std::string_view uri, std::string_view reason);
+		void _writeBinaryHeader(std::string_view name, std::string_view value, Indexing indexing);
+		bool _indexed() const noexcept    {return dictionary && protocol.is_binary();}
 		void _autoCloseHeaders();
 		void _newline();
 	};
@@ -91,4 +114,10 @@ namespace telling
 	inline MsgWriter HttpRequest (std::string_view uri, Method method = MethodCode::GET)           {MsgWriter w=Http; w.startRequest(uri, method);          return w;}
 	inline MsgWriter HttpReply   (                      Status status = StatusCode::OK)            {MsgWriter w=Http; w.startReply(status);                 return w;}
 	inline MsgWriter HttpReply   (                      Status status, std::string_view reason)    {MsgWriter w=Http; w.startReply(status, reason);         return w;}
+
+	inline MsgWriter BinaryRequest(std::string_view uri, Method method = MethodCode::GET)          {MsgWriter w=TellingBinary; w.startRequest(uri, method);        return w;}
+	inline MsgWriter BinaryReply  (                      Status status = StatusCode::OK)           {MsgWriter w=TellingBinary; w.startReply(status);               return w;}
+	inline MsgWriter BinaryReport (std::string_view uri, Status status = StatusCode::OK)           {MsgWriter w=TellingBinary; w.startReport(uri, status);         return w;}
+	inline MsgWriter BinaryReply  (                      Status status, std::string_view reason)   {MsgWriter w=TellingBinary; w.startReply(status, reason);       return w;}
+	inline MsgWriter BinaryReport (std::string_view uri, Status status, std::string_view reason)   {MsgWriter w=TellingBinary; w.startReport(uri, status, reason); return w;}
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <string>
 #include <string_view>
 
 
@@ -34,6 +37,66 @@ namespace telling
 	using PATTERN = Pattern::PATTERN;
 
 
+	/*
+		A set of patterns, such as those a service communicates with.
+			String form is a comma-separated list of pattern names.
+	*/
+	class Patterns
+	{
+	public:
+		using mask_t = uint8_t;
+		mask_t mask = 0;
+
+	public:
+		Patterns()          noexcept    {}
+		Patterns(PATTERN p) noexcept    {insert(p);}
+
+		// The patterns services use.
+		static Patterns All() noexcept    {Patterns p; p.insert(Pattern::REQ_REP); p.insert(Pattern::PUB_SUB); p.insert(Pattern::PUSH_PULL); return p;}
+
+		bool     empty     ()                const noexcept    {return !mask;}
+		void     insert    (PATTERN p)             noexcept    {if (p > Pattern::NO_PATTERN) mask |= mask_t(1u << p);}
+		void     erase     (PATTERN p)             noexcept    {if (p > Pattern::NO_PATTERN) mask &= mask_t(~(1u << p));}
+		bool     contains  (PATTERN p)       const noexcept    {return p > Pattern::NO_PATTERN && ((mask >> p) & 1u);}
+
+		Patterns operator+ (PATTERN p)       const noexcept    {Patterns r(*this); r.insert(p); return r;}
+		Patterns operator- (PATTERN p)       const noexcept    {Patterns r(*this); r.erase (p); return r;}
+		Patterns& operator+=(PATTERN p)            noexcept    {insert(p); return *this;}
+		Patterns& operator-=(PATTERN p)            noexcept    {erase (p); return *this;}
+
+		bool operator==(const Patterns &o)   const noexcept    {return mask == o.mask;}
+		bool operator!=(const Patterns &o)   const noexcept    {return mask != o.mask;}
+
+		std::string toString() const
+		{
+			std::string s;
+			for (int p = 0; p < Pattern::PATTERN_COUNT; ++p) if (contains(PATTERN(p)))
+			{
+				if (s.length()) s += ',';
+				s += Pattern::Name(PATTERN(p));
+			}
+			return s;
+		}
+
+		// Returns an empty set if any name is unrecognized.
+		static Patterns Parse(std::string_view s) noexcept
+		{
+			Patterns result;
+			while (s.length())
+			{
+				auto name = s.substr(0, s.find(','));
+				s.remove_prefix(std::min(s.length(), name.length()+1));
+
+				int p = 0;
+				while (p < Pattern::PATTERN_COUNT && Pattern::Name(PATTERN(p)) != name) ++p;
+				if (p == Pattern::PATTERN_COUNT) return Patterns();
+				result.insert(PATTERN(p));
+			}
+			return result;
+		}
+	};
+
+
 	class Role
 	{
 	public:
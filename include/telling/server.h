@@ -3,11 +3,17 @@
 
 #include <utility>
 #include <memory>
+#include <chrono>
+#include <ostream>
 #include <thread>
 #include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <map>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <atomic>
 #include <nngpp/nngpp.h>
 #include <tsl/htrie_map.h>
 #include <life_lock.hpp>
@@ -15,6 +21,9 @@
 #include "host_address.h"
 #include "io_queue.h"
 #include "msg_view.h"
+#include "histogram.h"
+#include "trace.h"
+#include "server_log.h"
 
 #include "socket.h"
 
@@ -45,7 +54,7 @@ namespace telling
 	public:
 		/*
 			Create a server.
-				log -- optional logging stream
+				log -- optional logging stream, written by a background thread
 				ID  -- in-proc hostname, also used for registration and internals
 				open_inproc -- if true, immediately open server to inproc clients.
 		*/
@@ -63,6 +72,70 @@ namespace telling
 		void close(const HostAddress::Base &);
 
 
+		/*
+			HTTP/1.1 gateway.
+				Accepts HTTP connections at a stream URL such as "tcp://0.0.0.0:8080".
+				An HTTP request is already a valid Request, so its bytes are routed unchanged.
+				Replies return in request order, with keep-alive and pipelining.
+				Replies that are not already HTTP are given an HTTP/1.1 head.
+		*/
+		struct HttpConfig
+		{
+			size_t   maxInFlight       = 1024;    // Requests awaiting replies, over all connections; more get 503
+			size_t   maxPipeline       = 16;      // Requests awaiting replies before a connection stops reading
+			size_t   maxConnections    = 4096;    // Further connections are closed on accept
+			size_t   maxRequestSize    = 1 << 20; // Larger requests get 413 and the connection closes
+			unsigned idleTimeout_ms    = 60000;   // Close connections with no requests for this long
+			unsigned requestTimeout_ms = 30000;   // Routed requests unanswered this long get 504; 0 waits forever
+		};
+
+		// Open an HTTP gateway.  Throws nng::exception on failure.
+		void openHttp (const std::string &url)    {openHttp(url, HttpConfig());}
+		void openHttp (const std::string &url, const HttpConfig &config);
+		void closeHttp(const std::string &url);
+
+
+		/*
+			Several instances of a service may register under the same URI.
+				Each registers with its own address (line 2 of the registration body)
+				and requests are balanced across the instances that are connected.
+				An instance is removed when its registration pipe disconnects.
+		*/
+		struct Balancing
+		{
+			enum STRATEGY
+			{
+				ROUND_ROBIN,       // Each replica in turn
+				LEAST_OUTSTANDING, // The replica with the fewest unanswered requests
+				CONSISTENT_HASH,   // The replica owning the request's key on a hash ring
+			};
+
+			STRATEGY    strategy     = ROUND_ROBIN;
+			std::string hashHeader;        // Key for CONSISTENT_HASH; if empty or absent, the URI after the route path
+			unsigned    virtualNodes = 64; // Points per replica on the hash ring
+			uint32_t    lostAfter_ms = 30000; // LEAST_OUTSTANDING stops counting requests unanswered this long
+		};
+
+		/*
+			Set how requests to a service URI are balanced.
+				Applies to the current replicas and to later registrations.
+		*/
+		void balance(std::string_view uri, const Balancing &balancing);
+
+
+		/*
+			Runtime metrics: message counters and latency histograms for the server's
+				communicators and for each replica of each route.
+				serveMetrics registers a built-in "*metrics" service which answers GET
+				with a JSON snapshot.  If reportPeriod is nonzero the snapshot is also
+				published to the "*metrics" topic at that period.  Call again to change it.
+		*/
+		void serveMetrics(std::chrono::milliseconds reportPeriod = std::chrono::milliseconds(0));
+
+		// Write a JSON snapshot of the server's metrics.
+		void writeMetrics(std::ostream &out);
+
+
 	public:
 		// In-process ID
 		const std::string ID;
@@ -73,7 +146,174 @@ namespace telling
 
 
 	private:
-		std::ostream &log;
+		class RequestQueue;
+
+		using PipeID = decltype(std::declval<nng_pipe>().id);
+
+
+	public:
+		/*
+			Quality of service for routed requests.
+				Requests are sorted into priority classes by a "Priority" header
+				naming a class (or giving its index) or by URI prefix.
+				Class 0 has the highest priority.
+
+			Admission: a request is refused with 503 when its route already has
+				its class's queueLimit requests waiting.  Give lower classes smaller
+				limits so they are shed before higher classes start to wait.
+
+			Scheduling across the classes waiting on a route:
+				STRICT   -- always send from the highest waiting class.
+				WEIGHTED -- send up to `weight` requests from each class in turn.
+		*/
+		class QoS
+		{
+		public:
+			static constexpr unsigned MaxClasses = 8;
+
+			enum class Scheduling
+			{
+				STRICT,
+				WEIGHTED,
+			};
+
+			struct Class
+			{
+				std::string name;
+				unsigned    weight     = 1;
+				size_t      queueLimit = 0; // 0 means unlimited
+			};
+
+			struct Config
+			{
+				std::vector<Class> classes; // Empty means one unlimited class (FIFO).
+				Scheduling         scheduling   = Scheduling::STRICT;
+				unsigned           defaultClass = 0;
+				bool               useHeader    = true; // Honor "Priority" headers
+
+				// URI prefix -> class.  The longest matching prefix wins.
+				std::vector<std::pair<std::string, unsigned>> prefixes;
+
+				// Classes "high", "normal" (default) and "low" with limits 4096, 1024 and 256.
+				static Config Standard();
+			};
+
+			struct Report
+			{
+				std::string name;
+				size_t      depth;              // Requests waiting, over all routes
+				uint64_t    admitted, shed;
+				uint64_t    wait_p50, wait_p99; // Queue wait in microseconds
+				uint64_t    wait_max;
+			};
+
+
+		public:
+			QoS();
+
+			// Replace the configuration.  Throws nng::exception if it is invalid.
+			void configure(const Config &config);
+
+			// Choose a class for a request.
+			unsigned classify(const MsgView::Request &request) const;
+
+			// Statistics for each configured class.
+			std::vector<Report> report() const;
+			void                report(std::ostream &out) const;
+
+
+		protected:
+			friend class RequestQueue;
+
+			struct Policy
+			{
+				Scheduling scheduling;
+				unsigned   count;
+				unsigned   weight[MaxClasses];
+				size_t     limit [MaxClasses];
+			};
+			struct Stats
+			{
+				std::atomic<size_t>   depth    = 0;
+				std::atomic<uint64_t> admitted = 0, shed = 0;
+				LatencyHistogram      wait;
+			};
+
+			mutable std::shared_mutex _mtx;
+			Config                    _config;
+			Policy                    _policy;
+			PrefixMap<unsigned>       _prefixes;
+			Stats                     _stats[MaxClasses];
+
+			Policy _getPolicy() const    {std::shared_lock g(_mtx); return _policy;}
+		}
+			qos;
+
+
+		/*
+			Latency tracing for requests which carry a Trace header (see trace.h).
+				While enabled, the server stamps traced requests as it receives and
+				routes them, and each traced reply it relays is recorded by segment:
+
+				relay   -- client send to server receipt, through the relay device
+				routing -- route lookup, QoS queueing and the replica's send lock
+				deliver -- server send to service receipt
+				service -- the service's handling of the request
+				return  -- service reply to server relay
+				total   -- client send to server relay
+		*/
+		class Tracing
+		{
+		public:
+			struct Report
+			{
+				const char *segment;
+				uint64_t    count;
+				uint64_t    p50, p99, max; // Microseconds
+			};
+
+		public:
+			void enable(bool on = true) noexcept    {_enabled.store(on, std::memory_order_relaxed);}
+			bool enabled() const noexcept           {return _enabled.load(std::memory_order_relaxed);}
+
+			// Add a relayed reply's stamps to the histograms.
+			void record(const Trace::Stamps &stamps) noexcept;
+			void reset() noexcept;
+
+			// Statistics for each segment.
+			std::vector<Report> report() const;
+			void                report(std::ostream &out) const;
+
+
+		protected:
+			std::atomic<bool> _enabled = false;
+			LatencyHistogram  _segments[Trace::HOP_COUNT]; // [0] is the total; [i] ends at hop i
+		}
+			trace;
+
+
+		/*
+			Structured, asynchronous log (see server_log.h).
+				Disabled when the server is created without a log stream.
+		*/
+		ServerLog log;
+
+
+	private:
+		class HttpGateway;
+
+		std::mutex                          http_mtx;
+		std::map<std::string, HttpGateway*> http;
+
+		static void _deleteHttp(HttpGateway*);
+
+		class MetricsService;
+
+		std::mutex      metrics_mtx;
+		MetricsService *metricsService = nullptr;
+
+		static void _deleteMetrics(MetricsService*);
+		std::string _metricsJSON();
 
 		/*
 			...
@@ -103,6 +343,8 @@ namespace telling
 			static const char *Name()    {return "*PUB";}
 			Socket &hostSocket()         {return *publish.socket();}
 
+			void writeMetrics(std::ostream &out) const;
+
 		protected:
 			friend class Services; // for now
 			
@@ -132,6 +374,8 @@ namespace telling
 			static const char *Name()    {return "*PULL";}
 			Socket &hostSocket()         {return *pull.socket();}
 
+			void writeMetrics(std::ostream &out) const;
+
 		protected:
 			Server &server;
 			
@@ -151,7 +395,8 @@ namespace telling
 		class ReqRep;
 		class ClientRequesting : public TagSend<void> {};
 		class ServerResponding : public TagSend<void> {};
-		class ServiceReplying {};
+		class Replica;
+		class ServiceReplying {public: Replica *replica = nullptr;};
 
 		class ReqRep :
 			public AsyncRecv<ClientRequesting>,
@@ -166,6 +411,8 @@ namespace telling
 			static const char *Name()    {return "*REP";}
 			Socket &hostSocket()         {return reply_ext;}
 
+			void writeMetrics(std::ostream &out) const;
+
 
 		protected:
 			Server &server;
@@ -175,6 +422,10 @@ namespace telling
 				request_dvc, // connects int and ext with a device
 				reply_int;   // <--> services
 
+			// Client requests in and replies out; requests which could not be routed.
+			CommMetrics           metrics;
+			std::atomic<uint64_t> routeNotFound = 0, routeUnavailable = 0;
+
 			// I/O handling for replies
 			edb::life_locked<AsyncSendQueue<ServerResponding>> rep_sendQueue;
 			AsyncSendLoop   <ServerResponding>                 rep_send;
@@ -198,48 +449,187 @@ namespace telling
 
 
 		/*
-			Connection to a Service.
-				Services class manages the routing table.
+			Route request queue with one FIFO per QoS class.
 		*/
-		class Route
+		class RequestQueue : public AsyncSend<ClientRequesting>
 		{
 		public:
-			Server            &server;
-			const std::string  path;
+			enum ADMIT
+			{
+				SEND_NOW, // Nothing is sending; the caller should send the message.
+				QUEUED,   // The message was queued.
+				SHED,     // The class's queue limit was reached; the message was not taken.
+			};
+
+			RequestQueue(QoS &_qos, Tracing &_trace, CommMetrics &_metrics)    : qos(_qos), trace(_trace), metrics(_metrics) {}
+			~RequestQueue() override;
+
+			ADMIT admit(unsigned priority, nng::msg &msg);
+
+			// Requests waiting to be sent.
+			size_t depth();
+
+			// Call if a message admitted with SEND_NOW could not be sent.
+			void abandon() noexcept;
+
+			void async_prep (ClientRequesting,     nng::msg &msg) override    {_stampSend(msg);}
+			void async_sent (ClientRequesting tag)                override    {_sendNext(tag);}
+			void async_error(ClientRequesting tag, AsyncError e)  override    {if (e != nng::error::canceled) _sendNext(tag);}
+
+		private:
+			struct Waiting
+			{
+				nng::msg                            msg;
+				LatencyHistogram::Clock::time_point since;
+			};
+
+			QoS                &qos;
+			Tracing            &trace;
+			CommMetrics        &metrics; // Queue wait is recorded as latency
+			std::mutex          mtx;
+			RingQueue<Waiting>  queues[QoS::MaxClasses];
+			size_t              waiting = 0;
+
+			// Stamp ROUTE_SEND on a request leaving directly (async_prep) or from the queue (_sendNext).
+			void _stampSend(nng::msg &msg) noexcept    {if (trace.enabled()) Trace::Stamp(msg, Trace::ROUTE_SEND);}
+			unsigned            cursor  = 0, credit[QoS::MaxClasses] = {};
+			bool                busy    = false;
+
+			void _sendNext(ClientRequesting tag);
+		};
+
+
+		/*
+			Connection to one instance of a service.
+		*/
+		class Replica
+		{
+		public:
+			Server                  &server;
+			const PipeID             registration; // Pipe the instance registered through
+			const HostAddress::Base  address;
+			const Patterns           patterns;     // Sockets the instance listens with
+
+			// Requests sent but not yet answered, less those given up as lost (see load).
+			std::atomic<uint32_t>    outstanding = 0;
+
+			// Requests to the instance and replies from it; latency is queue wait.
+			CommMetrics              metrics;
+
+			size_t queueDepth()    {return req_sendQueue->depth();}
+			void   writeMetrics(std::ostream &out);
 
 
 			void sendPush   (nng::msg &&msg);
-			void sendRequest(nng::msg &&msg);
-			
+			void sendRequest(nng::msg &&msg, unsigned priority = 0);
+
+			// Connected to the service instance.  Maintained by pipe events.
+			bool healthy() const noexcept    {return patterns.contains(Pattern::REQ_REP) ? req.isConnected() : push.isConnected();}
+			bool healthy(PATTERN pattern) const noexcept    {return (pattern == Pattern::REQ_REP) ? req.isConnected() : push.isConnected();}
+
+			/*
+				Outstanding requests for balancing.
+					Requests are counted in two windows of at least lostAfter; a reply answers the
+					older window first, and requests still unanswered when it rolls over are
+					given up as lost.  Losing the connection gives up all but the queued ones.
+			*/
+			uint32_t load(std::chrono::milliseconds lostAfter) noexcept;
+
+			void _sent    () noexcept;
+			void _replied () noexcept;
+			void _pipeLost() noexcept;
+
 
 		public:
-			Route(Server &server, std::string path);
-			~Route();
+			Replica(Server &server, PipeID registration, const HostAddress::Base &address, Patterns patterns);
+			~Replica();
 
-			void dial(const HostAddress::Base&);
+			void dial();
 
 
 		protected:
 			class RequestRaw : public Socket
 			{
 			public:
-				RequestRaw(Route &_route) : Socket(Role::CLIENT, Pattern::REQ_REP, Socket::RAW), route(_route) {}
+				RequestRaw() : Socket(Role::CLIENT, Pattern::REQ_REP, Socket::RAW) {}
 				~RequestRaw() {}
+			};
+
+			// Tells the replica when its request connection drops.
+			struct PipeWatch : public Socket::PipeEventHandler
+			{
+				Replica *replica;
 
-			protected:
-				Route &route;
+				PipeWatch(Replica *_replica)    : replica(_replica) {}
+				void pipeEvent(Socket*, nng::pipe_view, nng::pipe_ev event) override    {if (event == nng::pipe_ev::rem_post) replica->_pipeLost();}
 			};
+			std::shared_ptr<PipeWatch> pipeWatch;
 
 			RequestRaw req;
 			Push_Box   push;
 
 			// I/O handling for requests
-			edb::life_locked<AsyncSendQueue<ClientRequesting>> req_sendQueue;
+			edb::life_locked<RequestQueue>                     req_sendQueue;
 			AsyncSendLoop<ClientRequesting>                    req_send_to_service;
 			AsyncRecvLoop<ServiceReplying>                     req_recv_from_service;
 
 			std::mutex mtx;
 			bool halted = false;
+
+			// Outstanding request windows; under load_mtx.
+			std::mutex                            load_mtx;
+			uint32_t                              sentRecent = 0, sentEarlier = 0;
+			std::chrono::steady_clock::time_point windowStart = std::chrono::steady_clock::now();
+		};
+
+
+		/*
+			A routed URI and the replicas serving it.
+				Services class manages the routing table.
+		*/
+		class Route
+		{
+		public:
+			Server            &server;
+			const std::string  path;
+
+
+			// Pick a replica and send.  Throws nng::exception if there are no replicas.
+			void sendPush   (nng::msg &&msg, const MsgView::Request &request);
+			void sendRequest(nng::msg &&msg, const MsgView::Request &request, unsigned priority = 0);
+			
+
+		public:
+			Route(Server &server, std::string path, const Balancing &balancing);
+			~Route();
+
+			/*
+				Manage replicas, identified by their registration pipe.
+					addReplica takes ownership, or throws nng::exception if the address is already in use.
+					removeReplica returns the removed replica, which the caller deletes.
+			*/
+			void     addReplica   (Replica *replica);
+			Replica *removeReplica(PipeID registration);
+			size_t   replicaCount () const;
+			bool     hasAddress   (const HostAddress::Base &address) const;
+
+			void setBalancing(const Balancing &balancing);
+
+			void writeMetrics(std::ostream &out) const;
+
+
+		protected:
+			using RingPoint = std::pair<uint32_t, Replica*>;
+
+			mutable std::mutex     mtx;
+			Balancing              balancing;
+			std::vector<Replica*>  replicas;
+			std::vector<RingPoint> ring;
+			unsigned               cursor = 0;
+
+			// Pick a replica listening with the pattern, or null if none does.
+			Replica *_choose(const MsgView::Request &request, PATTERN pattern);
+			void     _buildRing();
 		};
 
 
@@ -255,18 +645,18 @@ namespace telling
 				Route messages to an appropriate service, returning a status:
 					200 -- the message was routed
 					404 -- no service matches the path
-					503 -- failed to send
+					503 -- failed to send, or shed by QoS admission control
 			*/
 
-			Status routePush(std::string_view path, nng::msg &&msg)
+			Status routePush(const MsgView::Request &request, nng::msg &&msg)
 			{
 				std::lock_guard<std::mutex> g(mtx);
 
-				auto r = route(path);
+				auto r = route(request.uri());
 				if (!r) return StatusCode::NotFound;
 				try
 				{
-					r->sendPush(std::move(msg));
+					r->sendPush(std::move(msg), request);
 				}
 				catch (nng::exception e)
 				{
@@ -276,15 +666,15 @@ namespace telling
 				return StatusCode::OK;
 			}
 
-			Status routeRequest(std::string_view path, nng::msg &&msg)
+			Status routeRequest(const MsgView::Request &request, nng::msg &&msg, unsigned priority = 0)
 			{
 				std::lock_guard<std::mutex> g(mtx);
 
-				auto r = route(path);
+				auto r = route(request.uri());
 				if (!r) return StatusCode::NotFound;
 				try
 				{
-					r->sendRequest(std::move(msg));
+					r->sendRequest(std::move(msg), request, priority);
 				}
 				catch (nng::exception e)
 				{
@@ -294,36 +684,59 @@ namespace telling
 				return StatusCode::OK;
 			}
 
+			// See Server::balance.
+			void setBalancing(std::string_view uri, const Balancing &balancing);
+
+			// Write metrics for each route as a JSON array.
+			void writeMetrics(std::ostream &out);
 
-		protected:
-			using PipeID = decltype(std::declval<nng_pipe>().id);
 
+		protected:
 			std::mutex         mtx;
 			PrefixMap<Route*>  map;
 
-			struct NewRoute
+			std::map<std::string, Balancing, std::less<>> balancing;
+
+			struct Enrollment
 			{
-				QueryID           queryID;
-				PipeID            pipeID;
 				std::string       map_uri;
 				HostAddress::Base host;
+				Patterns          patterns;
+			};
+
+			// One registration request, which may enroll many URIs.
+			struct NewRoute
+			{
+				QueryID                 queryID;
+				PipeID                  pipeID;
+				std::vector<Enrollment> routes;
+			};
+
+			struct ClosedReplica
+			{
+				std::string       map_uri;
+				PipeID            pipeID;
 			};
 
 			struct Management
 			{
-				std::deque<NewRoute>    route_open;
-				std::deque<Route*>      route_close;
-				std::thread             thread;
-				std::condition_variable cond;
-				bool                    run = true;
+				std::deque<NewRoute>      route_open;
+				std::deque<ClosedReplica> route_close;
+				std::thread               thread;
+				std::condition_variable   cond;
+				bool                      run = true;
 			}
 				management;
 
+			// Registration batches are dialed by up to MaxDialThreads threads.
+			static constexpr size_t MaxDialThreads = 8, DialsPerThread = 16;
+
 			void run_management_thread();
+			void open_routes(std::vector<NewRoute> &requests, std::unique_lock<std::mutex> &lock);
 
 			Reply register_reply;
 
-			std::unordered_map<PipeID, std::string> registrationMap;
+			std::unordered_map<PipeID, std::vector<std::string>> registrationMap;
 
 
 			// Handlers
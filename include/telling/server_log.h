@@ -0,0 +1,124 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+
+namespace telling
+{
+	/*
+		Asynchronous server log.
+			Events are structured (component, type, URI, status, pipe, text) and are
+			copied into a fixed-size lock-free ring buffer.  A background thread formats
+			them and writes them to the output stream, flushing once per batch.
+
+			Logging never blocks the caller.  Each event type is rate-limited; events
+			over the limit, or arriving while the buffer is full, are counted and the
+			counts are written periodically instead.
+
+		With no output stream, events are discarded before any work is done.
+	*/
+	class ServerLog
+	{
+	public:
+		enum EVENT
+		{
+			INFO = 0,          // Lifecycle: listening, threads stopping
+			REGISTRY,          // Service registration and disconnection
+			ROUTE_NOT_FOUND,   // No service matched a message's URI
+			ROUTE_UNAVAILABLE, // A service matched but could not take the message
+			MALFORMED,         // A message could not be parsed
+			IO_ERROR,          // Asynchronous I/O failures
+			EVENT_COUNT
+		};
+
+		static constexpr size_t Capacity = 1024; // Events in the ring buffer
+		static constexpr size_t UriSize  = 96;   // Longer URIs are truncated
+		static constexpr size_t TextSize = 160;  // Longer text is truncated
+
+		static const char *EventName(EVENT type) noexcept;
+
+
+	public:
+		explicit ServerLog(std::ostream *out);
+		~ServerLog();
+
+		ServerLog(const ServerLog&) = delete;
+		void operator=(const ServerLog&) = delete;
+
+		bool enabled() const noexcept    {return _out != nullptr;}
+
+		/*
+			Log an event.  Returns false if it was suppressed or dropped.
+				Text and URI are copied; they need not outlive the call.
+		*/
+		bool event(EVENT type, const char *component, std::string_view text) noexcept                                                    {return event(type, component, text, {}, 0, 0);}
+		bool event(EVENT type, const char *component, std::string_view text, std::string_view uri, int status = 0, uint32_t pipe = 0) noexcept;
+
+		/*
+			Limit an event type to `perSecond` events (0 for unlimited).
+				By default, INFO and REGISTRY are unlimited and the rest allow 10 per second.
+		*/
+		void rateLimit(EVENT type, unsigned perSecond) noexcept    {_types[type].perSecond.store(perSecond, std::memory_order_relaxed);}
+
+		// Totals since construction.
+		uint64_t suppressed(EVENT type) const noexcept    {return _types[type].suppressedTotal.load(std::memory_order_relaxed);}
+		uint64_t dropped()              const noexcept    {return _droppedTotal.load(std::memory_order_relaxed);}
+
+		// Write pending events now.
+		void flush();
+
+
+	private:
+		struct Entry
+		{
+			std::chrono::steady_clock::time_point time;
+			EVENT       type;
+			const char *component;
+			int         status;
+			uint32_t    pipe;
+			uint8_t     uriSize, textSize;
+			char        uri [UriSize];
+			char        text[TextSize];
+		};
+		struct Slot
+		{
+			std::atomic<size_t> seq;
+			Entry               entry;
+		};
+		struct TypeState
+		{
+			std::atomic<unsigned> perSecond  = 10;
+			std::atomic<int64_t>  window     = -1; // Current second
+			std::atomic<unsigned> count      = 0;  // Events in the current second
+			std::atomic<uint64_t> suppressed = 0, suppressedTotal = 0;
+		};
+
+		std::ostream *const _out;
+		Slot               *_slots;
+		std::atomic<size_t> _tail = 0;
+		size_t              _head = 0;   // Flusher only
+
+		TypeState             _types[EVENT_COUNT];
+		std::atomic<uint64_t> _dropped = 0, _droppedTotal = 0;
+
+		const std::chrono::steady_clock::time_point _start;
+
+		std::mutex              _mtx; // Flusher wakeups and output
+		std::condition_variable _cond;
+		bool                    _run = true;
+		std::thread             _flusher;
+
+		bool _admit(EVENT type) noexcept;
+		void _run_flusher();
+		void _drain();     // Write buffered events (holding _mtx)
+		void _summarize(); // Write suppression counts (holding _mtx)
+	};
+}
@@ -12,44 +12,57 @@ namespace telling
 	{
 	public:
 		Service_Box(std::string _uri, std::string_view serverID = DefaultServerID());
+		Service_Box(std::string _uri, std::string_view serverID, Patterns patterns);
 		~Service_Box() override;
 
 
 		/*
 			Publish a message to a topic (URI).
 		*/
-		void publish(nng::msg &&msg) final   {_publisher.publish(std::move(msg));}
+		void publish(nng::msg &&msg) final   {_use(_publisher, "Service_Box::publish (PUB_SUB not used)").publish(std::move(msg));}
 
 
 		/*
 			Receive pushed messages.
 		*/
-		bool pull(nng::msg &msg)             {return _puller.pull(msg);}
+		bool pull(nng::msg &msg)             {return _puller && _puller->pull(msg);}
+
+		// Pull up to `max` messages into a batch, parsing them together.
+		size_t pullBatch(MsgBatch &batch, size_t max)       {return _puller ? _puller->pullBatch(batch, max) : 0;}
 
 
 		/*
 			Receive and reply to requests (one by one).
 		*/
-		bool receive(nng::msg  &request)     {return _replier.receive(request);}
-		void respond(nng::msg &&reply)       {_replier.respond(std::move(reply));}
+		bool receive(nng::msg  &request)     {return _replier && _replier->receive(request);}
+		void respond(nng::msg &&reply)       {_use(_replier, "Service_Box::respond (REQ_REP not used)").respond(std::move(reply));}
+
+		/*
+			Receive up to `max` requests into a batch, parsing them together.
+				Reply to each with respondTo(batch.id(i), reply).
+		*/
+		size_t receiveBatch(MsgBatch &batch, size_t max)    {return _replier ? _replier->receiveBatch(batch, max) : 0;}
+		void   respondTo(QueryID id, nng::msg &&reply)      {_use(_replier, "Service_Box::respondTo (REQ_REP not used)").respondTo(id, std::move(reply));}
 
 		/*
 			Reply to all pending requests with a functor.
 		*/
-		template<class Fn>          void respond_all(Fn fn)           {_replier.respond_all(fn);}
-		template<class Fn, class A> void respond_all(Fn fn, A arg)    {_replier.respond_all(fn, arg);}
+		template<class Fn>          void respond_all(Fn fn)           {if (_replier) _replier->respond_all(fn);}
+		template<class Fn, class A> void respond_all(Fn fn, A arg)    {if (_replier) _replier->respond_all(fn, arg);}
 
 
 		// Access communicators.
-		Reply_Base   *replier()   noexcept final    {return &_replier;}
-		Publish_Base *publisher() noexcept final    {return &_publisher;}
-		Pull_Base    *puller()    noexcept final    {return &_puller;}
+		Reply_Base   *replier()   noexcept final    {return _replier   ? &*_replier   : nullptr;}
+		Publish_Base *publisher() noexcept final    {return _publisher ? &*_publisher : nullptr;}
+		Pull_Base    *puller()    noexcept final    {return _puller    ? &*_puller    : nullptr;}
+
+		size_t footprint() const noexcept final    {return sizeof(*this) + _footprint(_replier) + _footprint(_publisher) + _footprint(_puller);}
 
 
 	protected:
-		Reply_Box   _replier;
-		Publish_Box _publisher;
-		Pull_Box    _puller;
+		std::optional<Reply_Box>   _replier;
+		std::optional<Publish_Box> _publisher;
+		std::optional<Pull_Box>    _puller;
 	};
 
 
@@ -60,39 +73,47 @@ namespace telling
 	{
 	public:
 		Service(std::string _uri, std::string_view serverID = DefaultServerID());
+		Service(std::string _uri, std::string_view serverID, Patterns patterns);
 		~Service();
 
+		/*
+			Create only the communicators the handler uses (see ServiceHandler_Base::patterns).
+				Registers after initializing, so the server never dials a missing socket.
+		*/
 		Service(std::weak_ptr<ServiceHandler_Base> handler,
-			std::string _uri, std::string_view serverID = DefaultServerID()) :
-			Service(_uri, serverID)    {initialize(handler);}
+			std::string _uri, std::string_view serverID = DefaultServerID());
 
 		/*
 			Initialize service with a handler.
 				Only one handler is allowed at a time.
+				replyContexts > 1 lets several requests be handled concurrently;
+				the handler must then be thread-safe (see Reactor::Concurrency).
 		*/
-		void initialize(std::weak_ptr<ServiceHandler_Base> handler);
+		void initialize(std::weak_ptr<ServiceHandler_Base> handler, unsigned replyContexts = 1);
 
 		/*
 			Publish a message to a topic (URI).
 		*/
-		void publish(nng::msg &&report) final                   {_publisher.publish(std::move(report));}
+		void publish(nng::msg &&report) final                   {_use(_publisher, "Service::publish (PUB_SUB not used)").publish(std::move(report));}
 
 		/*
 			Respond to the query with the given ID.
 		*/
-		void respondTo(QueryID queryID, nng::msg &&reply)       {_replier.respondTo(queryID, std::move(reply));}
+		void respondTo(QueryID queryID, nng::msg &&reply)       {_use(_replier, "Service::respondTo (REQ_REP not used)").respondTo(queryID, std::move(reply));}
 
 
 		// Access communicators.
-		Reply_Base   *replier()   noexcept final    {return &_replier;}
-		Publish_Base *publisher() noexcept final    {return &_publisher;}
-		Pull_Base    *puller()    noexcept final    {return &_puller;}
+		Reply_Base   *replier()   noexcept final    {return _replier   ? &*_replier   : nullptr;}
+		Publish_Base *publisher() noexcept final    {return _publisher ? &*_publisher : nullptr;}
+		Pull_Base    *puller()    noexcept final    {return _puller    ? &*_puller    : nullptr;}
+
+		size_t footprint() const noexcept final    {return sizeof(*this) + _footprint(_replier) + _footprint(_publisher) + _footprint(_puller);}
 
 
 	protected:
 		//std::weak_ptr<Handler> handler;
-		Reply     _replier;
-		Pull      _puller;
-		Publish   _publisher;
+		std::optional<Reply>     _replier;
+		std::optional<Pull>      _puller;
+		std::optional<Publish>   _publisher;
 	};
 }
\ No newline at end of file
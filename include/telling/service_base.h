@@ -7,6 +7,7 @@
 #include "service_reply.h"
 #include "service_pull.h"
 #include "service_publish.h"
+#include "async_coro.h"
 
 
 
@@ -22,16 +23,30 @@ namespace telling
 		const std::string         uri;
 		HostAddress::Base         inProcAddress() const noexcept    {return HostAddress::Base::InProc(uri);}
 
+		/*
+			Patterns the service communicates with.
+				Only these communicators are created, and the server dials only these.
+		*/
+		const Patterns            patterns;
+
 		// Primary registration.  Additional registrations under different URIs are allowed.
 		std::optional<Registration> registration;
 
 
 	public:
 		Service_Base(std::string _uri, std::string_view serverID = DefaultServerID());
+		Service_Base(std::string _uri, std::string_view serverID, Patterns patterns);
 		virtual ~Service_Base();
 
 		void registerURI(std::string_view serverID);
 
+		/*
+			Register as one replica of the service at routeURI.
+				The server balances requests to routeURI across its replicas.
+				Each replica's own uri must be unique, as it is the in-process address.
+		*/
+		void registerReplica(std::string_view routeURI, std::string_view serverID = DefaultServerID());
+
 
 		/*
 			Services typically register with a server rather than listening.
@@ -47,6 +62,7 @@ namespace telling
 
 		/*
 			Access individual communicators.
+				Returns nullptr for patterns the service does not use.
 		*/
 		virtual Reply_Base   *replier()   noexcept = 0;
 		virtual Publish_Base *publisher() noexcept = 0;
@@ -56,6 +72,25 @@ namespace telling
 			Publish a message to a topic (URI).
 		*/
 		virtual void publish(nng::msg &&report) = 0;
+
+		/*
+			Estimate the bytes held by this service and its communicators.
+				Unused patterns cost only their empty slot in the object.
+		*/
+		virtual size_t footprint() const noexcept = 0;
+
+
+	protected:
+		template<class T>
+		static T &_use(std::optional<T> &comm, const char *context)
+		{
+			if (!comm) throw nng::exception(nng::error::notsup, context);
+			return *comm;
+		}
+
+		// Bytes a communicator holds beyond its storage in the service object.
+		template<class T>
+		static size_t _footprint(const std::optional<T> &comm) noexcept    {return comm ? comm->footprint() - sizeof(T) : 0;}
 	};
 
 
@@ -74,6 +109,9 @@ namespace telling
 
 	public:
 		~ServiceHandler_Base() override {}
+
+		// Patterns a service with this handler needs.  Declaring fewer saves sockets.
+		virtual Patterns patterns() const noexcept    {return Patterns::All();}
 	};
 
 
@@ -119,4 +157,32 @@ namespace telling
 		void async_prep (Publishing, nng::msg &msg) override;
 		void async_sent (Publishing)                override;
 	};
+
+
+#if TELLING_COROUTINES
+	/*
+		Service handler which replies to requests with coroutines.
+			async_reply may co_await downstream requests, then co_returns the reply.
+			Exceptions escaping async_reply produce a 500 reply.
+	*/
+	class ServiceHandler_Coro : public ServiceHandler
+	{
+	public:
+		using ReplyTask = telling::ReplyTask<Replying>;
+
+
+	public:
+		~ServiceHandler_Coro() override {}
+
+
+	protected:
+		// Handle one request.  Take the request by value; it lives in the coroutine frame.
+		virtual ReplyTask async_reply(Replying, nng::msg request) = 0;
+
+		void async_recv(Replying rep, nng::msg &&request) final    {async_reply(rep, std::move(request)).respond(rep, &ExceptionReply);}
+
+		// Produce a reply describing an escaped exception.
+		static nng::msg ExceptionReply(std::exception_ptr);
+	};
+#endif
 }
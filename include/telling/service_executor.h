@@ -0,0 +1,64 @@
+#pragma once
+
+#include "executor.h"
+#include "service_base.h"
+
+
+namespace telling
+{
+	/*
+		Service handler decorator which runs requests and pulled messages on an Executor.
+			The inner handler's async_recv runs on a worker rather than an AIO thread.
+			Replies given through the tag's SendPrompt are sent with respondTo.
+			All other events are forwarded directly.
+
+		Errors are reported through the inner handler's async_error:
+			nng::error::again    -- the queue is full; requests get a 503 reply.
+			nng::error::internal -- async_recv threw; requests get a 500 reply.
+	*/
+	class ServiceHandler_Executor : public ServiceHandler_Base
+	{
+	public:
+		ServiceHandler_Executor(std::shared_ptr<ServiceHandler_Base> inner,
+			Executor &executor, Executor::PRIORITY priority = Executor::NORMAL, size_t capacity = 4096);
+		~ServiceHandler_Executor() override;
+
+		Executor::Queue &queue() noexcept    {return _queue;}
+
+		// The inner handler's patterns, so only its communicators are created.
+		Patterns patterns() const noexcept override    {return _inner->patterns();}
+
+
+	protected:
+		std::shared_ptr<ServiceHandler_Base> _inner;
+		Executor::Queue                      _queue;
+
+		AsyncReply   &_reply()      noexcept    {return *_inner;}
+		AsyncPull    &_pull()       noexcept    {return *_inner;}
+		AsyncPublish &_publish()    noexcept    {return *_inner;}
+
+		// Request / Reply: received requests go to the executor.
+		void async_recv (Replying,     nng::msg &&request) override;
+		void async_prep (Replying rep, nng::msg &msg)      override    {_reply().async_prep (rep, msg);}
+		void async_sent (Replying rep)                     override    {_reply().async_sent (rep);}
+		void async_error(Replying rep, AsyncError e)       override    {_reply().async_error(rep, e);}
+		void async_start(Replying rep)                     override    {_reply().async_start(rep);}
+		void async_stop (Replying rep, AsyncError e)       override    {_reply().async_stop (rep, e);}
+
+		// Push / Pull: pulled messages go to the executor.
+		void async_recv (Pulling,      nng::msg &&msg)     override;
+		void async_error(Pulling pull, AsyncError e)       override    {_pull().async_error(pull, e);}
+		void async_start(Pulling pull)                     override    {_pull().async_start(pull);}
+		void async_stop (Pulling pull, AsyncError e)       override    {_pull().async_stop (pull, e);}
+
+		// Publishing
+		void async_prep (Publishing pub, nng::msg &msg)    override    {_publish().async_prep (pub, msg);}
+		void async_sent (Publishing pub)                   override    {_publish().async_sent (pub);}
+		void async_error(Publishing pub, AsyncError e)     override    {_publish().async_error(pub, e);}
+		void async_start(Publishing pub)                   override    {_publish().async_start(pub);}
+		void async_stop (Publishing pub, AsyncError e)     override    {_publish().async_stop (pub, e);}
+
+		// Pipe events
+		void pipeEvent(Socket *socket, nng::pipe_view pipe, nng::pipe_ev event) override    {_inner->pipeEvent(socket, pipe, event);}
+	};
+}
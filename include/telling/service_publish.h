@@ -37,9 +37,9 @@ namespace telling
 		/*
 			Construct with asynchronous I/O handler and optional socket-sharing.
 		*/
-		Publish()                                                       : Publish_Base(),       AsyncSendLoop(socketView(),{this}) {}
+		Publish()                                                       : Publish_Base(),       AsyncSendLoop(socketView(),{this},&metrics) {}
 		Publish(std::weak_ptr<AsyncPub> p)                              : Publish() {initialize(p);}
-		Publish(const Publish_Pattern &shared)                          : Publish_Base(shared), AsyncSendLoop(socketView(),{this}) {}
+		Publish(const Publish_Pattern &shared)                          : Publish_Base(shared), AsyncSendLoop(socketView(),{this},&metrics) {}
 		Publish(const Publish_Pattern &s, std::weak_ptr<AsyncPub> p)    : Publish(s) {initialize(p);}
 		~Publish() {}
 
@@ -56,6 +56,8 @@ namespace telling
 			if (!isReady()) throw nng::exception(nng::error::closed, "Publish Communicator is not ready.");
 			send_msg(std::move(msg));
 		}
+
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
 	};
 
 	/*
@@ -69,6 +71,8 @@ namespace telling
 		Publish_Box(const Publish_Base &shareSocket)    : Publish(shareSocket) {_init();}
 		~Publish_Box() {}
 
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
+
 
 	protected:
 		void _init()    {initialize(_queue.weak());}
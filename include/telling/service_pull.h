@@ -8,6 +8,7 @@
 #include "socket.h"
 #include "async_loop.h"
 #include "async_queue.h"
+#include "msg_batch.h"
 
 
 namespace telling
@@ -38,9 +39,9 @@ namespace telling
 			Construct with asynchronous I/O handler and optional socket-sharing.
 				Begins listening for messages immediately.
 		*/
-		Pull()                                                     : Pull_Base(),       AsyncRecvLoop(socketView(),{this}) {}
+		Pull()                                                     : Pull_Base(),       AsyncRecvLoop(socketView(),{this},&metrics) {}
 		Pull(std::weak_ptr<AsyncPull> p)                           : Pull() {initialize(p);}
-		Pull(const Pull_Pattern &shared)                           : Pull_Base(shared), AsyncRecvLoop(socketView(),{this}) {}
+		Pull(const Pull_Pattern &shared)                           : Pull_Base(shared), AsyncRecvLoop(socketView(),{this},&metrics) {}
 		Pull(const Pull_Pattern &s, std::weak_ptr<AsyncPull> p)    : Pull(s) {initialize(p);}
 		~Pull() {}
 
@@ -48,6 +49,8 @@ namespace telling
 			Start receiving through the provided handler.
 		*/
 		void initialize(std::weak_ptr<AsyncPull> p)    {AsyncRecvLoop::recv_start(p);}
+
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
 	};
 
 
@@ -68,6 +71,20 @@ namespace telling
 		*/
 		bool pull(nng::msg &msg)    {return _queue->pull(msg);}
 
+		size_t footprint() const noexcept override    {return sizeof(*this) + _sharedFootprint();}
+
+		/*
+			Pull up to `max` messages into a batch and parse them together.
+				Returns the number of messages added.
+		*/
+		size_t pullBatch(MsgBatch &batch, size_t max)
+		{
+			size_t first = batch.size();
+			size_t n = _queue->pull_n(max, [&](nng::msg &&msg) {batch._append(std::move(msg));});
+			batch._parse(first);
+			return n;
+		}
+
 
 	protected:
 		void _init()    {initialize(_queue.weak());}
@@ -14,19 +14,39 @@ namespace telling
 	class Reactor : public ServiceHandler
 	{
 	public:
-		using UriView    = telling::UriView;
-		using Status     = telling::Status;
-		using MethodCode = telling::MethodCode;
-		using Method     = telling::Method;
-		using Methods    = telling::Methods;
-		using Msg        = telling::Msg;
+		using UriView    = telling::UriView;
+		using Status     = telling::Status;
+		using MethodCode = telling::MethodCode;
+		using Method     = telling::Method;
+		using Methods    = telling::Methods;
+		using Msg        = telling::Msg;
 		using MsgView    = telling::MsgView;
 
 
+		/*
+			How requests are dispatched when several arrive at once.
+				A Service receives concurrently when initialized with several reply contexts.
+		*/
+		enum class Concurrency
+		{
+			SERIALIZED, // One request at a time (default)
+			PER_PATH,   // Requests for the same URI path are serialized
+			CONCURRENT, // No locking; the Reactor's methods must be thread-safe
+		};
+
+
 	public:
-		Reactor(UriView uri_prefix);
+		Reactor(UriView uri_prefix, Concurrency concurrency = Concurrency::SERIALIZED);
 		virtual ~Reactor() {}
 
+		Concurrency concurrency() const noexcept    {return _concurrency;}
+
+		/*
+			Reactors reply to requests and may publish.
+				They pull only if allowed() includes a method that permits no response.
+		*/
+		Patterns patterns() const noexcept override;
+
 
 	protected:
 		struct Query
@@ -83,7 +103,13 @@ namespace telling
 		void async_recv(Pulling,      nng::msg &&request) override    {_handle(Query{0},                std::move(request));}
 		void async_recv(Replying rep, nng::msg &&request) override    {_handle(Query{rep.id, rep.send}, std::move(request));}
 
-		Uri        _uri_prefix;
-		std::mutex _reactor_mutex;
+		static constexpr unsigned PathStripes = 16;
+
+		Uri               _uri_prefix;
+		const Concurrency _concurrency;
+		std::mutex        _reactor_mutex;
+		std::mutex        _path_mutex[PathStripes];
+
+		std::mutex &_pathMutex(UriView uri) noexcept;
 	};
 }
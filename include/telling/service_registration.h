@@ -1,7 +1,9 @@
 #pragma once
 
 
+#include <string>
 #include <string_view>
+#include <vector>
 #include "async_loop.h"
 #include "client_request.h"
 
@@ -24,11 +26,33 @@ namespace telling
 		};
 
 
+		struct Entry
+		{
+			std::string servicePath;
+			std::string servicePath_alias; // Route URI; defaults to servicePath
+			Patterns    patterns = Patterns::All();
+		};
+
+
 	public:
+		/*
+			The server dials only the given patterns of the service.
+		*/
 		Registration(
 			std::string_view servicePath,
 			std::string_view servicePath_alias = std::string_view(),
-			std::string_view serverID          = DefaultServerID());
+			std::string_view serverID          = DefaultServerID(),
+			Patterns         patterns          = Patterns::All());
+
+		/*
+			Register many services with one request.
+				The server dials them in parallel and replies once all are routed.
+				If any fails, status is FAILED and failures() lists their route URIs.
+		*/
+		Registration(
+			const std::vector<Entry> &entries,
+			std::string_view          serverID = DefaultServerID());
+
 		~Registration();
 
 		/*
@@ -39,6 +63,9 @@ namespace telling
 		bool                  isWorking () const noexcept    {auto s=status(); return s==INITIAL || s==REQUESTED;}
 		bool                  isRegistered() const noexcept    {return status() == ENLISTED;}
 
+		// Route URIs which failed to register, for batches.
+		const std::vector<std::string> &failures() const noexcept;
+
 
 	public:
 		class Delegate;
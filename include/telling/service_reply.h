@@ -1,13 +1,15 @@
 #pragma once
 
 
+#include <memory>
 #include <utility>
-#include <unordered_set>
+#include <atomic>
 #include <mutex>
 #include <life_lock.hpp>
 #include "io_queue.h"
 #include "socket.h"
 #include "async_loop.h"
+#include "msg_batch.h"
 
 
 namespace telling
@@ -44,34 +46,60 @@ namespace telling
 
 		/*
 			Provide a handler for handling requests after construction.
+				recvContexts is how many requests may be received at once.
+				With more than one, the handler's async_recv is called concurrently.
 				Throws nng::exception if a handler has already been installed.
 		*/
-		void initialize(std::weak_ptr<AsyncRep>);
+		void initialize(std::weak_ptr<AsyncRep>, unsigned recvContexts = 1);
 
 
 		/*
 			Send a response to a specific outstanding query.
+				Replies are sent immediately on the query's own context.
+				May be called concurrently for different queries.
 		*/
 		void respondTo(QueryID, nng::msg &&msg);
 
+		// Estimated bytes held, including slots for outstanding queries.
+		size_t footprint() const noexcept override;
+
 
 	protected:
 		std::weak_ptr<AsyncRep> _handler;
 
-		struct OutboxItem
+		/*
+			Outstanding queries live in a table of slots, each holding the query's
+				context and an AIO for sending its reply.  QueryID encodes the slot
+				index and a generation count, so stale IDs are rejected.
+			Slots are allocated in chunks which are never moved or freed until
+				destruction, and recycled through a lock-free free list.
+			The chunk table itself is allocated with the first chunk, so a Reply
+				which never receives a request holds no slot storage.
+		*/
+		struct Slot;
+		static constexpr unsigned SlotIndexBits = 16;
+		static constexpr unsigned SlotChunkBits = 8;
+		static constexpr unsigned SlotChunkSize = 1u << SlotChunkBits;
+		static constexpr unsigned MaxSlotChunks = 1u << (SlotIndexBits - SlotChunkBits);
+
+		std::atomic<std::atomic<Slot*>*> slotChunks = nullptr; // [MaxSlotChunks]
+		std::atomic<uint64_t>            slotFree   = 0;       // (ABA tag << 32) | (index + 1)
+		mutable std::mutex               slotGrow_mtx;
+		unsigned                         slotChunkCount = 0;
+
+		Slot *_slot(QueryID) const noexcept;
+		Slot *_acquireSlot();
+		void  _releaseSlot(Slot*) noexcept;
+
+		// Each receiver awaits one request on its own context.
+		struct Receiver
 		{
+			Reply   *comm;
+			nng::aio aio;
 			nng::ctx ctx;
-			nng::msg msg;
 		};
-		using Unresponded = std::unordered_set<QueryID>;
-
-		std::mutex  unresponded_mtx;
-		Unresponded unresponded;
-
-		nng::aio                  aio_send, aio_recv;
-		SendQueueMtx_<OutboxItem> outbox;
-			
-		nng::ctx ctx_aio_recv, ctx_aio_send;
+		std::unique_ptr<Receiver[]> receivers;
+		unsigned                    receiverCount = 0;
 
 		void _init();
 		static void _aioReceived(void*);
@@ -98,6 +126,15 @@ namespace telling
 		bool receive(nng::msg  &request);
 		void respond(nng::msg &&reply);
 
+		/*
+			Receive up to `max` requests into a batch and parse them together.
+				Reply to each with respondTo(batch.id(i), ...), in any order.
+				Returns the number of requests added.
+		*/
+		size_t receiveBatch(MsgBatch &batch, size_t max);
+
+		size_t footprint() const noexcept override;
+
 
 		/*
 			Automatically loop through requests and reply to them with a functor.
@@ -2,13 +2,15 @@
 
 
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
-#include <unordered_map>
 
 #include <nngpp/nngpp.h>
 
 #include "pattern.h"
 #include "host_address.h"
+#include "metrics.h"
 
 
 namespace telling
@@ -105,6 +107,9 @@ namespace telling
 		*/
 		void disconnectAll() noexcept;
 
+		// Bytes used by this object and its connector list, excluding NNG's own state.
+		size_t footprint() const noexcept;
+
 
 	public:
 		const ROLE     role;
@@ -113,7 +118,7 @@ namespace telling
 
 
 	protected:
-		std::mutex    _mtx;
+		mutable std::mutex _mtx;
 		nng::socket   _socket;
 		uint32_t      _pipe_count = 0;
 		std::weak_ptr<PipeEventHandler> _pipe_handler;
@@ -126,6 +131,10 @@ namespace telling
 			ListenerOrDialer(nng::listener &&listener);
 			~ListenerOrDialer();
 
+			// Movable so connectors can live in a vector.
+			ListenerOrDialer(ListenerOrDialer &&other) noexcept;
+			ListenerOrDialer &operator=(ListenerOrDialer &&other) noexcept;
+
 			explicit operator bool() const noexcept;
 
 			nng::dialer_view   dialer  () const noexcept;
@@ -142,8 +151,18 @@ namespace telling
 			static_assert(sizeof(nng::listener) == sizeof(nng_dialer));
 		};
 
-		// TODO optimize later
-		std::unordered_map<std::string, ListenerOrDialer> _connectors;
+		/*
+			Sockets rarely have more than a few connectors,
+				so a vector searched linearly is smaller and as fast as a map.
+		*/
+		struct Connector
+		{
+			std::string      uri;
+			ListenerOrDialer handle;
+		};
+		std::vector<Connector> _connectors;
+
+		std::vector<Connector>::iterator _findConnector(std::string_view uri) noexcept;
 
 
 	private:
@@ -180,6 +199,12 @@ namespace telling
 		// Count live connections.
 		uint32_t connectionCount() const noexcept    {return bool(_socket) ? _socket->connectionCount() : 0;}
 
+		/*
+			Estimate the bytes held by this communicator, with its share of the socket.
+				NNG's internal socket, pipe and context state is not counted.
+		*/
+		virtual size_t footprint() const noexcept    {return sizeof(*this) + _sharedFootprint();}
+
 
 		/*
 			Access the Communicator's socket.
@@ -216,10 +241,21 @@ namespace telling
 		const PATTERN  pattern;
 		const PROTOCOL protocol;
 
+		// Message counters for this communicator (not shared with its socket).
+		CommMetrics    metrics;
+
 
 	protected:
 		std::shared_ptr<Socket> _socket;
 
+		// Metrics storage plus this communicator's share of the socket.
+		size_t _sharedFootprint() const noexcept
+		{
+			size_t bytes = metrics.footprint();
+			if (_socket) bytes += _socket->footprint() / size_t(_socket.use_count());
+			return bytes;
+		}
+
 		/*
 			Create a Communicator holding a new socket.
 		*/
@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include <array>
+#include <cstdint>
+#include <nngpp/msg.h>
+
+
+namespace telling
+{
+	/*
+		Latency tracing along the request path.
+			A request opts in with a "Trace" header directly after its start-line, or
+			first in its binary header table (see MsgWriter::writeHeader_Trace).  The header holds one fixed-width
+			stamp per hop, which components overwrite in place as the request passes.
+			Services copy the stamps into their reply, adding their own.
+
+		Stamps are microseconds of the steady clock, so they compare only
+			between processes on the same machine.  Zero means "not stamped".
+	*/
+	class Trace
+	{
+	public:
+		enum HOP
+		{
+			CLIENT_SEND   = 0, // Client wrote the request
+			SERVER_RECV   = 1, // Server received it, after the relay device
+			ROUTE_SEND    = 2, // Server sent it to a service, after routing and QoS
+			SERVICE_RECV  = 3, // Service received it
+			SERVICE_REPLY = 4, // Service sent its reply
+			SERVER_RELAY  = 5, // Server relayed the reply to the client
+			HOP_COUNT
+		};
+
+		using Stamps = std::array<uint64_t, HOP_COUNT>;
+
+		static constexpr size_t FieldWidth = 12; // Hex digits per stamp
+		static constexpr size_t ValueSize  = HOP_COUNT * (FieldWidth+1) - 1;
+
+		// The current stamp.
+		static uint64_t Now() noexcept;
+
+		/*
+			Stamp a hop in a traced message, in place.
+				Returns false if the message carries no Trace header.
+		*/
+		static bool Stamp(nng::msg &msg, HOP hop) noexcept;
+
+		// Read all stamps.  Returns false if the message carries no Trace header.
+		static bool Read(const nng::msg &msg, Stamps &stamps) noexcept;
+
+		// Write stamps into a message, adding the header after its start-line if needed.
+		static void Write(nng::msg &msg, const Stamps &stamps);
+
+		// Format a header value.
+		static void Format(char *value, const Stamps &stamps) noexcept;
+	};
+}
@@ -0,0 +1,93 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <telling/alloc_tracking.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	struct StageCounters
+	{
+		std::atomic<uint64_t> allocations = 0, bytes = 0;
+	};
+
+	StageCounters counters[AllocTracking::STAGE_COUNT];
+
+	const char *const StageNames[AllocTracking::STAGE_COUNT] =
+	{
+		"untagged",
+		"write",
+		"queue",
+		"route",
+		"handler",
+	};
+}
+
+
+thread_local AllocTracking::STAGE AllocTracking::_current = AllocTracking::UNTAGGED;
+
+
+const char *AllocTracking::StageName(STAGE stage) noexcept
+{
+	return (stage < STAGE_COUNT) ? StageNames[stage] : "?";
+}
+
+AllocTracking::Counts AllocTracking::read(STAGE stage) noexcept
+{
+	Counts counts;
+	if (stage < STAGE_COUNT)
+	{
+		counts.allocations = counters[stage].allocations.load(std::memory_order_relaxed);
+		counts.bytes       = counters[stage].bytes      .load(std::memory_order_relaxed);
+	}
+	return counts;
+}
+
+AllocTracking::Counts AllocTracking::total() noexcept
+{
+	Counts sum;
+	for (unsigned i = 0; i < STAGE_COUNT; ++i)
+	{
+		auto counts = read(STAGE(i));
+		sum.allocations += counts.allocations;
+		sum.bytes       += counts.bytes;
+	}
+	return sum;
+}
+
+void AllocTracking::reset() noexcept
+{
+	for (auto &c : counters)
+	{
+		c.allocations.store(0, std::memory_order_relaxed);
+		c.bytes      .store(0, std::memory_order_relaxed);
+	}
+}
+
+void AllocTracking::count(size_t bytes) noexcept
+{
+	auto &c = counters[_current];
+	c.allocations.fetch_add(1,     std::memory_order_relaxed);
+	c.bytes      .fetch_add(bytes, std::memory_order_relaxed);
+}
+
+
+#if TELLING_ALLOC_TRACKING
+
+void *operator new(std::size_t size)
+{
+	AllocTracking::count(size);
+	if (void *p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void *operator new[](std::size_t size)                 {return operator new(size);}
+void operator delete  (void *p) noexcept                 {std::free(p);}
+void operator delete  (void *p, std::size_t) noexcept    {std::free(p);}
+void operator delete[](void *p) noexcept                 {std::free(p);}
+void operator delete[](void *p, std::size_t) noexcept    {std::free(p);}
+
+#endif
@@ -0,0 +1,193 @@
+#include <telling/client_gather.h>
+
+
+using namespace telling;
+
+
+Request_Gather::Request_Gather(Request &requester) :
+	_requester(requester)
+{
+	_timer = nng::make_aio(&_timerCallback, this);
+}
+
+Request_Gather::~Request_Gather()
+{
+	cancel();
+	_timer.stop();
+
+	// Wait for every request callback to return.
+	std::unique_lock lock(_mtx);
+	_cond.wait(lock, [this] {return _outstanding == 0;});
+}
+
+
+void Request_Gather::start(std::vector<nng::msg> &&requests,
+	size_t quorum, Deadline deadline, Completion complete)
+{
+	const size_t count = requests.size();
+	if (!count)
+		throw nng::exception(nng::error::inval, "Request_Gather::start (no requests)");
+
+	{
+		std::lock_guard g(_mtx);
+		if (!_complete)
+			throw nng::exception(nng::error::busy, "Request_Gather::start (already in progress)");
+	}
+
+	// The previous gather's deadline may have fired with its callback still queued; let it run first.
+	_timer.cancel();
+	_timer.wait();
+
+	{
+		std::unique_lock lock(_mtx);
+
+		// Let stragglers from a previous gather drain.
+		_cond.wait(lock, [this] {return _outstanding == 0;});
+
+		_results.clear();
+		_results.resize(count);
+		_queries.assign(count, 0);
+		_quorum      = ((quorum && quorum < count) ? quorum : count);
+		_successes   = 0;
+		_finished    = 0;
+		_outstanding = count;
+		_complete    = false;
+		_canceled    = false;
+		_expired     = false;
+		_onComplete  = std::move(complete);
+	}
+
+	// Pre-allocate contexts so the requests go out back-to-back.
+	_requester.reserve(count);
+
+	if (deadline > Deadline::zero())
+		nng_sleep_aio(nng_duration(deadline.count()), _timer.get());
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		bool skip;
+		{
+			std::lock_guard g(_mtx);
+			skip = _canceled;
+		}
+		if (skip)
+		{
+			// Canceled or completed while issuing; don't send the rest.
+			_finish(i, nng::error::canceled, nng::msg());
+			continue;
+		}
+
+		QueryID queryID = 0;
+		try
+		{
+			queryID = _requester.request(std::move(requests[i]),
+				[this, i](AsyncError status, nng::msg &&response)
+				{
+					_finish(i, status, std::move(response));
+				});
+		}
+		catch (nng::exception &e)
+		{
+			_finish(i, e.get_error(), nng::msg());
+			continue;
+		}
+
+		bool cancelNow;
+		{
+			std::lock_guard g(_mtx);
+			_queries[i] = queryID;
+			cancelNow = _canceled && !_results[i].done;
+		}
+		if (cancelNow) _requester.cancel(queryID);
+	}
+}
+
+bool Request_Gather::wait()
+{
+	std::unique_lock lock(_mtx);
+	_cond.wait(lock, [this] {return _complete;});
+	return true;
+}
+
+bool Request_Gather::wait(Deadline timeout)
+{
+	std::unique_lock lock(_mtx);
+	return _cond.wait_for(lock, timeout, [this] {return _complete;});
+}
+
+void Request_Gather::cancel()
+{
+	{
+		std::lock_guard g(_mtx);
+		if (_complete) return;
+		_canceled = true;
+	}
+	_cancel_stragglers();
+}
+
+
+void Request_Gather::_finish(size_t index, AsyncError status, nng::msg &&response)
+{
+	std::unique_lock lock(_mtx);
+
+	if (!_complete)
+	{
+		// Results are frozen once the gather completes.
+		if (_expired && status.nng_status == nng::error::canceled)
+			status = nng::error::timedout;
+
+		Result &result = _results[index];
+		result.done     = true;
+		result.status   = status;
+		result.response = std::move(response);
+		if (status.nng_status == nng::error::success) ++_successes;
+		++_finished;
+
+		const size_t unfinished = _results.size() - _finished;
+
+		if (_successes >= _quorum               // Quorum reached
+			|| unfinished == 0                  // Everything is in
+			|| _successes + unfinished < _quorum) // Quorum is out of reach
+		{
+			_complete = true;
+			_canceled = true;
+			for (auto &r : _results) if (!r.done) r.status = nng::error::canceled;
+
+			Completion onComplete = std::move(_onComplete);
+			lock.unlock();
+
+			_timer.cancel();
+			_cancel_stragglers();
+			if (onComplete) onComplete(*this);
+
+			lock.lock();
+		}
+	}
+
+	// Last action touching this object.
+	--_outstanding;
+	_cond.notify_all();
+}
+
+void Request_Gather::_cancel_stragglers()
+{
+	std::vector<QueryID> stragglers;
+	{
+		std::lock_guard g(_mtx);
+		for (size_t i = 0; i < _queries.size(); ++i)
+			if (_queries[i] && !_results[i].done) stragglers.push_back(_queries[i]);
+	}
+	for (QueryID id : stragglers) _requester.cancel(id);
+}
+
+void Request_Gather::_timerCallback(void *_self)
+{
+	auto self = static_cast<Request_Gather*>(_self);
+	if (self->_timer.result() != nng::error::success) return;
+
+	{
+		std::lock_guard g(self->_mtx);
+		self->_expired = true;
+	}
+	self->cancel();
+}
@@ -1,6 +1,8 @@
 #include <unordered_map>
 
 #include <telling/client_request.h>
+#include <telling/msg_view.h>
+#include <telling/alloc_tracking.h>
 #include <nngpp/protocol/req0.h>
 
 
@@ -20,7 +22,8 @@ struct Request::Action
 	nng::aio               aio;
 	nng::ctx               ctx;
 	ACTION_STATE           state;
-	//std::promise<nng::msg> promise;
+	ResponseCallback       callback;
+	LatencyHistogram::Clock::time_point since; // When the request was sent
 
 	QueryID    queryID()    const noexcept    {return ctx.get().id;}
 	Requesting requesting() const noexcept    {return Requesting{request, queryID()};}
@@ -29,6 +32,26 @@ struct Request::Action
 };
 
 
+struct Request::Hedge
+{
+	using Clock = LatencyHistogram::Clock;
+
+	Request* const    request;
+	nng::aio          timer;
+	nng::msg          duplicate;
+	ResponseCallback  callback;
+	LatencyHistogram *latency   = nullptr;
+	uint64_t          window    = 0;
+	Action           *legs[2]   = {};
+	QueryID           queryID   = 0; // Returned to the caller; see HedgeIDBit
+	Clock::time_point started[2];
+	unsigned          pending   = 0; // Legs and timer yet to finish
+	bool              done      = false;
+
+	static void _timerCallback(void*);
+};
+
+
 Request_Base::MsgStats Request::msgStats() const noexcept
 {
 	std::lock_guard<std::mutex> g(mtx);
@@ -46,8 +69,30 @@ Request_Base::MsgStats Request::msgStats() const noexcept
 }
 
 
+size_t Request::footprint() const noexcept
+{
+	size_t bytes = sizeof(*this) + _sharedFootprint();
+
+	std::lock_guard<std::mutex> lock(mtx);
+	bytes += (active.size() + idle.size()) * sizeof(Action);
+	bytes += active.bucket_count() * sizeof(void*) + idle.capacity() * sizeof(Action*);
+	bytes += hedges.size() * sizeof(Hedge) + (hedges.capacity() + hedgeIdle.capacity()) * sizeof(Hedge*);
+	return bytes;
+}
+
+
 Request::~Request()
 {
+	// Stop hedge timers so no duplicates are sent.
+	{
+		std::vector<Hedge*> stop;
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stop = hedges;
+		}
+		for (Hedge *hedge : stop) hedge->timer.stop();
+	}
+
 	// Cancel all active AIO
 	{
 		std::lock_guard<std::mutex> lock(mtx);
@@ -71,6 +116,10 @@ Request::~Request()
 	{
 		delete action;
 	}
+	for (Hedge *hedge : hedges)
+	{
+		delete hedge;
+	}
 }
 
 void Request::initialize(std::weak_ptr<AsyncRequest> new_handler)
@@ -94,25 +143,13 @@ QueryID Request::request(nng::msg &&msg)
 
 	std::lock_guard<std::mutex> lock(mtx);
 
-	// Allocate.
-	Action *action = nullptr;
-	if (idle.empty())
-	{
-		action = new Action{this};
-		action->ctx = make_ctx();
-		action->aio = nng::make_aio(&Action::_callback, action);
-	}
-	else
-	{
-		action = idle.front();
-		idle.pop_front();
-	}
+	Action *action = _acquire();
 
 	handler->async_prep(action->requesting(), msg);
 
 	if (!msg)
 	{
-		idle.push_front(action);
+		idle.push_back(action);
 		action = nullptr;
 		throw nng::exception(nng::error::canceled,
 			"AsyncQuery declined the message.");
@@ -123,12 +160,298 @@ QueryID Request::request(nng::msg &&msg)
 	active.insert(action);
 
 	// Prepare send
+	action->since = LatencyHistogram::Clock::now();
+	metrics.countSend(msg.get());
 	action->aio.set_msg(std::move(msg));
 	action->ctx.send(action->aio);
 
 	return action->queryID();
 }
 
+QueryID Request::request(nng::msg &&msg, ResponseCallback &&callback)
+{
+	if (!isReady())
+		throw nng::exception(nng::error::closed, "Request Communicator is not ready.");
+	if (!callback)
+		throw nng::exception(nng::error::inval, "Request::request (empty callback)");
+	if (!msg)
+		throw nng::exception(nng::error::inval, "Request::request (empty message)");
+
+	if (_hedging.load(std::memory_order_relaxed))
+	{
+		// Only idempotent requests may be duplicated.
+		MsgView::Request view;
+		try                  {view = MsgView::Request(msg);}
+		catch (MsgException&) {}
+		if (view && view.method().isIdempotent())
+			return _hedged(std::move(msg), std::move(callback), view.uriString());
+	}
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Action *action = _acquire();
+	action->callback = std::move(callback);
+	action->state = SEND;
+	active.insert(action);
+
+	action->since = LatencyHistogram::Clock::now();
+	metrics.countSend(msg.get());
+	action->aio.set_msg(std::move(msg));
+	action->ctx.send(action->aio);
+
+	return action->queryID();
+}
+
+bool Request::cancel(QueryID queryID)
+{
+	ResponseCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+
+		// Hedged requests cancel both legs and the timer, and complete right away.
+		auto hedge = hedgeQueries.find(queryID);
+		if (hedge != hedgeQueries.end())
+		{
+			callback = _hedgeDeliver(hedge->second);
+			for (Action *leg : hedge->second->legs) if (leg) leg->aio.cancel();
+		}
+		else
+		{
+			for (Action *action : active) if (action->queryID() == queryID)
+			{
+				action->aio.cancel();
+				return true;
+			}
+			return false;
+		}
+	}
+
+	if (callback) callback(nng::error::canceled, nng::msg());
+	return true;
+}
+
+void Request::reserve(size_t concurrent)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+
+	while (active.size() + idle.size() < concurrent)
+	{
+		Action *action = new Action{this};
+		action->ctx = make_ctx();
+		action->aio = nng::make_aio(&Action::_callback, action);
+		idle.push_back(action);
+	}
+}
+
+void Request::enableHedging(const HedgePolicy &policy)
+{
+	std::lock_guard<std::mutex> lock(hedge_mtx);
+	_hedgePolicy = policy;
+	_hedging = true;
+}
+void Request::disableHedging()
+{
+	_hedging = false;
+}
+
+Request::HedgeStats Request::hedgeStats() const noexcept
+{
+	return HedgeStats{_hedgeRequests.load(), _hedgeCount.load(), _hedgeWins.load()};
+}
+
+const LatencyHistogram *Request::hedgeLatency(std::string_view uri) const
+{
+	std::lock_guard<std::mutex> lock(hedge_mtx);
+	auto pos = _hedgeLatency.find(uri);
+	return (pos != _hedgeLatency.end()) ? &pos->second : nullptr;
+}
+
+QueryID Request::_hedged(nng::msg &&msg, ResponseCallback &&callback, std::string_view uri)
+{
+	// Pick the hedge delay from this URI's latency.
+	LatencyHistogram *latency;
+	uint64_t          window, delay_us;
+	{
+		std::lock_guard<std::mutex> lock(hedge_mtx);
+		auto &policy = _hedgePolicy;
+
+		auto pos = _hedgeLatency.find(uri);
+		if (pos == _hedgeLatency.end())
+		{
+			if (_hedgeLatency.size() >= policy.maxUris) uri = "*";
+			pos = _hedgeLatency.find(uri);
+			if (pos == _hedgeLatency.end()) pos = _hedgeLatency.emplace(std::piecewise_construct,
+				std::forward_as_tuple(uri), std::forward_as_tuple()).first;
+		}
+		latency = &pos->second;
+		window  = policy.window;
+
+		delay_us = (latency->count() >= policy.minSamples)
+			? latency->percentile(policy.percentile)
+			: uint64_t(policy.startDelay_ms) * 1000;
+		delay_us = std::max<uint64_t>(delay_us, uint64_t(policy.minDelay_ms) * 1000);
+		delay_us = std::min<uint64_t>(delay_us, uint64_t(policy.maxDelay_ms) * 1000);
+	}
+
+	nng_msg *dup = nullptr;
+	if (int result = nng_msg_dup(&dup, msg.get()))
+		throw nng::exception(result, "Request hedge (duplicate message)");
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Hedge *hedge;
+	if (hedgeIdle.empty())
+	{
+		hedge = new Hedge{this};
+		hedges.push_back(hedge);
+		hedge->timer = nng::make_aio(&Hedge::_timerCallback, hedge);
+	}
+	else
+	{
+		hedge = hedgeIdle.back();
+		hedgeIdle.pop_back();
+	}
+
+	hedge->duplicate = nng::msg(dup);
+	hedge->callback  = std::move(callback);
+	hedge->latency   = latency;
+	hedge->window    = window;
+	hedge->legs[0]   = hedge->legs[1] = nullptr;
+	hedge->queryID   = 0;
+	hedge->pending   = 1; // The timer
+	hedge->done      = false;
+
+	try
+	{
+		_hedgeLaunch(hedge, 0, std::move(msg));
+	}
+	catch (...)
+	{
+		hedge->duplicate = nng::msg();
+		hedge->callback  = nullptr;
+		hedgeIdle.push_back(hedge);
+		throw;
+	}
+	++_hedgeRequests;
+
+	// Legs' contexts return to the pool before the hedge is delivered, so hedges get their own IDs.
+	hedge->queryID = HedgeIDBit | (_nextHedgeID++ & ~HedgeIDBit);
+	hedgeQueries[hedge->queryID] = hedge;
+
+	nng_sleep_aio(nng_duration((delay_us + 999) / 1000), hedge->timer.get());
+
+	return hedge->queryID;
+}
+
+void Request::_hedgeLaunch(Hedge *hedge, unsigned leg, nng::msg &&msg)
+{
+	Action *action = _acquire();
+	action->callback = [hedge, leg](AsyncError status, nng::msg &&response)
+	{
+		hedge->request->_hedgeFinish(hedge, leg, status, std::move(response));
+	};
+	hedge->legs[leg]    = action;
+	hedge->started[leg] = Hedge::Clock::now();
+	++hedge->pending;
+
+	action->state = SEND;
+	active.insert(action);
+
+	action->since = hedge->started[leg];
+	metrics.countSend(msg.get());
+	action->aio.set_msg(std::move(msg));
+	action->ctx.send(action->aio);
+}
+
+void Request::Hedge::_timerCallback(void *_hedge)
+{
+	auto hedge = static_cast<Request::Hedge*>(_hedge);
+	auto comm  = hedge->request;
+
+	bool expired = (hedge->timer.result() == nng::error::success);
+
+	std::lock_guard<std::mutex> lock(comm->mtx);
+
+	if (expired && !hedge->done && comm->isReady())
+	{
+		// No reply yet; send the duplicate.
+		try
+		{
+			comm->_hedgeLaunch(hedge, 1, std::move(hedge->duplicate));
+			++comm->_hedgeCount;
+		}
+		catch (nng::exception &)
+		{
+			// Couldn't hedge; the original request carries on.
+		}
+	}
+
+	hedge->duplicate = nng::msg();
+	comm->_hedgeRelease(hedge);
+}
+
+void Request::_hedgeFinish(Hedge *hedge, unsigned leg, AsyncError status, nng::msg &&response)
+{
+	ResponseCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+
+		bool success = (status.nng_status == nng::error::success);
+
+		hedge->legs[leg] = nullptr;
+		if (success)
+		{
+			if (hedge->latency->count() >= hedge->window) hedge->latency->decay();
+			hedge->latency->recordSince(hedge->started[leg]);
+		}
+
+		// A failure is final only if no other attempt is in flight.
+		Action *other = hedge->legs[1-leg];
+		if (!hedge->done && (success || !other))
+		{
+			callback = _hedgeDeliver(hedge);
+			if (other) other->aio.cancel();
+			if (success && leg == 1) ++_hedgeWins;
+		}
+
+		_hedgeRelease(hedge);
+	}
+
+	if (callback) callback(status, std::move(response));
+}
+
+ResponseCallback Request::_hedgeDeliver(Hedge *hedge)
+{
+	hedge->done = true;
+	hedge->timer.cancel();
+	auto entry = hedgeQueries.find(hedge->queryID);
+	if (entry != hedgeQueries.end() && entry->second == hedge) hedgeQueries.erase(entry);
+
+	ResponseCallback callback = std::move(hedge->callback);
+	hedge->callback = nullptr;
+	return callback;
+}
+
+void Request::_hedgeRelease(Hedge *hedge)
+{
+	if (--hedge->pending == 0) hedgeIdle.push_back(hedge);
+}
+
+Request::Action *Request::_acquire()
+{
+	if (idle.empty())
+	{
+		Action *action = new Action{this};
+		action->ctx = make_ctx();
+		action->aio = nng::make_aio(&Action::_callback, action);
+		return action;
+	}
+
+	Action *action = idle.back();
+	idle.pop_back();
+	return action;
+}
+
 void Request::Action::_callback(void *_action)
 {
 	auto action = static_cast<Request::Action*>(_action);
@@ -139,6 +462,40 @@ void Request::Action::_callback(void *_action)
 
 	// Errors / callbacks
 	auto error = action->aio.result();
+
+	if (error == nng::error::success)
+	{
+		if (action->state == RECV)
+		{
+			comm->metrics.countRecv(nng_aio_get_msg(action->aio.get()));
+			comm->metrics.recordLatencySince(action->since);
+		}
+	}
+	else if (error != nng::error::canceled) comm->metrics.countError();
+	if (action->callback)
+	{
+		// Continuation: no handler, no bookkeeping.
+		if (error == nng::error::success && action->state == SEND)
+		{
+			// Sent; await the response.
+		}
+		else
+		{
+			TELLING_ALLOC_STAGE(HANDLER);
+			auto callback = std::move(action->callback);
+			if (error == nng::error::success && action->state == RECV)
+			{
+				callback(AsyncError(), action->aio.release_msg());
+			}
+			else
+			{
+				callback(error, nng::msg());
+				cancel = true;
+			}
+			cleanup = true;
+		}
+	}
+	else
 	{
 		auto handler = comm->_handler.lock();
 
@@ -161,7 +518,10 @@ void Request::Action::_callback(void *_action)
 				break;
 			case RECV:
 				// Receive the response
-				handler->async_recv(action->requesting(), action->aio.release_msg());
+				{
+					TELLING_ALLOC_STAGE(HANDLER);
+					handler->async_recv(action->requesting(), action->aio.release_msg());
+				}
 				cleanup = true;
 			default:
 			case IDLE:
@@ -233,11 +593,20 @@ public:
 		std::promise<nng::msg> promise;
 	};
 
-	std::mutex                           mtx;
-	std::unordered_map<QueryID, Pending> pending;
+	using PendingMap = std::unordered_map<QueryID, Pending>;
+
+	std::mutex                         mtx;
+	PendingMap                         pending;
+	std::vector<PendingMap::node_type> spare; // Map nodes kept for reuse
 
 	QueryID newQueryID = 0;
 
+	// Recycle a finished query's map node.
+	void _finish(PendingMap::iterator pos)
+	{
+		spare.push_back(pending.extract(pos));
+	}
+
 	Delegate() {}
 	~Delegate() {}
 
@@ -258,9 +627,16 @@ public:
 	
 	void async_prep(Requesting req, nng::msg &query) final
 	{
-		// TODO could more cheaply allocate nng::msg?
 		std::lock_guard g(mtx);
-		pending.emplace(req.id, Pending{});
+		if (spare.size())
+		{
+			auto node = std::move(spare.back());
+			spare.pop_back();
+			node.key()    = req.id;
+			node.mapped() = Pending{};
+			pending.insert(std::move(node));
+		}
+		else pending.emplace(req.id, Pending{});
 		newQueryID = req.id;
 	}
 	void async_sent(Requesting req)                        final
@@ -276,7 +652,7 @@ public:
 		if (pos != pending.end())
 		{
 			pos->second.promise.set_value(std::move(response));
-			pending.erase(pos);
+			_finish(pos);
 		}
 	}
 	void async_error(Requesting req, AsyncError status)     final
@@ -289,7 +665,7 @@ public:
 				nng::exception(status, pos->second.sent
 					? "Request could not be fulfilled."
 					: "Request could not be sent.")));
-			pending.erase(pos);
+			_finish(pos);
 		}
 	}
 };
@@ -299,6 +675,11 @@ Request_Box::Request_Box()                     : Request() {_init();}
 Request_Box::Request_Box(const Request_Base &o)    : Request(o) {_init();}
 Request_Box::~Request_Box()                    {}
 
+size_t Request_Box::footprint() const noexcept
+{
+	return Request::footprint() + (sizeof(Request_Box) - sizeof(Request)) + sizeof(Delegate);
+}
+
 void Request_Box::_init()
 {
 	_requestBox = std::make_shared<Delegate>();
@@ -0,0 +1,217 @@
+#include <telling/executor.h>
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+
+using namespace telling;
+
+
+struct Executor::Worker
+{
+	std::mutex         mtx;
+	std::deque<Queue*> runnable[PRIORITY_COUNT]; // Queues with jobs, taking turns
+	std::thread        thread;
+};
+
+namespace
+{
+	// The executor and worker index of the current thread, if it is a worker.
+	thread_local Executor *currentExecutor = nullptr;
+	thread_local unsigned  currentWorker   = 0;
+
+	void PinThread(std::thread &thread, unsigned index)
+	{
+		unsigned cpus = std::thread::hardware_concurrency();
+		if (!cpus) return;
+		unsigned cpu = index % cpus;
+
+#if defined(_WIN32)
+		SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+		(void) thread; (void) cpu; // Not supported on this platform.
+#endif
+	}
+}
+
+
+Executor::Executor(const Config &config)
+{
+	unsigned count = config.threads ? config.threads : std::thread::hardware_concurrency();
+	if (!count) count = 1;
+
+	for (unsigned p = 0; p < PRIORITY_COUNT; ++p) _shared[p].reset(new Queue(*this, PRIORITY(p), ~size_t(0)));
+
+	for (unsigned i = 0; i < count; ++i) _workers.emplace_back(new Worker);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		auto &worker = *_workers[i];
+		worker.thread = std::thread(&Executor::_run, this, i);
+		if (config.pinThreads) PinThread(worker.thread, i);
+	}
+}
+
+Executor::~Executor()
+{
+	{
+		std::lock_guard<std::mutex> g(_idle_mtx);
+		_stop = true;
+	}
+	_idle_cond.notify_all();
+
+	for (auto &worker : _workers) worker->thread.join();
+}
+
+
+void Executor::post(Job &&job, PRIORITY priority)
+{
+	_shared[priority]->post(std::move(job));
+}
+
+void Executor::_schedule(Queue *queue, unsigned index)
+{
+	auto &worker = *_workers[index];
+	std::lock_guard<std::mutex> g(worker.mtx);
+	worker.runnable[queue->_priority].push_back(queue);
+}
+
+bool Executor::_take(unsigned self, Job &job, Queue* &queue)
+{
+	const unsigned count = unsigned(_workers.size());
+
+	for (unsigned p = 0; p < PRIORITY_COUNT; ++p)
+	{
+		// The next queue in our own rotation, or steal the last turn from another worker.
+		queue = nullptr;
+		for (unsigned i = 0; i < count && !queue; ++i)
+		{
+			auto &worker = *_workers[(self + i) % count];
+			std::lock_guard<std::mutex> g(worker.mtx);
+			auto &runnable = worker.runnable[p];
+			if (runnable.empty()) continue;
+			if (i == 0) {queue = runnable.front(); runnable.pop_front();}
+			else        {queue = runnable.back();  runnable.pop_back();}
+		}
+		if (!queue) continue;
+
+		// Take one job; a queue with more goes to the back of our rotation, where others may steal it.
+		bool more;
+		{
+			std::lock_guard<std::mutex> g(queue->_mtx);
+			job = std::move(queue->_jobs.front());
+			queue->_jobs.pop_front();
+			more = queue->_jobs.size();
+			if (!more) queue->_scheduled = false;
+		}
+		_pending.fetch_sub(1);
+		if (more) _schedule(queue, self);
+		return true;
+	}
+	return false;
+}
+
+void Executor::_run(unsigned self)
+{
+	currentExecutor = this;
+	currentWorker   = self;
+
+	while (true)
+	{
+		Job    job;
+		Queue *queue;
+		if (_take(self, job, queue))
+		{
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				// Jobs are expected to report their own errors.
+			}
+			job = nullptr;
+			queue->_finished();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_idle_mtx);
+		if (_stop && _pending.load() == 0) break;
+
+		// Register as a sleeper before checking for work, so posts can't be missed.
+		_sleepers.fetch_add(1);
+		_idle_cond.wait(lock, [this] {return _stop || _pending.load() > 0;});
+		_sleepers.fetch_sub(1);
+	}
+
+	currentExecutor = nullptr;
+}
+
+
+Executor::Queue::Queue(Executor &executor, PRIORITY priority, size_t capacity) :
+	_executor(executor), _priority(priority), _capacity(capacity ? capacity : 1)
+{
+}
+
+Executor::Queue::~Queue()
+{
+	drain();
+}
+
+bool Executor::Queue::post(Job &&job)
+{
+	// Reserve a place, backing out if the queue is full.
+	if (_inFlight.fetch_add(1) >= _capacity)
+	{
+		_finished();
+		return false;
+	}
+
+	// Count the job first, so a worker taking it can't see the count go below zero.
+	_executor._pending.fetch_add(1);
+
+	bool schedule;
+	{
+		std::lock_guard<std::mutex> g(_mtx);
+		_jobs.push_back(std::move(job));
+		schedule = !_scheduled;
+		_scheduled = true;
+	}
+
+	// Idle queues join a worker's rotation: workers keep their own work local; other threads spread it round-robin.
+	if (schedule) _executor._schedule(this, (currentExecutor == &_executor)
+		? currentWorker
+		: (_executor._nextWorker.fetch_add(1, std::memory_order_relaxed) % _executor._workers.size()));
+
+	// Wake a sleeping worker, if any.
+	if (_executor._sleepers.load())
+	{
+		std::lock_guard<std::mutex> g(_executor._idle_mtx);
+		_executor._idle_cond.notify_one();
+	}
+	return true;
+}
+
+void Executor::Queue::drain()
+{
+	std::unique_lock<std::mutex> lock(_drain_mtx);
+	_drain_cond.wait(lock, [this] {return _inFlight.load() == 0;});
+}
+
+void Executor::Queue::_finished()
+{
+	if (_inFlight.fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> g(_drain_mtx);
+		_drain_cond.notify_all();
+	}
+}
@@ -1,3 +1,5 @@
+#include <map>
+#include <cctype>
 #include <unordered_map>
 #include <nngpp/aio.h>
 
@@ -8,6 +10,101 @@
 using namespace telling;
 
 
+namespace
+{
+	/*
+		Incremental decoder for chunked transfer encoding.
+	*/
+	struct ChunkDecoder
+	{
+		enum STATE {SIZE, EXTENSION, SIZE_LF, DATA, DATA_CR, DATA_LF, TRAILER, TRAILER_LF, DONE};
+
+		STATE    state     = SIZE;
+		uint64_t remaining = 0;
+		bool     lineEmpty = true;
+
+		bool done() const noexcept    {return state == DONE;}
+
+		/*
+			Decode some bytes, passing each run of body data to out(data, length).
+				Returns false on a framing error.
+		*/
+		template<class Fn>
+		bool feed(const char *p, size_t n, Fn &&out)
+		{
+			const char *e = p + n;
+			while (p < e && state != DONE)
+			{
+				if (state == DATA)
+				{
+					size_t take = size_t(std::min<uint64_t>(remaining, uint64_t(e-p)));
+					out(p, take);
+					p += take;
+					if (!(remaining -= take)) state = DATA_CR;
+					continue;
+				}
+
+				char c = *p++;
+				switch (state)
+				{
+				case SIZE:
+					if      (c >= '0' && c <= '9') remaining = remaining*16 + unsigned(c-'0');
+					else if (c >= 'a' && c <= 'f') remaining = remaining*16 + unsigned(c-'a'+10);
+					else if (c >= 'A' && c <= 'F') remaining = remaining*16 + unsigned(c-'A'+10);
+					else if (c == ';' || c == ' ' || c == '\t') state = EXTENSION;
+					else if (c == '\r') state = SIZE_LF;
+					else if (c == '\n') _sizeDone();
+					else return false;
+					if (remaining > (uint64_t(1) << 48)) return false;
+					break;
+				case EXTENSION:
+					if      (c == '\r') state = SIZE_LF;
+					else if (c == '\n') _sizeDone();
+					break;
+				case SIZE_LF:
+					if (c != '\n') return false;
+					_sizeDone();
+					break;
+				case DATA_CR:
+					if      (c == '\r') state = DATA_LF;
+					else if (c == '\n') state = SIZE;
+					else return false;
+					break;
+				case DATA_LF:
+					if (c != '\n') return false;
+					state = SIZE;
+					break;
+				case TRAILER:
+					if      (c == '\r') state = TRAILER_LF;
+					else if (c == '\n') _lineDone();
+					else lineEmpty = false;
+					break;
+				case TRAILER_LF:
+					if (c != '\n') return false;
+					_lineDone();
+					break;
+				default:
+					break;
+				}
+			}
+			return true;
+		}
+
+	private:
+		void _sizeDone() noexcept
+		{
+			if (remaining) state = DATA;
+			else          {state = TRAILER; lineEmpty = true;}
+		}
+		void _lineDone() noexcept
+		{
+			if (lineEmpty) state = DONE;
+			else          {state = TRAILER; lineEmpty = true;}
+		}
+	};
+}
+
+
 struct HttpClient::Action
 {
 	friend class Request;
@@ -23,6 +120,18 @@ struct HttpClient::Action
 
 	MsgCompletion     res_completion = {};
 	size_t            recv_count = 0;
+	ResponseCallback  callback;
+	bool              reused    = false; // Connection came from the pool
+	bool              keepAlive = false; // Response allows reusing the connection
+
+	// Streaming responses
+	bool              streaming = false;
+	bool              headDone  = false;
+	uint64_t          bodyCount = 0;
+	ChunkDecoder      chunks;
+
+	// Pass body bytes to the handler; returns false on a framing error.
+	bool _streamBody(Handler &handler, const char *data, size_t length);
 
 	HttpRequesting requesting() const noexcept    {return HttpRequesting{client, queryID};}
 
@@ -38,6 +147,8 @@ HttpClient::MsgStats HttpClient::msgStats() const noexcept
 
 	for (auto &i : active) switch (i->state)
 	{
+	case WAIT:
+	case CONNECT:
 	case SEND: ++stats.awaiting_send; break;
 	case RECV: ++stats.awaiting_recv; break;
 	default: break;
@@ -53,10 +164,7 @@ HttpClient::HttpClient(nng::url &&_host, std::weak_ptr<Handler> handler) :
 {
 	if (this->host->u_scheme == std::string_view("https"))
 	{
-		tls = nng::tls::config(nng::tls::mode::client);
-		tls.config_auth_mode(nng::tls::auth_mode::none);
-		//tls.config_ca_chain()
-		//tls. ;
+		tls = SharedTlsConfig(this->host->u_hostname);
 		client.set_tls(tls);
 	}
 
@@ -64,6 +172,25 @@ HttpClient::HttpClient(nng::url &&_host, std::weak_ptr<Handler> handler) :
 }
 HttpClient::~HttpClient()
 {
+	// Fail requests waiting for a connection.
+	std::deque<Action*> unstarted;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		unstarted.swap(waiting);
+		for (auto *action : unstarted) active.erase(action);
+	}
+	auto handler = _handler.lock();
+	for (auto *action : unstarted)
+	{
+		if (action->callback)
+		{
+			auto callback = std::move(action->callback);
+			callback(nng::error::canceled, nng::msg());
+		}
+		else if (handler) handler->async_error(action->requesting(), nng::error::canceled);
+		delete action;
+	}
+
 	// Cancel all active AIO
 	{
 		std::lock_guard<std::mutex> lock(mtx);
@@ -82,11 +209,63 @@ HttpClient::~HttpClient()
 		else        break;
 	}
 
-	// Clean up idle AIO
+	// Clean up idle AIO and connections
 	for (Action *action : idle)
 	{
 		delete action;
 	}
+	pooledConns.clear();
+}
+
+
+namespace
+{
+	struct TlsCache
+	{
+		std::mutex                                            mtx;
+		std::map<std::string, nng::tls::config, std::less<>> configs;
+		std::deque<nng::tls::config>                          replaced; // May still be referenced
+	};
+
+	TlsCache &GetTlsCache()
+	{
+		static TlsCache cache;
+		return cache;
+	}
+}
+
+nng::tls::config_view HttpClient::SharedTlsConfig(std::string_view hostname)
+{
+	auto &cache = GetTlsCache();
+	std::lock_guard<std::mutex> lock(cache.mtx);
+
+	auto pos = cache.configs.find(hostname);
+	if (pos == cache.configs.end())
+	{
+		std::string name(hostname);
+		nng::tls::config config(nng::tls::mode::client);
+		config.config_auth_mode(nng::tls::auth_mode::none);
+		config.config_server(name.c_str());
+		pos = cache.configs.emplace(std::move(name), std::move(config)).first;
+	}
+	return pos->second;
+}
+
+void HttpClient::SetSharedTlsConfig(std::string_view hostname, nng::tls::config &&config)
+{
+	if (!config)
+		throw nng::exception(nng::error::inval, "HttpClient::SetSharedTlsConfig (empty config)");
+
+	auto &cache = GetTlsCache();
+	std::lock_guard<std::mutex> lock(cache.mtx);
+
+	auto pos = cache.configs.find(hostname);
+	if (pos != cache.configs.end())
+	{
+		cache.replaced.push_back(std::move(pos->second));
+		pos->second = std::move(config);
+	}
+	else cache.configs.emplace(std::string(hostname), std::move(config));
 }
 
 
@@ -109,41 +288,253 @@ QueryID HttpClient::request(nng::msg &&req)
 
 	std::lock_guard<std::mutex> lock(mtx);
 
-	// Allocate.
-	Action *action = nullptr;
-	if (idle.empty())
+	Action *action = _acquire();
+
+	handler->async_prep(action->requesting(), req);
+
+	if (!req)
 	{
-		action = new Action{this};
-		action->aio = nng::make_aio(&Action::_callback, action);
+		idle.push_front(action);
+		action = nullptr;
+		throw nng::exception(nng::error::canceled,
+			"AsyncQuery declined the message.");
+	}
+
+	active.insert(action);
+	
+	// Stow request and connect...
+	action->req = std::move(req);
+	_start(action);
+
+	return action->queryID;
+}
+
+QueryID HttpClient::request(nng::msg &&req, ResponseCallback &&callback)
+{
+	if (!callback)
+		throw nng::exception(nng::error::inval, "HttpClient::request (empty callback)");
+	if (!req)
+		throw nng::exception(nng::error::inval, "HttpClient::request (empty message)");
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Action *action = _acquire();
+	action->callback = std::move(callback);
+	active.insert(action);
+
+	action->req = std::move(req);
+	_start(action);
+
+	return action->queryID;
+}
+
+
+void HttpClient::configurePool(const PoolConfig &config)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	pool = config;
+	if (!pool.keepAlive)
+	{
+		connCount -= pooledConns.size();
+		pooledConns.clear();
+	}
+}
+
+HttpClient::PoolConfig HttpClient::poolConfig() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return pool;
+}
+
+size_t HttpClient::openConnections() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return connCount;
+}
+
+size_t HttpClient::idleConnections() const
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return pooledConns.size();
+}
+
+
+void HttpClient::_start(Action *action)
+{
+	// Connections idle for too long may have been closed by the server.
+	auto now = std::chrono::steady_clock::now();
+	auto timeout = std::chrono::milliseconds(pool.idleTimeout_ms);
+	while (pooledConns.size() && now - pooledConns.front().since >= timeout)
+	{
+		pooledConns.pop_front();
+		--connCount;
+	}
+
+	if (pooledConns.size())
+	{
+		// Reuse the most recently pooled connection.
+		action->conn   = std::move(pooledConns.back().conn);
+		action->reused = true;
+		pooledConns.pop_back();
+		_send(action);
+	}
+	else if (!pool.maxConnections || connCount < pool.maxConnections)
+	{
+		++connCount;
+		action->reused = false;
+		action->state  = CONNECT;
+		client.connect(action->aio);
 	}
 	else
 	{
-		action = idle.front();
-		idle.pop_front();
+		action->state = WAIT;
+		waiting.push_back(action);
 	}
+}
 
-	action->queryID = nextQueryID++;
+void HttpClient::_send(Action *action)
+{
+	action->state = SEND;
+	action->iov = nng_iov{action->req.body().get().data(), action->req.body().size()};
+	action->aio.set_iov(action->iov);
+	action->conn.write(action->aio);
+}
+
+void HttpClient::_releaseConn(nng::http::conn &&conn)
+{
+	if (waiting.size())
+	{
+		Action *next = waiting.front();
+		waiting.pop_front();
+		next->conn   = std::move(conn);
+		next->reused = true;
+		_send(next);
+	}
+	else
+	{
+		pooledConns.push_back(PooledConn{std::move(conn), std::chrono::steady_clock::now()});
+	}
+}
+
+void HttpClient::_dropConn()
+{
+	--connCount;
+	if (waiting.size())
+	{
+		Action *next = waiting.front();
+		waiting.pop_front();
+		++connCount;
+		next->reused = false;
+		next->state  = CONNECT;
+		client.connect(next->aio);
+	}
+}
+
+
+namespace
+{
+	bool SameToken(std::string_view a, std::string_view b) noexcept
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+			if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+		return true;
+	}
+
+	// Check whether a response leaves its connection open for another request.
+	bool KeepAlive(const MsgView::Reply &msg)
+	{
+		for (auto &header : msg.headers())
+		{
+			if (!header.is("Connection")) continue;
+			if (SameToken(header.value, "close"))      return false;
+			if (SameToken(header.value, "keep-alive")) return true;
+		}
+		return msg.protocolString() != "HTTP/1.0";
+	}
+
+	// Check whether a request may safely be sent twice.
+	bool IsIdempotent(nng::msg &req)
+	{
+		try                   {return MsgView::Request(req).method().isIdempotent();}
+		catch (MsgException&) {return false;}
+	}
+}
+
+QueryID HttpClient::requestStreaming(nng::msg &&req)
+{
+	auto handler = this->_handler.lock();
+	if (!handler)
+		throw nng::exception(nng::error::exist, "Request communicator has no message handler");
+
+	std::lock_guard<std::mutex> lock(mtx);
+
+	Action *action = _acquire();
 
 	handler->async_prep(action->requesting(), req);
 
 	if (!req)
 	{
 		idle.push_front(action);
-		action = nullptr;
 		throw nng::exception(nng::error::canceled,
 			"AsyncQuery declined the message.");
 	}
 
-	action->state = CONNECT;
+	action->streaming = true;
 	active.insert(action);
-	
-	// Stow request and connect...
+
 	action->req = std::move(req);
-	action->client->client.connect(action->aio);
+	_start(action);
 
 	return action->queryID;
 }
 
+HttpClient::Action *HttpClient::_acquire()
+{
+	Action *action = nullptr;
+	if (idle.empty())
+	{
+		action = new Action{this};
+		action->aio = nng::make_aio(&Action::_callback, action);
+	}
+	else
+	{
+		action = idle.front();
+		idle.pop_front();
+	}
+
+	action->queryID = nextQueryID++;
+	return action;
+}
+
+bool HttpClient::Action::_streamBody(Handler &handler, const char *data, size_t length)
+{
+	auto req = requesting();
+	auto out = [&](const char *p, size_t n)
+	{
+		bodyCount += n;
+		if (n) handler.async_response_body(req, nng::view(p, n));
+	};
+
+	if (res_completion.is_chunked)
+	{
+		if (!chunks.feed(data, length, out)) return false;
+		res_completion.complete = chunks.done();
+	}
+	else if (res_completion.length_header)
+	{
+		uint64_t remaining = res_completion.message_length - bodyCount;
+		out(data, size_t(std::min<uint64_t>(remaining, length)));
+		res_completion.complete = (bodyCount >= res_completion.message_length);
+	}
+	else
+	{
+		// Unframed; completes when the server closes the connection.
+		out(data, length);
+	}
+	return true;
+}
+
 void HttpClient::Action::_callback(void *_action)
 {
 	auto action = static_cast<HttpClient::Action*>(_action);
@@ -151,10 +542,15 @@ void HttpClient::Action::_callback(void *_action)
 	auto handler = client->_handler.lock();
 
 	bool disconnect = false;
+	bool failed     = false;
+	bool retry      = false;
+
+	// Continuation requests don't report progress to the handler.
+	if (action->callback) handler = nullptr;
 
 	// Callbacks / Errors?
 	auto error = action->aio.result();
-	if (!handler)
+	if (!handler && !action->callback)
 	{
 		disconnect = true;
 	}
@@ -165,14 +561,63 @@ void HttpClient::Action::_callback(void *_action)
 		{
 		case CONNECT:
 			action->conn = nng::http::conn(action->aio.get_output<nng_http_conn>(0));
-			handler->httpConn_open(action->conn);
+			if (handler) handler->httpConn_open(action->conn);
 			break;
 		case SEND:
-			// Send
-			handler->async_sent(action->requesting());
-			action->req = nng::msg();
+			// Send (the request is kept until completion in case it must be retried)
+			if (handler) handler->async_sent(action->requesting());
 			break;
 		case RECV:
+			if (action->streaming && handler)
+			{
+				size_t got = action->aio.count();
+				const char *data = action->res.body().get().data<char>() + action->recv_count;
+				bool framed = true;
+
+				if (action->headDone)
+				{
+					framed = action->_streamBody(*handler, data, got);
+				}
+				else try
+				{
+					action->recv_count += got;
+					action->res.realloc(action->recv_count);
+
+					MsgView::Reply msg(action->res);
+					action->headDone       = true;
+					action->res_completion = msg.completion();
+					action->res_completion.complete = false;
+					action->keepAlive      = KeepAlive(msg);
+
+					// Deliver the head, then any body bytes that came with it.
+					size_t headSize = action->recv_count - msg.bodySize();
+					handler->async_response_head(action->requesting(), msg);
+
+					if (action->res_completion.length_header && !action->res_completion.message_length)
+						action->res_completion.complete = true;
+					else
+						framed = action->_streamBody(*handler,
+							action->res.body().get().data<char>() + headSize, action->recv_count - headSize);
+
+					// Keep only the head; the body buffer is reused.
+					action->res.realloc(headSize);
+					action->recv_count = headSize;
+				}
+				catch (MsgException &)
+				{
+					// Head is not complete yet
+				}
+
+				if (!framed)
+				{
+					action->res_completion = {};
+					handler->async_error(action->requesting(), nng::error::proto);
+					disconnect = true;
+					failed     = true;
+				}
+				break;
+			}
+
 			// Receive the response
 			action->recv_count += action->aio.count();
 			action->res.realloc(action->recv_count);
@@ -182,8 +627,9 @@ void HttpClient::Action::_callback(void *_action)
 				MsgView::Reply msg(action->res);
 
 				action->res_completion = msg.completion();
+				if (action->res_completion.complete) action->keepAlive = KeepAlive(msg);
 
-				handler->async_response_progress(action->requesting(), action->res_completion, msg);
+				if (handler) handler->async_response_progress(action->requesting(), action->res_completion, msg);
 			}
 			catch (MsgException &)
 			{
@@ -203,9 +649,20 @@ void HttpClient::Action::_callback(void *_action)
 	case nng::error::connreset:
 	case nng::error::connshut:
 	case nng::error::closed:
-		// 
-		if (action->res_completion.implicit())
+		// A pooled connection may have been closed by the server while idle.
+		//   Once the request is written the server may have run it, so only idempotent ones are sent again.
+		if (action->reused && action->recv_count == 0
+			&& (action->state == SEND || (action->state == RECV && IsIdempotent(action->req))))
+		{
+			retry = true;
+			break;
+		}
+
+		// Server closed the connection: this completes an unframed response.
+		if (action->state == RECV && action->recv_count && action->res_completion.implicit()
+			&& (!action->streaming || action->headDone))
 		{
+			disconnect = true;
 			break;
 		}
 		else
@@ -218,27 +675,52 @@ void HttpClient::Action::_callback(void *_action)
 	default:
 		// Causes the query to be canceled.
 		action->res_completion = {};
-		handler->async_error(action->requesting(), error);
+		if (action->callback)
+		{
+			auto callback = std::move(action->callback);
+			callback(error, nng::msg());
+		}
+		else if (handler) handler->async_error(action->requesting(), error);
 		disconnect = true;
+		failed     = true;
 		break;
 	}
 
 
-	if (disconnect || action->res_completion.complete)
+	bool keepConn = false;
+
+	if (retry)
+	{
+		// Discard the stale connection; the request goes out again on a new one.
+		if (handler) handler->httpConn_close(action->conn);
+		action->conn = nng::http::conn();
+		action->res  = nng::msg();
+	}
+	else if (disconnect || action->res_completion.complete)
 	{
 		disconnect = true;
 
 		// Turn message over to handler
-		if (action->res_completion.complete || (action->res_completion.implicit() && disconnect))
+		if (!failed && (action->res_completion.complete || action->res_completion.implicit()))
 		{
-			if (handler)
+			if (action->callback)
+			{
+				auto callback = std::move(action->callback);
+				callback(AsyncError(), std::move(action->res));
+			}
+			else if (handler)
 			{
 				handler->async_recv(action->requesting(), std::move(action->res));
 			}
 		}
+		action->callback = nullptr;
+
+		// Keep the connection if the response was framed and allows it.
+		keepConn = !failed && action->conn && action->keepAlive
+			&& action->res_completion.complete && !action->res_completion.implicit();
 
 		// Disconnect
-		if (action->conn)
+		if (action->conn && !keepConn)
 		{
 			if (handler)
 			{
@@ -250,6 +732,12 @@ void HttpClient::Action::_callback(void *_action)
 		// Clean up
 		action->req = nng::msg();
 		action->res = nng::msg();
+		action->res_completion = {};
+		action->keepAlive = false;
+		action->streaming = false;
+		action->headDone  = false;
+		action->bodyCount = 0;
+		action->chunks    = ChunkDecoder();
 	}
 
 
@@ -258,17 +746,37 @@ void HttpClient::Action::_callback(void *_action)
 	*/
 	std::lock_guard<std::mutex> lock(client->mtx);
 
-	if (disconnect) action->state = IDLE;
+	if (retry)
+	{
+		action->reused     = false;
+		action->recv_count = 0;
+		action->state      = CONNECT;
+		client->client.connect(action->aio);
+		return;
+	}
+
+	if (disconnect)
+	{
+		// Return the connection to the pool, or give up its place.
+		switch (action->state)
+		{
+		case CONNECT:
+		case SEND:
+		case RECV:
+			if (keepConn && client->pool.keepAlive) client->_releaseConn(std::move(action->conn));
+			else                                    {action->conn = nng::http::conn(); client->_dropConn();}
+			break;
+		default:
+			break;
+		}
+		action->state = IDLE;
+	}
 
 	switch (action->state)
 	{
 	case CONNECT:
 		// Connection made; send request.
-		action->state = SEND;
-		action->iov = nng_iov{action->req.body().get().data(), action->req.body().size()};
-		action->aio.set_iov(action->iov);
-		//action->aio.set_msg(std::move(action->req));
-		action->conn.write(action->aio);
+		client->_send(action);
 		break;
 
 	case SEND:
@@ -296,6 +804,7 @@ void HttpClient::Action::_callback(void *_action)
 
 	case IDLE:
 		// Move action to idle queue
+		action->reused = false;
 		client->active.erase(action);
 		client->idle.push_back(action);
 	}
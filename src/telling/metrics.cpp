@@ -0,0 +1,61 @@
+#include <new>
+#include <ostream>
+
+#include <telling/metrics.h>
+
+
+using namespace telling;
+
+
+LatencyHistogram *CommMetrics::_histogram() noexcept
+{
+	LatencyHistogram *h = _latency.load(std::memory_order_acquire);
+	if (h) return h;
+
+	// Racing threads may each allocate; the loser deletes its copy.
+	h = new (std::nothrow) LatencyHistogram();
+	if (!h) return nullptr;
+
+	LatencyHistogram *expected = nullptr;
+	if (_latency.compare_exchange_strong(expected, h, std::memory_order_acq_rel)) return h;
+	delete h;
+	return expected;
+}
+
+CommMetrics::Snapshot CommMetrics::snapshot() const noexcept
+{
+	Snapshot s = {};
+	s.sent          = _sent     .load(std::memory_order_relaxed);
+	s.received      = _recv     .load(std::memory_order_relaxed);
+	s.bytesSent     = _bytesSent.load(std::memory_order_relaxed);
+	s.bytesReceived = _bytesRecv.load(std::memory_order_relaxed);
+	s.errors        = _errors   .load(std::memory_order_relaxed);
+	if (auto *h = latency())
+	{
+		s.latencyCount  = h->count();
+		s.latency_p50   = h->percentile(0.50);
+		s.latency_p99   = h->percentile(0.99);
+		s.latency_max   = h->max();
+	}
+	return s;
+}
+
+void CommMetrics::reset() noexcept
+{
+	for (auto *counter : {&_sent, &_recv, &_bytesSent, &_bytesRecv, &_errors})
+		counter->store(0, std::memory_order_relaxed);
+	if (auto *h = _latency.load(std::memory_order_acquire)) h->reset();
+}
+
+void CommMetrics::WriteJSON(std::ostream &out, const Snapshot &s)
+{
+	out << "{\"sent\":"           << s.sent
+		<< ",\"received\":"       << s.received
+		<< ",\"bytes_sent\":"     << s.bytesSent
+		<< ",\"bytes_received\":" << s.bytesReceived
+		<< ",\"errors\":"         << s.errors
+		<< ",\"latency\":{\"count\":" << s.latencyCount
+		<< ",\"p50_us\":" << s.latency_p50
+		<< ",\"p99_us\":" << s.latency_p99
+		<< ",\"max_us\":" << s.latency_max << "}}";
+}
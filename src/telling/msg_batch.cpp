@@ -0,0 +1,96 @@
+#include <telling/msg_batch.h>
+
+
+using namespace telling;
+
+
+static_assert(sizeof(MsgLayout) == 8, "MsgLayout should be 8 bytes");
+
+
+void MsgBatch::clear() noexcept
+{
+	_msgs   .clear();
+	_ids    .clear();
+	_layouts.clear();
+	_methods.clear();
+	_lengths.clear();
+	_errors = 0;
+}
+
+void MsgBatch::reserve(size_t capacity)
+{
+	_msgs   .reserve(capacity);
+	_ids    .reserve(capacity);
+	_layouts.reserve(capacity);
+	_methods.reserve(capacity);
+	_lengths.reserve(capacity);
+}
+
+bool MsgBatch::push(nng::msg &&msg, QueryID id)
+{
+	size_t first = size();
+	_append(std::move(msg), id);
+	_parse(first);
+	return valid(first);
+}
+
+void MsgBatch::_parse(size_t first)
+{
+	const size_t count = size();
+	_layouts.resize(count);
+	_methods.resize(count);
+	_lengths.resize(count);
+
+	for (size_t i = first; i < count; ++i)
+	{
+		MsgLayout &layout = _layouts[i];
+		try
+		{
+			if (!_msgs[i]) throw MsgException(MsgError::HEADER_INCOMPLETE, "Message is null");
+			layout._parse_msg(_msgs[i].body().get(), _type);
+		}
+		catch (MsgException&)
+		{
+			layout._parse_reset();
+			_methods[i] = MethodCode::Unknown;
+			_lengths[i] = 0;
+			++_errors;
+			continue;
+		}
+
+		if (layout._binary())
+		{
+			_methods[i] = view(i).method().code;
+		}
+		else
+		{
+			const char *data = _msgs[i].body().data<char>();
+			auto m = layout._method();
+			_methods[i] = m.length ? Method::Parse(std::string_view(data+m.start, m.length)).code : MethodCode::None;
+		}
+
+		size_t length = _msgs[i].body().size() - layout._p_body;
+		_lengths[i] = uint32_t(length < 0xFFFFFFFFu ? length : 0xFFFFFFFFu);
+	}
+}
+
+std::string_view MsgBatch::uri(size_t i) const noexcept
+{
+	if (_layouts[i]._binary()) return view(i).uriString();
+	auto r = _layouts[i]._uri();
+	return std::string_view(_msgs[i].body().data<char>() + r.start, r.length);
+}
+
+size_t MsgBatch::selectPrefix(std::string_view prefix, std::vector<uint32_t> &indices) const
+{
+	size_t found = 0;
+	for (size_t i = 0, n = size(); i < n; ++i)
+	{
+		if (!valid(i)) continue;
+		auto u = uri(i);
+		if (u.substr(0, prefix.length()) != prefix) continue;
+		indices.push_back(uint32_t(i));
+		++found;
+	}
+	return found;
+}
@@ -0,0 +1,154 @@
+#include <atomic>
+
+#include <nngpp/nngpp.h>
+#include <telling/msg_dictionary.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	/*
+		Headers common in Telling traffic.  Append only: indices are part of the wire format.
+	*/
+	std::vector<HeaderDictionary::Entry> StaticEntries()
+	{
+		return
+		{
+			{"Content-Type",      "application/json"},
+			{"Content-Type",      "text/plain"},
+			{"Content-Type",      "text/plain; charset=utf-8"},
+			{"Content-Type",      "application/octet-stream"},
+			{"Content-Type",      "text/html"},
+			{"Content-Type",      ""},
+			{"Content-Length",    ""},
+			{"Accept",            "application/json"},
+			{"Accept",            "*/*"},
+			{"Accept",            ""},
+			{"Allow",             ""},
+			{"Authorization",     ""},
+			{"Cache-Control",     "no-cache"},
+			{"Cache-Control",     ""},
+			{"Connection",        "close"},
+			{"Connection",        "keep-alive"},
+			{"Content-Encoding",  "gzip"},
+			{"Content-Encoding",  ""},
+			{"Date",              ""},
+			{"ETag",              ""},
+			{"Host",              ""},
+			{"Location",          ""},
+			{"Transfer-Encoding", "chunked"},
+			{"User-Agent",        ""},
+		};
+	}
+
+	std::atomic<const HeaderDictionary*> Registry[256] = {};
+}
+
+
+HeaderDictionary::HeaderDictionary(uint8_t _id, size_t base, std::vector<Entry> &&entries) :
+	id(_id), fingerprint(Fingerprint(entries)), _base(base), _entries(std::move(entries))
+{
+	// Entries don't move after this, so the maps may view their strings.
+	for (size_t i = 0; i < _entries.size(); ++i)
+	{
+		auto &e = _entries[i];
+		uint32_t index = uint32_t(_base + i);
+		_names.emplace(e.name, index);
+		if (e.value.size()) _pairs.emplace(std::make_pair(std::string_view(e.name), std::string_view(e.value)), index);
+	}
+}
+
+uint16_t HeaderDictionary::Fingerprint(const std::vector<Entry> &entries) noexcept
+{
+	// FNV-1a over names and values, folded to 16 bits.
+	uint32_t hash = 2166136261u;
+	auto mix = [&](std::string_view s)
+	{
+		for (char c : s) {hash ^= uint8_t(c); hash *= 16777619u;}
+		hash ^= 0xFF; hash *= 16777619u;
+	};
+	for (auto &e : entries) {mix(e.name); mix(e.value);}
+	return uint16_t(hash ^ (hash >> 16));
+}
+
+
+const HeaderDictionary &HeaderDictionary::Static() noexcept
+{
+	static const HeaderDictionary table(0, 0, StaticEntries());
+	return table;
+}
+
+const HeaderDictionary &HeaderDictionary::Register(uint8_t id, std::vector<Entry> entries)
+{
+	if (id == 0)
+		throw nng::exception(nng::error::inval, "HeaderDictionary::Register (ID 0 is the static table)");
+	if (entries.size() > MaxEntries)
+		throw nng::exception(nng::error::inval, "HeaderDictionary::Register (too many entries)");
+	for (auto &e : entries) if (e.name.empty())
+		throw nng::exception(nng::error::inval, "HeaderDictionary::Register (empty header name)");
+
+	// Dictionaries live until exit, so views of their entries stay valid.
+	auto *dictionary = new HeaderDictionary(id, Static().size(), std::move(entries));
+
+	const HeaderDictionary *existing = nullptr;
+	if (Registry[id].compare_exchange_strong(existing, dictionary, std::memory_order_acq_rel)) return *dictionary;
+
+	bool same = existing->fingerprint == dictionary->fingerprint
+		&& existing->_entries.size() == dictionary->_entries.size();
+	for (size_t i = 0; same && i < existing->_entries.size(); ++i)
+		same = existing->_entries[i].name  == dictionary->_entries[i].name
+			&& existing->_entries[i].value == dictionary->_entries[i].value;
+	delete dictionary;
+
+	if (!same) throw nng::exception(nng::error::exist, "HeaderDictionary::Register (ID holds different entries)");
+	return *existing;
+}
+
+const HeaderDictionary *HeaderDictionary::Find(uint8_t id) noexcept
+{
+	return id ? Registry[id].load(std::memory_order_acquire) : &Static();
+}
+
+
+size_t HeaderDictionary::size() const noexcept
+{
+	return _base + _entries.size();
+}
+
+const HeaderDictionary::Entry *HeaderDictionary::at(size_t index) const noexcept
+{
+	if (index < _base)                   return Static().at(index);
+	if (index - _base < _entries.size()) return &_entries[index - _base];
+	return nullptr;
+}
+
+int64_t HeaderDictionary::find(std::string_view name, std::string_view value, bool &exact) const noexcept
+{
+	exact = false;
+
+	// Pairs first, then names; this dictionary before the static table.
+	if (value.size())
+	{
+		auto pair = std::make_pair(name, value);
+		auto i = _pairs.find(pair);
+		if (i != _pairs.end()) {exact = true; return i->second;}
+		if (_base)
+		{
+			auto &s = Static()._pairs;
+			auto j = s.find(pair);
+			if (j != s.end()) {exact = true; return j->second;}
+		}
+	}
+
+	auto i = _names.find(name);
+	if (i != _names.end()) return i->second;
+	if (_base)
+	{
+		auto &s = Static()._names;
+		auto j = s.find(name);
+		if (j != s.end()) return j->second;
+	}
+	return -1;
+}
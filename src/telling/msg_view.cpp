@@ -118,6 +118,8 @@ void MsgLayout::_parse_msg(nng::view msg, TYPE _type)
 		throw MsgException(MsgError::HEADER_INCOMPLETE, "Message data is empty (no header)");
 	if (!msg.data())
 		throw MsgException(MsgError::HEADER_INCOMPLETE, "Message data pointer is null");
+	if (IsBinaryFrame(msg.data(), msg.size()))
+		{_parse_binary(msg, _type); return;}
 
 	std::string_view startLine, headerLine;
 	_parse_reset();
@@ -225,6 +227,76 @@ void MsgLayout::_parse_msg(nng::view msg, TYPE _type)
 
 
 
+void MsgLayout::_setBinary(TYPE type, size_t tableOffset, size_t bodyOffset, bool indexed) noexcept
+{
+	_sl_len   = uint16_t(tableOffset);
+	_sl_nl    = 0;
+	_uri_pos  = (type == TYPE::REQUEST) ? 3 : ((type == TYPE::REPORT) ? 5 : 0);
+	_prt_rpos = uint8_t(int(type) + 1);
+	_sts_rpos = indexed;
+	_p_body   = uint16_t(bodyOffset);
+}
+
+void MsgLayout::_parse_binary(nng::view msg, TYPE _type)
+{
+	using namespace telling::detail;
+
+	const char *begin = msg.data<char>(), *pos = begin, *end = begin + msg.size();
+
+	if (!SkipBinaryStart(pos, end) || end - pos < 2)
+		throw MsgException(MsgError::HEADER_INCOMPLETE, "Binary frame is truncated or malformed");
+
+	TYPE type    = TYPE(uint8_t(begin[1]) & ~BinaryIndexed);
+	bool indexed = uint8_t(begin[1]) & BinaryIndexed;
+	if (_type >= TYPE(0) && _type != type)
+		throw MsgException(MsgError::START_LINE_MALFORMED, "Binary frame has the wrong message type");
+	if (type == TYPE::REQUEST && (uint8_t(begin[2]) == 0 || uint8_t(begin[2]) >= uint8_t(MethodCode::EndOfValidMethods)))
+		throw MsgException(MsgError::START_LINE_MALFORMED, "Binary frame has an unknown method");
+
+	// Header table
+	size_t tableSize = uint8_t(pos[0]) | (size_t(uint8_t(pos[1])) << 8);
+	pos += 2;
+	const char *table = pos;
+	if (tableSize > size_t(end - table))
+		throw MsgException(MsgError::HEADER_INCOMPLETE, "Binary header table is truncated");
+	if (size_t(table - begin) + tableSize > 0xFFFF)
+		throw MsgException(MsgError::HEADER_TOO_BIG, "Headers >= 64 KiB");
+
+	const char *tableEnd = table + tableSize;
+	std::string_view name, value;
+
+	// Indexed tables must name a dictionary this process has, with the same entries.
+	const HeaderDictionary *dictionary = nullptr;
+	if (indexed)
+	{
+		uint8_t  id;
+		uint16_t fingerprint;
+		if (!ReadBinaryDictionary(pos, tableEnd, id, fingerprint))
+			throw MsgException(MsgError::HEADER_MALFORMED, "Binary header table has no dictionary");
+		dictionary = HeaderDictionary::Find(id);
+		if (!dictionary || (id && dictionary->fingerprint != fingerprint))
+			throw MsgException(MsgError::UNKNOWN_PROTOCOL, "Header dictionary is not registered or differs");
+	}
+
+	while (pos < tableEnd)
+	{
+		uint64_t code = 0;
+		if (dictionary && !ReadVarint(pos, tableEnd, code))
+			throw MsgException(MsgError::HEADER_MALFORMED, "Binary header table entry overruns the table");
+
+		bool ok;
+		if      (code == 0) ok = ReadBinaryString(pos, tableEnd, name) && ReadBinaryString(pos, tableEnd, value);
+		else if (code & 1)  ok = dictionary->at((code-1) / 2);
+		else                ok = dictionary->at((code-2) / 2) && ReadBinaryString(pos, tableEnd, value);
+		if (!ok)
+			throw MsgException(MsgError::HEADER_MALFORMED, "Binary header table entry is out of range or overruns the table");
+	}
+
+	_setBinary(type, size_t(table - begin), size_t(tableEnd - begin), indexed);
+}
+
+
+
 MsgCompletion MsgView::completion() const noexcept
 {
 	MsgCompletion comp = {};
@@ -1,4 +1,8 @@
+#include <cstring>
+
 #include <telling/msg_writer.h>
+#include <telling/trace.h>
+#include <telling/alloc_tracking.h>
 
 
 using namespace telling;
@@ -36,14 +40,25 @@ static nng::msgbuf &operator<<(nng::msgbuf &o, std::string_view s)    {o.sputn(s
 static nng::msgbuf &operator<<(nng::msgbuf &o, char c)                {o.sputc(c); return o;}
 
 
-MsgWriter::MsgWriter(MsgProtocol _protocol) : protocol(_protocol) {}
+static void AppendBinaryString(nng::msg_view msg, std::string_view s)
+{
+	char length[detail::MaxVarintSize];
+	msg.body().append(nng::view(length, detail::WriteVarint(length, s.size())));
+	msg.body().append(nng::view(s.data(), s.size()));
+}
+
+
+MsgWriter::MsgWriter(MsgProtocol _protocol, const HeaderDictionary *_dictionary) : protocol(_protocol), dictionary(_dictionary) {}
 
 
 void MsgWriter::_startMsg()
 {
 	if (msg) throw MsgException(MsgError::ALREADY_WRITTEN, 0, 0);
-	*this = MsgWriter(protocol);
+	*this = MsgWriter(protocol, dictionary);
 	msg = nng::make_msg(0).release();
+
+	// Most messages fit; appending then doesn't reallocate.
+	nng_msg_reserve(msg.get(), InitialCapacity);
 }
 
 void MsgWriter::_autoCloseHeaders()
@@ -52,6 +67,19 @@ void MsgWriter::_autoCloseHeaders()
 	{
 		if (!msg) throw MsgException(MsgError::ALREADY_WRITTEN, 0, 0);
 
+		if (protocol.is_binary())
+		{
+			// Complete the header table size; the layout is already known.
+			size_t end = msg.body().size(), table = head.tableOffset + 2u;
+			if (end > 0xFFFF) throw MsgException(MsgError::HEADER_TOO_BIG, 0, 0);
+
+			char *data = msg.body().get().data<char>();
+			data[head.tableOffset]   = char(uint8_t(end - table));
+			data[head.tableOffset+1] = char(uint8_t((end - table) >> 8));
+			_setBinary(TYPE(uint8_t(data[1]) & ~detail::BinaryIndexed), table, end, _indexed());
+			return;
+		}
+
 		// End headers
 		_newline();
 		//this->_p_body = msg.body().size();
@@ -68,8 +96,65 @@ void MsgWriter::_newline()
 }
 
 
+void MsgWriter::_startBinary(TYPE type, Method method, Status status, std::string_view uri, std::string_view reason)
+{
+	char start[5];
+	size_t n = 0;
+	start[n++] = char(detail::BinaryMagic);
+	start[n++] = char(uint8_t(type) | (_indexed() ? detail::BinaryIndexed : 0));
+	if (type == TYPE::REQUEST)
+	{
+		start[n++] = char(method.code);
+	}
+	else
+	{
+		int code = status.toInt();
+		if (code < 100 || code > 999)
+			throw MsgException(MsgError::START_LINE_MALFORMED, 0, 0);
+		start[n++] = char('0' + code/100);
+		start[n++] = char('0' + (code/10)%10);
+		start[n++] = char('0' + code%10);
+	}
+	msg.body().append(nng::view(start, n));
+
+	if (type != TYPE::REPLY)   AppendBinaryString(msg, uri);
+	if (type != TYPE::REQUEST) AppendBinaryString(msg, reason);
+
+	// The header table size is completed when headers are closed.
+	head.tableOffset = (uint16_t) msg.body().size();
+	msg.body().append(nng::view("\0\0", 2));
+
+	if (_indexed())
+	{
+		char prefix[3] = {char(dictionary->id), char(uint8_t(dictionary->fingerprint)), char(uint8_t(dictionary->fingerprint >> 8))};
+		msg.body().append(nng::view(prefix, dictionary->id ? 3 : 1));
+	}
+}
+
+void MsgWriter::_writeBinaryHeader(std::string_view name, std::string_view value, Indexing indexing)
+{
+	if (!_indexed())
+	{
+		AppendBinaryString(msg, name);
+		AppendBinaryString(msg, value);
+		return;
+	}
+
+	bool    exact = false;
+	int64_t index = (indexing == Indexing::NONE) ? -1 : dictionary->find(name, (indexing == Indexing::PAIR) ? value : std::string_view(), exact);
+
+	char code[detail::MaxVarintSize];
+	uint64_t c = (index < 0) ? 0 : 2*uint64_t(index) + (exact ? 1 : 2);
+	msg.body().append(nng::view(code, detail::WriteVarint(code, c)));
+
+	if (index < 0) AppendBinaryString(msg, name);
+	if (!exact)    AppendBinaryString(msg, value);
+}
+
+
 void MsgWriter::startRequest(std::string_view uri, Method method)
 {
+	TELLING_ALLOC_STAGE(WRITE);
 	_startMsg();
 
 	if (!method)
@@ -77,6 +162,8 @@ void MsgWriter::startRequest(std::string_view uri, Method method)
 	if (ContainsWhitespace(uri))
 		throw MsgException(MsgError::START_LINE_MALFORMED, 0, 0);
 
+	if (protocol.is_binary()) {_startBinary(TYPE::REQUEST, method, Status(), uri, {}); return;}
+
 	nng::msgbuf out = bodyBuf(std::ios::out | std::ios::binary | std::ios::ate);
 	out << method.toString()
 		<< ' ' << uri
@@ -86,11 +173,14 @@ void MsgWriter::startRequest(std::string_view uri, Method method)
 
 void MsgWriter::startReply(Status status, std::string_view reason)
 {
+	TELLING_ALLOC_STAGE(WRITE);
 	_startMsg();
 
 	if (ContainsNewline(reason))
 		throw MsgException(MsgError::START_LINE_MALFORMED, 0, 0);
 
+	if (protocol.is_binary()) {_startBinary(TYPE::REPLY, Method(), status, {}, reason); return;}
+
 	nng::msgbuf out = bodyBuf(std::ios::out | std::ios::binary | std::ios::ate);
 	out << protocol.toString()
 		<< ' ' << status.toString()
@@ -100,6 +190,7 @@ void MsgWriter::startReply(Status status, std::string_view reason)
 
 void MsgWriter::startReport(std::string_view uri, Status status, std::string_view reason)
 {
+	TELLING_ALLOC_STAGE(WRITE);
 	_startMsg();
 
 	if (ContainsWhitespace(uri))
@@ -107,6 +198,8 @@ void MsgWriter::startReport(std::string_view uri, Status status, std::string_vie
 	if (ContainsNewline(reason))
 		throw MsgException(MsgError::START_LINE_MALFORMED, 0, 0);
 
+	if (protocol.is_binary()) {_startBinary(TYPE::REPORT, Method(), status, uri, reason); return;}
+
 	nng::msgbuf out = bodyBuf(std::ios::out | std::ios::binary | std::ios::ate);
 	out << uri
 		<< ' ' << protocol.toString()
@@ -117,6 +210,7 @@ void MsgWriter::startReport(std::string_view uri, Status status, std::string_vie
 
 void MsgWriter::writeHeader(std::string_view name, std::string_view value)
 {
+	TELLING_ALLOC_STAGE(WRITE);
 	if (!msg || this->_p_body)
 		throw MsgException(MsgError::ALREADY_WRITTEN, 0, 0);
 
@@ -125,6 +219,8 @@ void MsgWriter::writeHeader(std::string_view name, std::string_view value)
 	if (ContainsNewline(value))
 		throw MsgException(MsgError::HEADER_MALFORMED, 0, 0);
 
+	if (protocol.is_binary()) {_writeBinaryHeader(name, value, Indexing::PAIR); return;}
+
 	nng::msgbuf out = bodyBuf(std::ios::out | std::ios::binary | std::ios::ate);
 	out << name << ':' << value << protocol.preferred_newline();
 }
@@ -132,6 +228,7 @@ void MsgWriter::writeHeader(std::string_view name, std::string_view value)
 
 nng::msg MsgWriter::release()
 {
+	TELLING_ALLOC_STAGE(WRITE);
 	_autoCloseHeaders();
 
 	if (head.lengthSize)
@@ -141,7 +238,8 @@ nng::msg MsgWriter::release()
 		if (digits > head.lengthSize)
 			throw nng::exception(nng::error::nospc, "Content-Length header completion");
 
-		char *pos = msg.body().get().data<char>() + head.lengthOffset + digits;
+		// Binary values are zero-padded on the left; text values are padded with trailing spaces.
+		char *pos = msg.body().get().data<char>() + head.lengthOffset + (protocol.is_binary() ? head.lengthSize : digits);
 		do
 		{
 			*--pos = '0' + (bodySize%10);
@@ -193,6 +291,17 @@ void MsgWriter::writeHeader_Length(size_t maxLength)
 
 	uint8_t digits = NumDigits(maxLength);
 
+	if (protocol.is_binary())
+	{
+		// Only the name may be indexed, so the value stays in place.
+		if (!msg || this->_p_body)
+			throw MsgException(MsgError::ALREADY_WRITTEN, 0, 0);
+		_writeBinaryHeader("Content-Length", std::string_view("00000000000000000000", digits), Indexing::NAME);
+		head.lengthOffset = (uint16_t) (msg.body().size() - digits);
+		head.lengthSize   = digits;
+		return;
+	}
+
 	nng::msgbuf out = bodyBuf(std::ios::out | std::ios::binary | std::ios::ate);
 	out << "Content-Length:";
 
@@ -203,3 +312,34 @@ void MsgWriter::writeHeader_Length(size_t maxLength)
 	out << std::string_view("                    ", digits)
 		<< protocol.preferred_newline();
 }
+
+void MsgWriter::writeHeader_Trace()
+{
+	if (!msg || this->_p_body)
+		throw MsgException(MsgError::ALREADY_WRITTEN, 0, 0);
+
+	// Only the start-line may precede it.
+	auto body = msg.body().get();
+	if (protocol.is_binary())
+	{
+		size_t prefix = _indexed() ? (dictionary->id ? 3u : 1u) : 0u;
+		if (body.size() != head.tableOffset + 2u + prefix)
+			throw MsgException(MsgError::HEADER_MALFORMED, 0, 0);
+	}
+	else
+	{
+		auto nl = std::memchr(body.data(), '\n', body.size());
+		if (!nl || static_cast<const char*>(nl) + 1 != body.data<char>() + body.size())
+			throw MsgException(MsgError::HEADER_MALFORMED, 0, 0);
+	}
+
+	Trace::Stamps stamps = {};
+	stamps[Trace::CLIENT_SEND] = Trace::Now();
+
+	char value[Trace::ValueSize];
+	Trace::Format(value, stamps);
+
+	// Binary traces are always literal, so relays find them without the dictionary.
+	if (protocol.is_binary()) _writeBinaryHeader("Trace", std::string_view(value, sizeof(value)), Indexing::NONE);
+	else                      writeHeader("Trace", std::string_view(value, sizeof(value)));
+}
@@ -1,42 +1,14 @@
-#include <iostream>
-
 #include <telling/server.h>
 
 
 using namespace telling;
 
 
-namespace telling
-{
-	namespace server_detail
-	{
-		class NulStreambuf : public std::streambuf
-		{
-			char                dummyBuffer[ 64 ];
-		protected:
-			virtual int         overflow( int c ) 
-			{
-				setp( dummyBuffer, dummyBuffer + sizeof( dummyBuffer ) );
-				return (c == traits_type::eof()) ? '\0' : c;
-			}
-		};
-		class NulOStream : private NulStreambuf, public std::ostream
-		{
-		public:
-			NulOStream() : std::ostream( this ) {}
-			NulStreambuf* rdbuf() const { return (NulStreambuf*) this; }
-		};
-
-		static NulOStream nullOutput;
-	}
-}
-
-
 Server::Server(std::ostream *_log, std::string_view _id, bool open_inproc) :
 	ID(_id),
 	address_register(HostAddress::Base::InProc(ID + "/register")),
 	address_internal(HostAddress::Base::InProc(ID + "/internal")),
-	log(_log ? *_log : server_detail::nullOutput),
+	log(_log),
 	publish (*this),
 	pull    (*this),
 	reply   (*this),
@@ -47,7 +19,21 @@ Server::Server(std::ostream *_log, std::string_view _id, bool open_inproc) :
 
 Server::~Server()
 {
+	// The metrics service and gateways route through the other components, so they close first.
+	{
+		std::lock_guard<std::mutex> g(metrics_mtx);
+		_deleteMetrics(metricsService);
+		metricsService = nullptr;
+	}
 
+	std::lock_guard<std::mutex> g(http_mtx);
+	for (auto &gateway : http) _deleteHttp(gateway.second);
+	http.clear();
+}
+
+void Server::balance(std::string_view uri, const Balancing &balancing)
+{
+	services.setBalancing(uri, balancing);
 }
 
 void Server::open(const HostAddress::Base &base)
@@ -0,0 +1,644 @@
+#include <cstring>
+#include <cctype>
+
+#include <telling/msg_writer.h>
+#include <telling/client_request.h>
+#include <telling/server.h>
+
+
+using namespace telling;
+
+
+/*
+	Accepts HTTP connections at one URL.
+		Requests pass through an internal Request socket into ReqRep,
+		so they are classified and routed exactly like requests from clients.
+*/
+class Server::HttpGateway
+{
+public:
+	HttpGateway(Server &server, const std::string &url, const HttpConfig &config);
+	~HttpGateway();
+
+	static const char *Name()    {return "*HTTP";}
+
+	struct Connection;
+
+	Server            &server;
+	const std::string  url;
+	const HttpConfig   config;
+	Request            requester;
+
+	std::atomic<size_t>      inFlight = 0;
+
+	std::mutex               mtx;
+	std::condition_variable  cond;
+	std::vector<Connection*> connections;
+	std::deque<Connection*>  idle;
+	size_t                   openCount = 0;
+	bool                     stopping  = false;
+
+	nng_stream_listener     *listener = nullptr;
+	nng::aio                 aio_accept;
+
+	void _accept();
+	void _release(Connection*);
+
+	static void _acceptCallback(void*);
+};
+
+
+/*
+	One HTTP connection.  Pooled by the gateway.
+*/
+struct Server::HttpGateway::Connection
+{
+	static constexpr size_t RecvChunk = 4096;
+
+	struct Pending
+	{
+		nng::msg reply;
+		QueryID  queryID   = 0;
+		bool     ready     = false;
+		bool     keepAlive = true;
+	};
+
+	HttpGateway         &gateway;
+	nng_stream          *stream = nullptr;
+	nng::aio             aio_recv, aio_send;
+	nng_iov              iov_recv, iov_send;
+
+	std::mutex           mtx;
+	nng::msg             buffer;               // Received bytes not yet routed
+	size_t               have        = 0;
+	std::deque<Pending>  pending;              // Replies in request order
+	uint64_t             firstSeq    = 0;      // Sequence number of pending.front()
+	unsigned             queries     = 0;      // Routed requests awaiting replies
+	nng::msg             sending;
+	bool                 sendingLast = false;  // Close after sending
+	bool                 lastRequest = false;  // Read no further requests
+	bool                 isOpen      = false;
+	bool                 recvBusy    = false, sendBusy = false;
+
+
+	Connection(HttpGateway &_gateway) :
+		gateway(_gateway)
+	{
+		aio_recv = nng::make_aio(&_recvCallback, this);
+		aio_send = nng::make_aio(&_sendCallback, this);
+	}
+
+	void start(nng_stream *stream);
+
+	// Close the stream; returns requests to cancel.  Call with mtx locked.
+	std::vector<QueryID> close();
+
+
+	// Call with mtx locked.
+	void _recv();
+	void _send();
+	void _reply(uint64_t seq, nng::msg &&reply);
+
+	// Route complete requests in the buffer.  May unlock while routing.
+	void _parse(std::unique_lock<std::mutex> &lock);
+
+	// Route any buffered requests, then read more.
+	void _resume(std::unique_lock<std::mutex> &lock);
+
+	// Return to the pool if closed and idle.  Unlocks.
+	void _finish(std::unique_lock<std::mutex> &lock);
+
+	void _replied(uint64_t seq, AsyncError status, nng::msg &&reply);
+
+	static void _recvCallback(void*);
+	static void _sendCallback(void*);
+};
+
+
+namespace
+{
+	bool SameToken(std::string_view a, std::string_view b) noexcept
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+			if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+		return true;
+	}
+
+	// Check whether a message leaves its connection open for another request.
+	bool KeepAlive(const MsgView &msg)
+	{
+		for (auto &header : msg.headers())
+		{
+			if (!header.is("Connection")) continue;
+			if (SameToken(header.value, "close"))      return false;
+			if (SameToken(header.value, "keep-alive")) return true;
+		}
+		return msg.protocolString() != "HTTP/1.0";
+	}
+
+	// A reply generated by the gateway.
+	nng::msg LocalReply(Status status, bool keepAlive, std::string_view text)
+	{
+		MsgWriter writer = HttpReply(status);
+		writer.writeHeader_Length();
+		if (!keepAlive) writer.writeHeader("Connection", "close");
+		writer.writeBody() << text;
+		return writer.release();
+	}
+
+	/*
+		Prepare a service's reply for an HTTP client.
+			HTTP replies are forwarded as-is.  Others are given an HTTP/1.1 head.
+			Clears keepAlive if the connection must close after this reply.
+	*/
+	nng::msg HttpReplyFrom(nng::msg &&msg, bool &keepAlive)
+	{
+		MsgView::Reply reply;
+		try
+		{
+			reply = msg;
+		}
+		catch (MsgException&)
+		{
+			keepAlive = false;
+			return LocalReply(StatusCode::BadGateway, false, "Service reply could not be parsed.");
+		}
+
+		if (reply.protocol().is_http())
+		{
+			if (reply.completion().implicit() || !KeepAlive(reply)) keepAlive = false;
+			return std::move(msg);
+		}
+
+		MsgWriter writer = HttpReply(reply.status(), reply.reason());
+		for (auto &header : reply.headers())
+		{
+			if (header.is("Content-Length") || header.is("Connection") || header.is("Transfer-Encoding")) continue;
+			writer.writeHeader(header.name, header.value);
+		}
+		writer.writeHeader_Length();
+		if (!keepAlive) writer.writeHeader("Connection", "close");
+		writer.writeBody().write(reply.bodyData<char>(), reply.bodySize());
+		return writer.release();
+	}
+}
+
+
+void Server::openHttp(const std::string &url, const HttpConfig &config)
+{
+	if (!config.maxPipeline || !config.maxInFlight || !config.maxConnections)
+		throw nng::exception(nng::error::inval, "Server::openHttp (limits must be nonzero)");
+
+	std::lock_guard<std::mutex> g(http_mtx);
+
+	if (http.count(url))
+		throw nng::exception(nng::error::addrinuse, "Server::openHttp (already open)");
+
+	auto gateway = new HttpGateway(*this, url, config);
+	http[url] = gateway;
+
+	log.event(ServerLog::INFO, HttpGateway::Name(), "listening at " + url);
+}
+
+void Server::closeHttp(const std::string &url)
+{
+	HttpGateway *gateway = nullptr;
+	{
+		std::lock_guard<std::mutex> g(http_mtx);
+		auto pos = http.find(url);
+		if (pos == http.end()) return;
+		gateway = pos->second;
+		http.erase(pos);
+	}
+	_deleteHttp(gateway);
+}
+
+void Server::_deleteHttp(HttpGateway *gateway)
+{
+	delete gateway;
+}
+
+
+Server::HttpGateway::HttpGateway(Server &_server, const std::string &_url, const HttpConfig &_config) :
+	server(_server), url(_url), config(_config)
+{
+	// Request contexts are created later and take the socket's receive timeout.
+	if (config.requestTimeout_ms)
+		requester.socketView().set_opt_ms(NNG_OPT_RECVTIMEOUT, nng_duration(config.requestTimeout_ms));
+	requester.dial(server.address_internal);
+
+	int status = nng_stream_listener_alloc(&listener, url.c_str());
+	if (status) throw nng::exception(status, "Server::openHttp (listener)");
+
+	if ((status = nng_stream_listener_listen(listener)))
+	{
+		nng_stream_listener_free(listener);
+		throw nng::exception(status, "Server::openHttp (listen)");
+	}
+
+	aio_accept = nng::make_aio(&_acceptCallback, this);
+	_accept();
+}
+
+Server::HttpGateway::~HttpGateway()
+{
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		stopping = true;
+	}
+
+	// Stop accepting
+	nng_stream_listener_close(listener);
+	aio_accept.stop();
+	nng_stream_listener_free(listener);
+
+	// Close connections and cancel their requests.
+	std::vector<Connection*> all;
+	{
+		std::lock_guard<std::mutex> g(mtx);
+		all = connections;
+	}
+	for (auto conn : all)
+	{
+		std::unique_lock<std::mutex> lock(conn->mtx);
+		auto cancel = conn->close();
+		lock.unlock();
+		for (QueryID id : cancel) requester.cancel(id);
+	}
+
+	// Wait for connections to return to the pool.
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		cond.wait(lock, [this] {return openCount == 0;});
+	}
+	for (auto conn : connections) delete conn;
+}
+
+void Server::HttpGateway::_accept()
+{
+	nng_stream_listener_accept(listener, aio_accept.get());
+}
+
+void Server::HttpGateway::_release(Connection *conn)
+{
+	std::lock_guard<std::mutex> g(mtx);
+	--openCount;
+	idle.push_back(conn);
+	cond.notify_all();
+}
+
+void Server::HttpGateway::_acceptCallback(void *_self)
+{
+	auto self = static_cast<HttpGateway*>(_self);
+
+	auto result = self->aio_accept.result();
+	if (result != nng::error::success)
+	{
+		if (result == nng::error::closed || result == nng::error::canceled) return;
+		self->server.log.event(ServerLog::IO_ERROR, Name(), std::string("accept error: ") + nng::to_string(result));
+		self->_accept();
+		return;
+	}
+
+	auto stream = self->aio_accept.get_output<nng_stream>(0);
+
+	Connection *conn = nullptr;
+	{
+		std::lock_guard<std::mutex> g(self->mtx);
+		if (self->stopping)
+		{
+			nng_stream_free(stream);
+			return;
+		}
+		if (self->openCount < self->config.maxConnections)
+		{
+			if (self->idle.empty())
+			{
+				self->connections.push_back(new Connection(*self));
+				self->idle.push_back(self->connections.back());
+			}
+			conn = self->idle.front();
+			self->idle.pop_front();
+			++self->openCount;
+		}
+	}
+
+	if (conn) conn->start(stream);
+	else      nng_stream_free(stream); // Too many connections
+
+	self->_accept();
+}
+
+
+void Server::HttpGateway::Connection::start(nng_stream *_stream)
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	stream      = _stream;
+	isOpen      = true;
+	lastRequest = false;
+	have        = 0;
+	firstSeq    = 0;
+
+	// Not all transports have this option.
+	nng_stream_set_bool(stream, NNG_OPT_TCP_NODELAY, true);
+
+	_recv();
+}
+
+std::vector<QueryID> Server::HttpGateway::Connection::close()
+{
+	std::vector<QueryID> cancel;
+	if (!isOpen) return cancel;
+
+	isOpen = false;
+	nng_stream_close(stream);
+
+	for (auto &p : pending) if (!p.ready && p.queryID) cancel.push_back(p.queryID);
+	return cancel;
+}
+
+void Server::HttpGateway::Connection::_recv()
+{
+	if (recvBusy || !isOpen || lastRequest || pending.size() >= gateway.config.maxPipeline) return;
+
+	if (!buffer) buffer = nng::make_msg(0);
+	buffer.realloc(have + RecvChunk);
+	iov_recv = nng_iov{buffer.body().data<char>() + have, RecvChunk};
+	aio_recv.set_iov(iov_recv);
+
+	// Idle connections time out; connections awaiting replies don't.
+	auto timeout = gateway.config.idleTimeout_ms;
+	aio_recv.set_timeout((pending.empty() && timeout) ? nng_duration(timeout) : NNG_DURATION_INFINITE);
+
+	recvBusy = true;
+	nng_stream_recv(stream, aio_recv.get());
+}
+
+void Server::HttpGateway::Connection::_parse(std::unique_lock<std::mutex> &lock)
+{
+	auto &config = gateway.config;
+
+	while (isOpen && !lastRequest && have && pending.size() < config.maxPipeline)
+	{
+		uint64_t seq = firstSeq + pending.size();
+
+		MsgView::Request request;
+		try
+		{
+			request = buffer;
+		}
+		catch (MsgException &e)
+		{
+			if (e.error == MsgError::HEADER_INCOMPLETE && have < config.maxRequestSize) break;
+
+			// Unusable request; reply and close.
+			pending.emplace_back();
+			pending.back().keepAlive = false;
+			lastRequest = true;
+			_reply(seq, LocalReply((e.error == MsgError::HEADER_TOO_BIG)
+				? StatusCode::RequestHeaderFieldsTooLarge : StatusCode::BadRequest, false, e.what()));
+			break;
+		}
+
+		auto completion = request.completion();
+		bool keepAlive  = KeepAlive(request);
+		size_t total    = (have - request.bodySize()) + (completion.length_header ? completion.message_length : 0);
+
+		if (completion.is_chunked || total > config.maxRequestSize)
+		{
+			pending.emplace_back();
+			pending.back().keepAlive = false;
+			lastRequest = true;
+			_reply(seq, completion.is_chunked
+				? LocalReply(StatusCode::NotImplemented,  false, "Chunked requests are not supported.")
+				: LocalReply(StatusCode::PayloadTooLarge, false, "Request is too large."));
+			break;
+		}
+		if (have < total) break;
+
+		// Take the request's bytes, without copying if they fill the buffer.
+		nng::msg msg;
+		if (total == have)
+		{
+			msg  = std::move(buffer);
+			have = 0;
+		}
+		else
+		{
+			msg = nng::make_msg(total);
+			std::memcpy(msg.body().data(), buffer.body().data(), total);
+			buffer.body().trim(total);
+			have -= total;
+		}
+
+		pending.emplace_back();
+		pending.back().keepAlive = keepAlive;
+		if (!keepAlive) lastRequest = true;
+
+		// Bounded in-flight requests
+		if (gateway.inFlight.fetch_add(1) >= config.maxInFlight)
+		{
+			gateway.inFlight.fetch_sub(1);
+			_reply(seq, LocalReply(StatusCode::ServiceUnavailable, keepAlive, "Too many requests in flight."));
+			continue;
+		}
+
+		// Route without holding the lock; the reply may arrive at any time.
+		++queries;
+		lock.unlock();
+
+		QueryID queryID = 0;
+		bool    sent    = true;
+		try
+		{
+			queryID = gateway.requester.request(std::move(msg),
+				[this, seq](AsyncError status, nng::msg &&reply)
+				{
+					_replied(seq, status, std::move(reply));
+				});
+		}
+		catch (nng::exception&)
+		{
+			sent = false;
+		}
+
+		lock.lock();
+
+		if (!sent)
+		{
+			--queries;
+			gateway.inFlight.fetch_sub(1);
+			_reply(seq, LocalReply(StatusCode::ServiceUnavailable, keepAlive, "Request could not be routed."));
+		}
+		else if (seq >= firstSeq && !pending[seq-firstSeq].ready)
+		{
+			pending[seq-firstSeq].queryID = queryID;
+
+			if (!isOpen)
+			{
+				// Closed while routing.
+				lock.unlock();
+				gateway.requester.cancel(queryID);
+				lock.lock();
+			}
+		}
+	}
+}
+
+void Server::HttpGateway::Connection::_resume(std::unique_lock<std::mutex> &lock)
+{
+	if (recvBusy || !isOpen) return;
+
+	// Stay busy while parsing so requests are routed in order.
+	recvBusy = true;
+	_parse(lock);
+	recvBusy = false;
+
+	_recv();
+}
+
+void Server::HttpGateway::Connection::_reply(uint64_t seq, nng::msg &&reply)
+{
+	if (seq < firstSeq) return;
+
+	Pending &p = pending[seq-firstSeq];
+	p.reply = std::move(reply);
+	p.ready = true;
+
+	_send();
+}
+
+void Server::HttpGateway::Connection::_send()
+{
+	if (sendBusy || !isOpen || pending.empty() || !pending.front().ready) return;
+
+	Pending &p = pending.front();
+	sending     = std::move(p.reply);
+	sendingLast = !p.keepAlive;
+	pending.pop_front();
+	++firstSeq;
+
+	iov_send = nng_iov{sending.body().data(), sending.body().size()};
+	aio_send.set_iov(iov_send);
+
+	sendBusy = true;
+	nng_stream_send(stream, aio_send.get());
+}
+
+void Server::HttpGateway::Connection::_replied(uint64_t seq, AsyncError status, nng::msg &&reply)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+
+	--queries;
+	gateway.inFlight.fetch_sub(1);
+
+	if (isOpen && seq >= firstSeq)
+	{
+		Pending &p = pending[seq-firstSeq];
+
+		if (status == nng::error::success)
+			reply = HttpReplyFrom(std::move(reply), p.keepAlive);
+		else if (status == nng::error::timedout)
+			reply = LocalReply(StatusCode::GatewayTimeout, p.keepAlive, "Service did not reply in time.");
+		else
+			reply = LocalReply(StatusCode::BadGateway,     p.keepAlive, "Service reply failed.");
+
+		if (!p.keepAlive) lastRequest = true;
+		_reply(seq, std::move(reply));
+	}
+
+	_finish(lock);
+}
+
+void Server::HttpGateway::Connection::_finish(std::unique_lock<std::mutex> &lock)
+{
+	if (isOpen || recvBusy || sendBusy || queries || !stream)
+	{
+		lock.unlock();
+		return;
+	}
+
+	nng_stream_free(stream);
+	stream = nullptr;
+	pending.clear();
+	buffer  = nng::msg();
+	sending = nng::msg();
+	have    = 0;
+
+	lock.unlock();
+	gateway._release(this);
+}
+
+void Server::HttpGateway::Connection::_recvCallback(void *_conn)
+{
+	auto  conn    = static_cast<Connection*>(_conn);
+	auto &gateway = conn->gateway;
+
+	std::vector<QueryID> cancel;
+	std::unique_lock<std::mutex> lock(conn->mtx);
+
+	if (conn->aio_recv.result() == nng::error::success && conn->isOpen)
+	{
+		conn->have += conn->aio_recv.count();
+		conn->buffer.realloc(conn->have);
+
+		conn->recvBusy = false;
+		conn->_resume(lock);
+	}
+	else
+	{
+		// Disconnected, idle timeout or closed.
+		conn->recvBusy = false;
+		cancel = conn->close();
+	}
+
+	conn->_finish(lock);
+	for (QueryID id : cancel) gateway.requester.cancel(id);
+}
+
+void Server::HttpGateway::Connection::_sendCallback(void *_conn)
+{
+	auto  conn    = static_cast<Connection*>(_conn);
+	auto &gateway = conn->gateway;
+
+	std::vector<QueryID> cancel;
+	std::unique_lock<std::mutex> lock(conn->mtx);
+
+	if (conn->aio_send.result() == nng::error::success && conn->isOpen)
+	{
+		size_t count = conn->aio_send.count();
+		if (count < conn->iov_send.iov_len)
+		{
+			// Partial write; send the rest.
+			conn->iov_send.iov_buf  = static_cast<char*>(conn->iov_send.iov_buf) + count;
+			conn->iov_send.iov_len -= count;
+			conn->aio_send.set_iov(conn->iov_send);
+			nng_stream_send(conn->stream, conn->aio_send.get());
+			return;
+		}
+
+		conn->sendBusy = false;
+		conn->sending  = nng::msg();
+
+		if (conn->sendingLast)
+		{
+			cancel = conn->close();
+		}
+		else
+		{
+			conn->_send();
+			conn->_resume(lock); // A pipeline slot may have opened
+		}
+	}
+	else
+	{
+		conn->sendBusy = false;
+		conn->sending  = nng::msg();
+		cancel = conn->close();
+	}
+
+	conn->_finish(lock);
+	for (QueryID id : cancel) gateway.requester.cancel(id);
+}
@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <telling/server_log.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	const std::chrono::milliseconds FlushPeriod(50), SummaryPeriod(1000);
+
+	const char *const EventNames[ServerLog::EVENT_COUNT] =
+	{
+		"info",
+		"registry",
+		"route_not_found",
+		"route_unavailable",
+		"malformed",
+		"io_error",
+	};
+
+	uint8_t CopyTruncated(char *dest, size_t capacity, std::string_view src) noexcept
+	{
+		size_t n = (src.size() < capacity) ? src.size() : capacity;
+		std::memcpy(dest, src.data(), n);
+		return uint8_t(n);
+	}
+
+	void AppendTime(std::string &out, Clock::duration since)
+	{
+		char buf[32];
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(since).count();
+		std::snprintf(buf, sizeof(buf), "[+%lld.%03lld] ", (long long) (ms / 1000), (long long) (ms % 1000));
+		out += buf;
+	}
+}
+
+
+const char *ServerLog::EventName(EVENT type) noexcept
+{
+	return (type < EVENT_COUNT) ? EventNames[type] : "?";
+}
+
+
+ServerLog::ServerLog(std::ostream *out) :
+	_out(out),
+	_slots(new Slot[Capacity]),
+	_start(Clock::now())
+{
+	for (size_t i = 0; i < Capacity; ++i) _slots[i].seq.store(i, std::memory_order_relaxed);
+
+	_types[INFO]    .perSecond = 0;
+	_types[REGISTRY].perSecond = 0;
+
+	if (_out) _flusher = std::thread(&ServerLog::_run_flusher, this);
+}
+
+ServerLog::~ServerLog()
+{
+	{
+		std::lock_guard<std::mutex> g(_mtx);
+		_run = false;
+	}
+	_cond.notify_all();
+	if (_flusher.joinable()) _flusher.join();
+
+	flush();
+	delete[] _slots;
+}
+
+
+bool ServerLog::_admit(EVENT type) noexcept
+{
+	auto &t = _types[type];
+
+	unsigned limit = t.perSecond.load(std::memory_order_relaxed);
+	if (!limit) return true;
+
+	// The count restarts each second.  Races at the boundary only blur the limit.
+	int64_t now    = std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - _start).count();
+	int64_t window = t.window.load(std::memory_order_relaxed);
+	if (window != now && t.window.compare_exchange_strong(window, now, std::memory_order_relaxed))
+		t.count.store(0, std::memory_order_relaxed);
+
+	if (t.count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+
+	t.suppressed     .fetch_add(1, std::memory_order_relaxed);
+	t.suppressedTotal.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+bool ServerLog::event(EVENT type, const char *component, std::string_view text, std::string_view uri, int status, uint32_t pipe) noexcept
+{
+	if (!_out || type >= EVENT_COUNT) return false;
+	if (!_admit(type)) return false;
+
+	// Claim a slot (bounded MPMC ring; only the flusher consumes).
+	size_t pos = _tail.load(std::memory_order_relaxed);
+	Slot  *slot;
+	while (true)
+	{
+		slot = &_slots[pos & (Capacity-1)];
+		size_t   seq  = slot->seq.load(std::memory_order_acquire);
+		intptr_t diff = intptr_t(seq) - intptr_t(pos);
+		if (diff == 0)
+		{
+			if (_tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0)
+		{
+			// Full; the flusher is behind.
+			_dropped     .fetch_add(1, std::memory_order_relaxed);
+			_droppedTotal.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else pos = _tail.load(std::memory_order_relaxed);
+	}
+
+	auto &e = slot->entry;
+	e.time      = Clock::now();
+	e.type      = type;
+	e.component = component;
+	e.status    = status;
+	e.pipe      = pipe;
+	e.uriSize   = CopyTruncated(e.uri,  UriSize,  uri);
+	e.textSize  = CopyTruncated(e.text, TextSize, text);
+
+	slot->seq.store(pos+1, std::memory_order_release);
+	return true;
+}
+
+
+void ServerLog::flush()
+{
+	if (!_out) return;
+	std::lock_guard<std::mutex> g(_mtx);
+	_drain();
+	_summarize();
+}
+
+void ServerLog::_run_flusher()
+{
+	std::unique_lock<std::mutex> lock(_mtx);
+	auto summarized = Clock::now();
+	while (_run)
+	{
+		_cond.wait_for(lock, FlushPeriod);
+		_drain();
+
+		if (Clock::now() - summarized >= SummaryPeriod)
+		{
+			_summarize();
+			summarized = Clock::now();
+		}
+	}
+}
+
+void ServerLog::_drain()
+{
+	std::string out;
+
+	while (true)
+	{
+		Slot &slot = _slots[_head & (Capacity-1)];
+		if (slot.seq.load(std::memory_order_acquire) != _head+1) break;
+
+		auto &e = slot.entry;
+		AppendTime(out, e.time - _start);
+		out += e.component ? e.component : "?";
+		out += ' ';
+		out += EventName(e.type);
+		if (e.uriSize) {out += " uri=";    out.append(e.uri, e.uriSize);}
+		if (e.status)  {out += " status="; out += std::to_string(e.status);}
+		if (e.pipe)    {out += " pipe=";   out += std::to_string(e.pipe);}
+		if (e.textSize) {out += ": ";      out.append(e.text, e.textSize);}
+		out += '\n';
+
+		slot.seq.store(_head + Capacity, std::memory_order_release);
+		++_head;
+	}
+
+	if (out.size())
+	{
+		_out->write(out.data(), std::streamsize(out.size()));
+		_out->flush();
+	}
+}
+
+void ServerLog::_summarize()
+{
+	std::string out;
+
+	for (unsigned i = 0; i < EVENT_COUNT; ++i)
+	{
+		if (uint64_t n = _types[i].suppressed.exchange(0, std::memory_order_relaxed))
+		{
+			AppendTime(out, Clock::now() - _start);
+			out += "*log suppressed " + std::to_string(n) + ' ' + EventName(EVENT(i)) + " events\n";
+		}
+	}
+	if (uint64_t n = _dropped.exchange(0, std::memory_order_relaxed))
+	{
+		AppendTime(out, Clock::now() - _start);
+		out += "*log dropped " + std::to_string(n) + " events (buffer full)\n";
+	}
+
+	if (out.size())
+	{
+		_out->write(out.data(), std::streamsize(out.size()));
+		_out->flush();
+	}
+}
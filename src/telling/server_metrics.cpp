@@ -0,0 +1,257 @@
+#include <cstdio>
+#include <sstream>
+#include <condition_variable>
+
+#include <telling/msg_writer.h>
+#include <telling/service_reactor.h>
+#include <telling/server.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	void WriteString(std::ostream &out, std::string_view s)
+	{
+		out << '"';
+		for (char c : s)
+		{
+			switch (c)
+			{
+			case '"':  out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			default:
+				if (uint8_t(c) < 0x20)
+				{
+					char esc[8];
+					std::snprintf(esc, sizeof(esc), "\\u%04x", unsigned(c));
+					out << esc;
+				}
+				else out << c;
+			}
+		}
+		out << '"';
+	}
+
+	void WriteComm(std::ostream &out, const CommMetrics &metrics)
+	{
+		CommMetrics::WriteJSON(out, metrics.snapshot());
+	}
+}
+
+
+/*
+	The built-in "*metrics" service.
+		Registers with the server like any other service, through its inproc address.
+*/
+class Server::MetricsService
+{
+public:
+	static const char *Name()    {return "*metrics";}
+
+	class Handler : public Reactor
+	{
+	public:
+		Server &server;
+
+		Handler(Server &_server)    : Reactor(Name()), server(_server) {}
+
+		Methods allowed(UriView) const noexcept override    {return MethodCode::GET;}
+
+		void async_get(Query query, Msg::Request &&request) override
+		{
+			auto reply = WriteReply();
+			reply.writeHeader("Content-Type", "application/json");
+			reply.writeBody() << server._metricsJSON();
+			query.reply(reply.release());
+		}
+	};
+
+	Server                  &server;
+	std::shared_ptr<Handler> handler;
+	Service                  service;
+
+	std::mutex                mtx;
+	std::condition_variable   cond;
+	std::chrono::milliseconds period = std::chrono::milliseconds(0);
+	bool                      run    = true;
+	std::thread               reporter;
+
+public:
+	MetricsService(Server &_server) :
+		server(_server),
+		handler(std::make_shared<Handler>(_server)),
+		service(handler, _server.ID + "/metrics", "")
+	{
+		service.registerReplica(Name(), server.ID);
+	}
+	~MetricsService()
+	{
+		{
+			std::lock_guard g(mtx);
+			run = false;
+		}
+		cond.notify_all();
+		if (reporter.joinable()) reporter.join();
+	}
+
+	void setPeriod(std::chrono::milliseconds _period)
+	{
+		{
+			std::lock_guard g(mtx);
+			period = _period;
+		}
+		cond.notify_all();
+		if (period.count() && !reporter.joinable()) reporter = std::thread(&MetricsService::_run, this);
+	}
+
+private:
+	void _run()
+	{
+		std::unique_lock lock(mtx);
+		while (run)
+		{
+			if (!period.count())                                      {cond.wait(lock); continue;}
+			if (cond.wait_for(lock, period) != std::cv_status::timeout) continue;
+
+			lock.unlock();
+			try
+			{
+				auto report = WriteReport(Name());
+				report.writeHeader("Content-Type", "application/json");
+				report.writeBody() << server._metricsJSON();
+				service.publish(report.release());
+			}
+			catch (nng::exception &e)
+			{
+				server.log.event(ServerLog::IO_ERROR, Name(), std::string("could not publish report: ") + e.what());
+			}
+			lock.lock();
+		}
+	}
+};
+
+
+void Server::serveMetrics(std::chrono::milliseconds reportPeriod)
+{
+	std::lock_guard g(metrics_mtx);
+	if (!metricsService) metricsService = new MetricsService(*this);
+	metricsService->setPeriod(reportPeriod);
+}
+
+void Server::_deleteMetrics(MetricsService *service)
+{
+	delete service;
+}
+
+std::string Server::_metricsJSON()
+{
+	std::ostringstream out;
+	writeMetrics(out);
+	return out.str();
+}
+
+void Server::writeMetrics(std::ostream &out)
+{
+	out << "{\"server\":"; WriteString(out, ID);
+	out << ",\"reply\":";   reply   .writeMetrics(out);
+	out << ",\"publish\":"; publish .writeMetrics(out);
+	out << ",\"pull\":";    pull    .writeMetrics(out);
+	out << ",\"routes\":";  services.writeMetrics(out);
+
+	out << ",\"qos\":[";
+	bool first = true;
+	for (auto &r : qos.report())
+	{
+		if (!first) out << ',';
+		first = false;
+		out << "{\"class\":"; WriteString(out, r.name);
+		out << ",\"depth\":"       << r.depth
+			<< ",\"admitted\":"    << r.admitted
+			<< ",\"shed\":"        << r.shed
+			<< ",\"wait_p50_us\":" << r.wait_p50
+			<< ",\"wait_p99_us\":" << r.wait_p99
+			<< ",\"wait_max_us\":" << r.wait_max << '}';
+	}
+	out << ']';
+
+	if (trace.enabled())
+	{
+		out << ",\"trace\":[";
+		first = true;
+		for (auto &r : trace.report())
+		{
+			if (!first) out << ',';
+			first = false;
+			out << "{\"segment\":"; WriteString(out, r.segment);
+			out << ",\"count\":"  << r.count
+				<< ",\"p50_us\":" << r.p50
+				<< ",\"p99_us\":" << r.p99
+				<< ",\"max_us\":" << r.max << '}';
+		}
+		out << ']';
+	}
+
+	out << '}';
+}
+
+
+void Server::ReqRep::writeMetrics(std::ostream &out) const
+{
+	out << "{\"messages\":"; WriteComm(out, metrics);
+	out << ",\"not_found\":"   << routeNotFound   .load(std::memory_order_relaxed)
+		<< ",\"unavailable\":" << routeUnavailable.load(std::memory_order_relaxed) << '}';
+}
+
+void Server::PubSub::writeMetrics(std::ostream &out) const
+{
+	out << "{\"in\":";  WriteComm(out, subscribe.metrics);
+	out << ",\"out\":"; WriteComm(out, publish.metrics);
+	out << '}';
+}
+
+void Server::PushPull::writeMetrics(std::ostream &out) const
+{
+	WriteComm(out, pull.metrics);
+}
+
+void Server::Services::writeMetrics(std::ostream &out)
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	out << '[';
+	bool first = true;
+	for (auto it = map.begin(); it != map.end(); ++it)
+	{
+		if (!first) out << ',';
+		first = false;
+		(*it)->writeMetrics(out);
+	}
+	out << ']';
+}
+
+void Server::Route::writeMetrics(std::ostream &out) const
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	out << "{\"uri\":"; WriteString(out, path);
+	out << ",\"replicas\":[";
+	for (size_t i = 0; i < replicas.size(); ++i)
+	{
+		if (i) out << ',';
+		replicas[i]->writeMetrics(out);
+	}
+	out << "]}";
+}
+
+void Server::Replica::writeMetrics(std::ostream &out)
+{
+	out << "{\"address\":"; WriteString(out, std::string(address.base));
+	out << ",\"healthy\":"     << (healthy() ? "true" : "false")
+		<< ",\"outstanding\":" << outstanding.load(std::memory_order_relaxed)
+		<< ",\"queued\":"      << queueDepth()
+		<< ",\"requests\":";   WriteComm(out, metrics);
+	out << ",\"pushes\":";     WriteComm(out, push.metrics);
+	out << '}';
+}
@@ -9,8 +9,6 @@ using namespace telling;
 Server::PubSub::PubSub(Server &_server) :
 	server(_server)
 {
-	auto &log = server.log;
-
 	// The subscriber is a relay, and accepts all topics.
 	subscribe.subscribe("");
 
@@ -31,20 +29,18 @@ Server::PubSub::~PubSub()
 
 void Server::PubSub::async_error(Subscribing, AsyncError error)
 {
-	server.log << Name() << ": ingestion error: " << error.what() << std::endl;
+	server.log.event(ServerLog::IO_ERROR, Name(), error.what());
 }
 
 void Server::PubSub::async_recv(Subscribing, nng::msg &&msg)
 {
-	// No mutex needed; this AIO is the only sender.
+	TELLING_ALLOC_STAGE(ROUTE);
 
-	auto &log = server.log;
+	// No mutex needed; this AIO is the only sender.
 
 	MsgView::Report report;
-	try                    {report = msg;}
-	catch (MsgException e) {server.log << Name() << ": message exception: " << e.what() << std::endl; return;}
-
-	//log << Name() << ": publishing on URI `" << report.uri() << "`" << std::endl;
+	try                      {report = msg;}
+	catch (MsgException &e)  {server.log.event(ServerLog::MALFORMED, Name(), e.what(), {}, 0, msg.get_pipe().get().id); return;}
 
 	// PubSub the message!
 	publish.publish(std::move(msg));
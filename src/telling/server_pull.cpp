@@ -8,8 +8,6 @@ using namespace telling;
 Server::PushPull::PushPull(Server &_server) :
 	server(_server)
 {
-	auto &log = server.log;
-
 	pull.initialize(get_weak());
 }
 Server::PushPull::~PushPull()
@@ -23,18 +21,21 @@ Server::PushPull::~PushPull()
 
 void Server::PushPull::async_error(Pulling, AsyncError error)
 {
-	//server.log << Name() << ": ingestion error: " << error.what() << std::endl;
+	if (error != nng::error::canceled && error != nng::error::closed)
+		server.log.event(ServerLog::IO_ERROR, Name(), error.what());
 }
 
 void Server::PushPull::async_recv(Pulling, nng::msg &&msg)
 {
-	MsgView::Request request;
-	try                    {request = msg;}
-	catch (MsgException e) {server.log << Name() << ": message exception: " << e.what() << std::endl; return;}
+	TELLING_ALLOC_STAGE(ROUTE);
 
-	auto status = server.services.routePush(request.uri(), std::move(msg));
+	uint32_t pipe = msg.get_pipe().get().id;
+
+	MsgView::Request request;
+	try                      {request = msg;}
+	catch (MsgException &e)  {server.log.event(ServerLog::MALFORMED, Name(), e.what(), {}, 0, pipe); return;}
 
-	//server.log << Name() << ": pushing to URI `" << request.uri() << "`" << std::endl;
+	auto status = server.services.routePush(request, std::move(msg));
 
 	if (status.isSuccessful())
 	{
@@ -43,8 +44,8 @@ void Server::PushPull::async_recv(Pulling, nng::msg &&msg)
 	else
 	{
 		// Log the error.
-		server.log << Name() << ": error " << status << " (" << status.reasonPhrase()
-			<< ") routing to `" << request.uri() << "`" << std::endl;
+		server.log.event((status.code == StatusCode::NotFound) ? ServerLog::ROUTE_NOT_FOUND : ServerLog::ROUTE_UNAVAILABLE,
+			Name(), status.reasonPhrase(), request.uriString(), status.toInt(), pipe);
 
 		// There's no opportunity to reply, so the failed message is discarded.
 	}
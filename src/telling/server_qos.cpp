@@ -0,0 +1,239 @@
+#include <cctype>
+#include <ostream>
+
+#include <telling/server.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	bool SameName(std::string_view a, std::string_view b) noexcept
+	{
+		if (a.size() != b.size()) return false;
+		for (size_t i = 0; i < a.size(); ++i)
+			if (std::tolower(a[i]) != std::tolower(b[i])) return false;
+		return true;
+	}
+}
+
+
+Server::QoS::Config Server::QoS::Config::Standard()
+{
+	Config config;
+	config.classes =
+	{
+		{"high",   8, 4096},
+		{"normal", 4, 1024},
+		{"low",    1,  256},
+	};
+	config.defaultClass = 1;
+	return config;
+}
+
+
+Server::QoS::QoS()
+{
+	configure(Config());
+}
+
+void Server::QoS::configure(const Config &config)
+{
+	if (config.classes.size() > MaxClasses)
+		throw nng::exception(nng::error::inval, "Server::QoS::configure (too many classes)");
+
+	const unsigned count = unsigned(config.classes.size() ? config.classes.size() : 1);
+
+	if (config.defaultClass >= count)
+		throw nng::exception(nng::error::inval, "Server::QoS::configure (bad default class)");
+
+	Policy policy = {};
+	policy.scheduling = config.scheduling;
+	policy.count      = count;
+	for (unsigned i = 0; i < MaxClasses; ++i)
+	{
+		policy.weight[i] = 1;
+		policy.limit [i] = 0;
+	}
+	for (unsigned i = 0; i < config.classes.size(); ++i)
+	{
+		auto &c = config.classes[i];
+		policy.weight[i] = (c.weight ? c.weight : 1);
+		policy.limit [i] = c.queueLimit;
+	}
+
+	PrefixMap<unsigned> prefixes;
+	for (auto &prefix : config.prefixes)
+	{
+		if (prefix.second >= count)
+			throw nng::exception(nng::error::inval, "Server::QoS::configure (bad class for prefix)");
+		prefixes[prefix.first] = prefix.second;
+	}
+
+	std::unique_lock g(_mtx);
+	_config   = config;
+	_policy   = policy;
+	_prefixes = std::move(prefixes);
+}
+
+unsigned Server::QoS::classify(const MsgView::Request &request) const
+{
+	std::shared_lock g(_mtx);
+
+	if (_policy.count <= 1) return 0;
+
+	if (_config.useHeader) for (auto &header : request.headers())
+	{
+		if (!header.is("Priority")) continue;
+
+		for (unsigned i = 0; i < _config.classes.size(); ++i)
+			if (SameName(header.value, _config.classes[i].name)) return i;
+
+		auto index = header.value_dec(-1);
+		if (index >= 0 && index < _policy.count) return unsigned(index);
+		break;
+	}
+
+	if (!_prefixes.empty())
+	{
+		auto pos = _prefixes.longest_prefix(request.uri());
+		if (pos != _prefixes.end()) return *pos;
+	}
+
+	return _config.defaultClass;
+}
+
+std::vector<Server::QoS::Report> Server::QoS::report() const
+{
+	std::vector<Report> reports;
+
+	std::shared_lock g(_mtx);
+	for (unsigned i = 0; i < _policy.count; ++i)
+	{
+		auto &stats = _stats[i];
+		Report r;
+		r.name     = (i < _config.classes.size()) ? _config.classes[i].name : std::string("default");
+		r.depth    = stats.depth   .load(std::memory_order_relaxed);
+		r.admitted = stats.admitted.load(std::memory_order_relaxed);
+		r.shed     = stats.shed    .load(std::memory_order_relaxed);
+		r.wait_p50 = stats.wait.percentile(.50);
+		r.wait_p99 = stats.wait.percentile(.99);
+		r.wait_max = stats.wait.max();
+		reports.push_back(std::move(r));
+	}
+	return reports;
+}
+
+void Server::QoS::report(std::ostream &out) const
+{
+	for (auto &r : report())
+	{
+		out << "QoS `" << r.name << "`: depth " << r.depth
+			<< ", admitted " << r.admitted << ", shed " << r.shed
+			<< ", wait p50 " << r.wait_p50 << " us, p99 " << r.wait_p99
+			<< " us, max " << r.wait_max << " us" << std::endl;
+	}
+}
+
+
+Server::RequestQueue::~RequestQueue()
+{
+	std::lock_guard g(mtx);
+	for (unsigned i = 0; i < QoS::MaxClasses; ++i)
+	{
+		qos._stats[i].depth.fetch_sub(queues[i].size(), std::memory_order_relaxed);
+		queues[i].clear();
+	}
+}
+
+Server::RequestQueue::ADMIT Server::RequestQueue::admit(unsigned priority, nng::msg &msg)
+{
+	auto policy = qos._getPolicy();
+	if (priority >= policy.count) priority = policy.count-1;
+
+	auto &stats = qos._stats[priority];
+
+	TELLING_ALLOC_STAGE(QUEUE);
+	std::lock_guard g(mtx);
+
+	if (!busy)
+	{
+		busy = true;
+		stats.admitted.fetch_add(1, std::memory_order_relaxed);
+		stats.wait.record(uint64_t(0));
+		metrics.recordLatency(0);
+		return SEND_NOW;
+	}
+
+	if (policy.limit[priority] && waiting >= policy.limit[priority])
+	{
+		stats.shed.fetch_add(1, std::memory_order_relaxed);
+		return SHED;
+	}
+
+	queues[priority].push_back(Waiting{std::move(msg), LatencyHistogram::Clock::now()});
+	++waiting;
+	stats.admitted.fetch_add(1, std::memory_order_relaxed);
+	stats.depth   .fetch_add(1, std::memory_order_relaxed);
+	return QUEUED;
+}
+
+size_t Server::RequestQueue::depth()
+{
+	std::lock_guard g(mtx);
+	return waiting;
+}
+
+void Server::RequestQueue::abandon() noexcept
+{
+	// The next admitted request will restart sending and drain the queue.
+	std::lock_guard g(mtx);
+	busy = false;
+}
+
+void Server::RequestQueue::_sendNext(ClientRequesting tag)
+{
+	auto policy = qos._getPolicy();
+
+	std::lock_guard g(mtx);
+
+	if (!waiting)
+	{
+		busy = false;
+		return;
+	}
+
+	unsigned next = 0;
+	if (policy.scheduling == QoS::Scheduling::STRICT)
+	{
+		while (queues[next].empty()) ++next;
+	}
+	else
+	{
+		// Weighted round robin; each class spends its credit before moving on.
+		while (true)
+		{
+			if (queues[cursor].size() && credit[cursor])
+			{
+				--credit[cursor];
+				next = cursor;
+				break;
+			}
+			credit[cursor] = policy.weight[cursor];
+			cursor = (cursor+1) % QoS::MaxClasses;
+		}
+	}
+
+	auto &stats = qos._stats[next];
+	Waiting item = std::move(queues[next].front());
+	queues[next].pop_front();
+	--waiting;
+	stats.depth.fetch_sub(1, std::memory_order_relaxed);
+	stats.wait.recordSince(item.since);
+	metrics.recordLatencySince(item.since);
+
+	// The send loop doesn't prepare queued messages.
+	_stampSend(item.msg);
+	tag.send(std::move(item.msg));
+}
@@ -11,11 +11,9 @@ Server::ReqRep::ReqRep(Server &_server) :
 	reply_ext  (Role::SERVICE, Pattern::REQ_REP, Socket::RAW),
 	request_dvc(Role::CLIENT,  Pattern::REQ_REP, Socket::RAW),
 	reply_int  (Role::SERVICE, Pattern::REQ_REP, Socket::RAW),
-	rep_send(reply_int.socketView(), ServerResponding{}),
-	rep_recv(reply_int.socketView(), ClientRequesting{})
+	rep_send(reply_int.socketView(), ServerResponding{}, &metrics),
+	rep_recv(reply_int.socketView(), ClientRequesting{}, &metrics)
 {
-	auto &log = server.log;
-
 	rep_send.send_init (rep_sendQueue.weak());
 	rep_recv.recv_start(get_weak());
 
@@ -47,46 +45,42 @@ void Server::ReqRep::run_device(ReqRep *reply)
 	try
 	{
 		nng::device(reply->reply_ext.socketView(), reply->request_dvc.socketView());
-		reply->server.log << reply->Name() << ": relay thread stopped." << std::endl;
+		reply->server.log.event(ServerLog::INFO, reply->Name(), "relay thread stopped");
 	}
 	catch (nng::exception e)
 	{
-		reply->server.log << reply->Name() << ": relay thread stopped (" << e.what() << ")" << std::endl;
+		reply->server.log.event(ServerLog::INFO, reply->Name(), std::string("relay thread stopped (") + e.what() + ")");
 	}
 }
 
 
 void Server::ReqRep::async_error(ClientRequesting, AsyncError error)
 {
-	server.log << Name() << ": Request ingestion error: " << error.what() << std::endl;
+	server.log.event(ServerLog::IO_ERROR, Name(), std::string("request ingestion: ").append(error.what()));
 }
 void Server::ReqRep::async_error(ServiceReplying, AsyncError error)
 {
 	if (error != nng::error::closed)
 	{
-		server.log << Name() << ": Reply ingestion error: " << error.what() << std::endl;
+		server.log.event(ServerLog::IO_ERROR, Name(), std::string("reply ingestion: ").append(error.what()));
 	}
 }
 
-void Server::ReqRep::async_recv(ServiceReplying, nng::msg &&msg)
+void Server::ReqRep::async_recv(ServiceReplying rep, nng::msg &&msg)
 {
-	// Multiple instances of this call might be received concurrently.
-	//    AsyncSendQueue is mutexed...
+	TELLING_ALLOC_STAGE(ROUTE);
 
-	//server.log << Name() << ": ...sending reply..." << std::endl;
+	if (rep.replica) rep.replica->_replied();
 
-#if 0
-	// DIAGNOSTIC
-	auto now = std::chrono::steady_clock::now();
-	MsgView::Reply reply(msg);
+	// Multiple instances of this call might be received concurrently.
+	//    AsyncSendQueue is mutexed...
 
-	long long req_time = 0, rep_time = 0;
-	for (auto &h : reply.headers())
+	if (server.trace.enabled())
 	{
-		if (h.name == "Req-Time") req_time = std::stoll(std::string(h.value));
-		if (h.name == "Rep-Time") rep_time = std::stoll(std::string(h.value));
+		Trace::Stamps stamps;
+		if (Trace::Stamp(msg, Trace::SERVER_RELAY) && Trace::Read(msg, stamps))
+			server.trace.record(stamps);
 	}
-#endif
 
 	// Forward reply to proper client
 	try
@@ -95,31 +89,22 @@ void Server::ReqRep::async_recv(ServiceReplying, nng::msg &&msg)
 	}
 	catch (nng::exception e)
 	{
-		server.log
-			<< Name() << ": could not enqueue reply to client" << std::endl
-			<< "\t" << e.what() << std::endl;
-	}
-
-#if 0
-	// DIAGNOSTIC -- including above code
-	if (req_time)
-	{
-		std::cout << "*REP returning: " << std::chrono::duration_cast<std::chrono::microseconds>
-			(now.time_since_epoch() - decltype(now.time_since_epoch())(req_time)).count() << " us" << std::endl;
+		server.log.event(ServerLog::IO_ERROR, Name(), std::string("could not enqueue reply to client: ") + e.what());
 	}
-	std::cout << std::endl;
-#endif
 }
 
 void Server::ReqRep::async_recv(ClientRequesting, nng::msg &&msg)
 {
-	MsgView::Request request;
-	try                    {request = msg;}
-	catch (MsgException e) {server.log << Name() << ": message exception: " << e.what() << std::endl; return;}
+	TELLING_ALLOC_STAGE(ROUTE);
 
-	auto status = server.services.routeRequest(request.uri(), std::move(msg));
+	if (server.trace.enabled()) Trace::Stamp(msg, Trace::SERVER_RECV);
 
-	//server.log << Name() << ": routing to `" << request.uri() << "`" << std::endl;
+	MsgView::Request request;
+	try                      {request = msg;}
+	catch (MsgException &e)  {server.log.event(ServerLog::MALFORMED, Name(), e.what(), {}, 0, msg.get_pipe().get().id); return;}
+
+	auto priority = server.qos.classify(request);
+	auto status = server.services.routeRequest(request, std::move(msg), priority);
 
 	if (status.isSuccessful())
 	{
@@ -127,9 +112,12 @@ void Server::ReqRep::async_recv(ClientRequesting, nng::msg &&msg)
 	}
 	else
 	{
-		// Log the error.
-		server.log << Name() << ": error " << status << " (" << status.reasonPhrase()
-			<< ") routing to `" << request.uri() << "`" << std::endl;
+		if (status.code == StatusCode::NotFound) routeNotFound   .fetch_add(1, std::memory_order_relaxed);
+		else                                     routeUnavailable.fetch_add(1, std::memory_order_relaxed);
+
+		// Log the error.  This is rate-limited and never blocks routing.
+		server.log.event((status.code == StatusCode::NotFound) ? ServerLog::ROUTE_NOT_FOUND : ServerLog::ROUTE_UNAVAILABLE,
+			Name(), status.reasonPhrase(), request.uriString(), status.toInt(), msg ? msg.get_pipe().get().id : 0);
 
 		// Reply to client with error message.
 		MsgWriter writer;
@@ -144,7 +132,7 @@ void Server::ReqRep::async_recv(ClientRequesting, nng::msg &&msg)
 				<< "No service for URI `" << request.uri() << "`";
 			break;
 		case StatusCode::ServiceUnavailable:
-			writer.writeBody() << "Service exists but forwarding failed.";
+			writer.writeBody() << "Service exists but forwarding failed or it is overloaded.";
 			break;
 		default:
 			break;
@@ -153,7 +141,7 @@ void Server::ReqRep::async_recv(ClientRequesting, nng::msg &&msg)
 
 		// Copy routing info
 		if (msg) writer.setNNGHeader(msg.header().get());
-		else     server.log << "\tPROBLEM: request was discarded, can't reply" << std::endl;
+		else     server.log.event(ServerLog::ROUTE_UNAVAILABLE, Name(), "request was discarded, can't reply", request.uriString());
 
 		// Reply, acting as a service.
 		async_recv(ServiceReplying{}, writer.release());
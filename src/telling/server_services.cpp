@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <telling/server.h>
 #include <telling/msg_writer.h>
 
@@ -50,14 +52,12 @@ void Server::Services::async_sent(Replying rep)
 }
 void Server::Services::async_error(Replying rep, AsyncError status)
 {
-	server.log << Name()
-		<< ": Registration Responder error: " << nng::to_string(status) << std::endl;
+	server.log.event(ServerLog::IO_ERROR, Name(), std::string("registration responder: ") + nng::to_string(status));
 }
 
 void Server::Services::async_recv(Replying rep, nng::msg &&_msg)
 {
 	auto &log = server.log;
-
 	auto queryID = rep.id;
 
 
@@ -69,7 +69,7 @@ void Server::Services::async_recv(Replying rep, nng::msg &&_msg)
 	}
 	catch (MsgException e)
 	{
-		log << Name() << ": message parse exception: " << e.what() << std::endl;
+		log.event(ServerLog::MALFORMED, Name(), e.what(), {}, 0, owned_msg.get_pipe().get().id);
 
 		rep.send(e.replyWithError("Service Registry"));
 		return;
@@ -82,51 +82,62 @@ void Server::Services::async_recv(Replying rep, nng::msg &&_msg)
 	if (msg.uri() != "*services")
 	{
 		// Don't understand this message
-		log << Name() << ": did not recognize URI `" << msg.uri() << "`" << endl;
+		log.event(ServerLog::REGISTRY, Name(), "did not recognize URI", msg.uriString());
 	}
 
 	/*
-		Two-line format:
-			Line 1: path prefix (base inproc address)
-			Line 2: additional configuration (currently ignored)
+		Two lines per service; a batch repeats them.
+			Line 1: path prefix
+			Line 2: service address; a bare name is an inproc address.
+				If empty, the path prefix is the inproc address.
+				May end with a tab and the patterns to dial (default all).
 	*/
 	auto text = msg.bodyString();
 	const char *pi = text.data(), *pe = pi+text.length();
 
-	auto pathPrefix = detail::ConsumeLine(pi, pe);
-	auto configLine = detail::ConsumeLine(pi, pe);
+	auto pipeID = owned_msg.get_pipe().get().id;
 
-	// Body parse failure
-	if (pi != pe)
+	NewRoute request{queryID, pipeID, {}};
+	do
 	{
-		log << Name() << ": invalid dial-in." << endl
-			<< "\t: prefix `" << pathPrefix << endl
-			<< "\t: config `" << configLine << "`" << endl;
-		if (pi != pe)
+		auto pathPrefix = detail::ConsumeLine(pi, pe);
+		auto configLine = detail::ConsumeLine(pi, pe);
+
+		auto patterns = Patterns::All();
+		auto address  = configLine.substr(0, configLine.find('\t'));
+		if (address.length() < configLine.length())
+			patterns = Patterns::Parse(configLine.substr(address.length()+1));
+
+		auto baseAddress = HostAddress::Base::Parse(address.length() ? address : pathPrefix);
+
+		// Body parse failure
+		if (!baseAddress || patterns.empty())
 		{
-			log << "\t: additional unrecognized data: `"
-				<< std::string_view(pi, pe-pi) << "`" << endl;
+			log.event(ServerLog::REGISTRY, Name(),
+				"invalid dial-in; config `" + std::string(configLine) + "`",
+				pathPrefix, HttpStatus::toInt(HttpStatus::Code::BadRequest), pipeID);
+
+			auto writer = WriteReply(HttpStatus::Code::BadRequest);
+			writer.writeBody() << "Malformed Registration Request Body.";
+			rep.send(writer.release());
+			return;
 		}
 
-		auto writer = WriteReply(HttpStatus::Code::BadRequest);
-		writer.writeBody() << "Malformed Registration Request Body.";
-		rep.send(writer.release());
-		return;
+		request.routes.push_back(Enrollment{std::string(pathPrefix), baseAddress, patterns});
 	}
+	while (pi != pe);
 
 
 	std::lock_guard<std::mutex> g(mtx);
 
 	// Add to registration map
-	auto pipeID = owned_msg.get_pipe().get().id;
-	registrationMap.emplace(pipeID, pathPrefix);
+	auto &paths = registrationMap[pipeID];
+	for (auto &route : request.routes) paths.push_back(route.map_uri);
 
 	/*
-		Kick off establishment of a new Route.
+		Kick off establishment of new Routes or replicas.
 	*/
-	auto baseAddress = HostAddress::Base::InProc(pathPrefix);
-
-	management.route_open.emplace_back(NewRoute{queryID, pipeID, std::string(pathPrefix), baseAddress});
+	management.route_open.emplace_back(std::move(request));
 	management.cond.notify_one();
 }
 
@@ -142,37 +153,39 @@ void Server::Services::pipeEvent(Socket *socket, nng::pipe_view pipe, nng::pipe_
 
 	auto pipeID = pipe.get().id;
 
-	log << Name() << ": disconnect #" << pipeID << " ";
-
 	std::lock_guard<std::mutex> g(mtx);
 
-	std::string path;
+	auto pipe_pos = registrationMap.find(pipeID);
+	if (pipe_pos == registrationMap.end())
 	{
-		auto pipe_pos = registrationMap.find(pipeID);
-		if (pipe_pos == registrationMap.end())
-		{
-			log << "... not registered." << endl;
-			registrationMap.erase(pipe_pos);
-			return;
-		}
-		log << "`" << pipe_pos->second << "`... " << endl;;
-
-		path = std::move(pipe_pos->second);
-		registrationMap.erase(pipe_pos);
+		log.event(ServerLog::REGISTRY, Name(), "disconnect (not registered)", {}, 0, pipeID);
+		return;
 	}
 
-	auto pos = map.find(path);
-	if (pos != map.end())
-	{
-		Route *route = *pos;
-		auto n = map.erase(pos);
-		management.route_close.push_back(route);
-		management.cond.notify_one();
-	}
-	else
+	/*
+		Routes still being dialed are not in the map yet;
+			the management thread drops them when it finds the registration gone.
+	*/
+	for (auto &path : pipe_pos->second)
 	{
-		log << "\tWARNING: routing table entry was missing." << endl;
+		log.event(ServerLog::REGISTRY, Name(), "disconnect", path, 0, pipeID);
+
+		if (map.find(path) != map.end())
+			management.route_close.push_back(ClosedReplica{std::move(path), pipeID});
 	}
+	registrationMap.erase(pipe_pos);
+
+	management.cond.notify_one();
+}
+
+void Server::Services::setBalancing(std::string_view uri, const Balancing &_balancing)
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	balancing.insert_or_assign(std::string(uri), _balancing);
+
+	auto pos = map.find(uri);
+	if (pos != map.end()) (*pos)->setBalancing(_balancing);
 }
 
 void Server::Services::run_management_thread()
@@ -188,116 +201,256 @@ void Server::Services::run_management_thread()
 	{
 		while (to_close.size())
 		{
-			auto route = to_close.front();
+			auto closed = std::move(to_close.front());
 			to_close.pop_front();
-			server.publish.subscribe.disconnect(route->path);
 
-			// Publish existence of new service?
-			auto report = WriteReport("*services", StatusCode::Gone);
-			report.writeBody() << route->path;
-			publish_events.publish(report.release());
+			auto pos = map.find(closed.map_uri);
+			if (pos == map.end()) continue;
+			Route *route = *pos;
+
+			Replica *replica = route->removeReplica(closed.pipeID);
+			if (!replica) continue;
+
+			server.publish.subscribe.disconnect(replica->address);
+			delete replica;
+
+			if (route->replicaCount())
+			{
+				log.event(ServerLog::REGISTRY, Name(),
+					"lost a replica; " + std::to_string(route->replicaCount()) + " remain", closed.map_uri, 0, closed.pipeID);
+				continue;
+			}
 
+			map.erase(pos);
 			delete route;
+
+			// Publish disappearance of the service
+			auto report = WriteReport("*services", StatusCode::Gone);
+			report.writeBody() << closed.map_uri;
+			publish_events.publish(report.release());
 		}
 
-		while (to_open.size())
+		if (to_open.size())
 		{
-			auto spec = std::move(to_open.front());
-			to_open.pop_front();
+			std::vector<NewRoute> requests(
+				std::make_move_iterator(to_open.begin()), std::make_move_iterator(to_open.end()));
+			to_open.clear();
 
-			/*
-				Can't already have this Routing
-			*/
-			if (map.find(spec.map_uri) != map.end())
-			{
-				// Consider possibility of race condition if service is torn down and re-established.
-				log << Name() << ": already have `" << spec.map_uri << "`" << endl;
+			open_routes(requests, lock);
 
-				// Remove pipe
-				registrationMap.erase(spec.pipeID);
+			// Disconnects may have arrived while dialing.
+			continue;
+		}
 
-				// Failed dialing... service unavailable
-				auto notify = WriteReply(StatusCode::Conflict);
-				notify.writeHeader("Content-Type", "text/plain");
-				notify.writeBody()
-					<< std::string(spec.map_uri)
-					<< "\nThis URI is already registered.";
-				register_reply.respondTo(spec.queryID, notify.release());
+		management.cond.wait(lock);
+	}
+}
 
-				continue;
-			}
+void Server::Services::open_routes(std::vector<NewRoute> &requests, std::unique_lock<std::mutex> &lock)
+{
+	auto &log = server.log;
 
+	struct Pending
+	{
+		const NewRoute   *request;
+		const Enrollment *spec;
+		Replica          *replica = nullptr;
+		StatusCode        status  = StatusCode::OK;
+		std::string       error;
+	};
+
+	std::vector<Pending> pending;
+	for (auto &request : requests)
+		for (auto &spec : request.routes)
+			pending.push_back(Pending{&request, &spec});
 
-			/*
-				Create service sockets and dial the service.
-			*/
-			log << Name() << ": registering service `" << spec.map_uri << "`..." << endl;
+	/*
+		Conflicting addresses are refused before dialing.
+	*/
+	for (auto &p : pending)
+	{
+		auto existing = map.find(p.spec->map_uri);
+		if (existing != map.end() && (*existing)->hasAddress(p.spec->host))
+		{
+			p.status = StatusCode::Conflict;
+			p.error  = "already registered";
+		}
+	}
 
-			try
+	/*
+		Create service sockets and dial the services without holding the lock.
+			Routing continues meanwhile; large batches are dialed by several threads.
+	*/
+	lock.unlock();
+	{
+		std::atomic<size_t> next = 0;
+		auto dialer = [&]()
+		{
+			for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < pending.size();)
 			{
-				Route &sockets = **map.emplace(spec.map_uri, new Route(server, std::string(spec.map_uri))).first;
+				auto &p = pending[i];
+				if (p.status != StatusCode::OK) continue;
+				try
+				{
+					p.replica = new Replica(server, p.request->pipeID, p.spec->host, p.spec->patterns);
+
+					// Connect pub-sub
+					if (p.spec->patterns.contains(Pattern::PUB_SUB))
+						server.publish.subscribe.dial(p.spec->host);
+
+					p.replica->dial();
+				}
+				catch (nng::exception e)
+				{
+					delete p.replica;
+					p.replica = nullptr;
+					p.status  = StatusCode::ServiceUnavailable;
+					p.error   = e.what();
+				}
+			}
+		};
+
+		size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), MaxDialThreads);
+		threadCount = std::min(threadCount, (pending.size() + DialsPerThread - 1) / DialsPerThread);
 
-				// Connect pub-sub
-				server.publish.subscribe.dial(spec.host);
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; ++i) threads.emplace_back(dialer);
+		dialer();
+		for (auto &thread : threads) thread.join();
+	}
+	lock.lock();
 
+	/*
+		Enter the dialed replicas into the routing table.
+	*/
+	for (auto &p : pending)
+	{
+		auto &spec = *p.spec;
+		auto pipeID = p.request->pipeID;
+
+		// The service may have disconnected while we were dialing.
+		auto reg = registrationMap.find(pipeID);
+		auto regPath = (reg != registrationMap.end())
+			? std::find(reg->second.begin(), reg->second.end(), spec.map_uri)
+			: std::vector<std::string>::iterator();
+		if (reg == registrationMap.end() || regPath == reg->second.end())
+		{
+			delete p.replica;
+			p.replica = nullptr;
+			p.status  = StatusCode::Gone;
+			continue;
+		}
 
-				sockets.dial(spec.host);
+		auto existing = map.find(spec.map_uri);
+		bool newRoute = (existing == map.end());
+		Route *route = nullptr;
 
-				log << " ...OK" << endl;
-			}
-			catch (nng::exception e)
+		if (p.replica) try
+		{
+			if (newRoute)
 			{
-				log << " ...Failed dialing new route!" << endl
-					<< "\t" << e.what() << endl
-					<< "\tsource: " << e.who() << endl;
-				map.erase(spec.map_uri);
-				
-				// Remove pipe
-				registrationMap.erase(spec.pipeID);
-
-				// Failed dialing... service unavailable
-				auto notify = WriteReply(StatusCode::ServiceUnavailable);
-				notify.writeHeader("Content-Type", "text/plain");
-				notify.writeBody()
-					<< std::string(spec.host.base)
-					<< "\nCould not dial specified service URI.";
-				register_reply.respondTo(spec.queryID, notify.release());
-
-				continue;
+				auto config = balancing.find(spec.map_uri);
+				route = new Route(server, spec.map_uri,
+					(config != balancing.end()) ? config->second : Balancing());
 			}
+			else route = *existing;
 
-			// Notify service of successful enrollment.
-			auto notify = WriteReply();
-			notify.writeHeader("Content-Type", "text/plain");
-			notify.writeBody()
-				<< spec.map_uri
-				<< "\nEnrolled with this URI.";
-			register_reply.respondTo(spec.queryID, notify.release());
+			route->addReplica(p.replica);
+
+			if (newRoute) map.emplace(spec.map_uri, route);
+		}
+		catch (nng::exception e)
+		{
+			if (newRoute) delete route;
+			delete p.replica;
+			p.replica = nullptr;
+			p.status  = (e.get_error() == nng::error::addrinuse) ? StatusCode::Conflict : StatusCode::ServiceUnavailable;
+			p.error   = e.what();
+		}
 
-			// Publish existence of new service
+		if (!p.replica)
+		{
+			bool conflict = (p.status == StatusCode::Conflict);
+
+			log.event(ServerLog::REGISTRY, Name(),
+				std::string(conflict ? "already registered at " : "failed dialing ") + std::string(spec.host.base) + ": " + p.error,
+				spec.map_uri, Status(p.status).toInt(), pipeID);
+
+			// Remove path from pipe
+			reg->second.erase(regPath);
+			if (reg->second.empty()) registrationMap.erase(reg);
+			continue;
+		}
+
+		log.event(ServerLog::REGISTRY, Name(),
+			std::string(newRoute ? "registered service at " : "registered replica at ") + std::string(spec.host.base),
+			spec.map_uri, 0, pipeID);
+
+		// Publish existence of new service
+		if (newRoute)
+		{
 			auto report = WriteReport("*services", StatusCode::Created);
 			report.writeBody() << spec.map_uri;
 			publish_events.publish(report.release());
 		}
+	}
 
-		management.cond.wait(lock);
+	/*
+		Notify each service of its enrollment.
+			A single registration gets the original reply; batches get one line per URI.
+	*/
+	auto p = pending.begin();
+	for (auto &request : requests)
+	{
+		if (request.routes.size() == 1)
+		{
+			auto &spec = *p->spec;
+			bool  ok   = (p->status == StatusCode::OK), conflict = (p->status == StatusCode::Conflict);
+
+			// Conflict, or failed dialing... service unavailable
+			auto notify = WriteReply(ok ? StatusCode::OK : (conflict ? StatusCode::Conflict : StatusCode::ServiceUnavailable));
+			notify.writeHeader("Content-Type", "text/plain");
+			if      (ok)       notify.writeBody()
+				<< spec.map_uri
+				<< "\nEnrolled with this URI.";
+			else if (conflict) notify.writeBody()
+				<< spec.map_uri
+				<< "\nThis URI is already registered at this address.";
+			else               notify.writeBody()
+				<< std::string(spec.host.base)
+				<< "\nCould not dial specified service URI.";
+			register_reply.respondTo(request.queryID, notify.release());
+			++p;
+			continue;
+		}
+
+		auto end = p + request.routes.size();
+		bool allEnrolled = std::all_of(p, end, [](const Pending &q) {return q.status == StatusCode::OK;});
+
+		auto notify = WriteReply(allEnrolled ? StatusCode::OK : StatusCode::MultiStatus);
+		notify.writeHeader("Content-Type", "text/plain");
+		auto body = notify.writeBody();
+		for (; p != end; ++p) body << Status(p->status).toInt() << ' ' << p->spec->map_uri << '\n';
+		register_reply.respondTo(request.queryID, notify.release());
 	}
 }
 
 
 
-Server::Route::Route(Server &_server, std::string _path) :
-	server(_server), path(_path),
-	req(*this),
-	req_send_to_service  (req.socketView(), ClientRequesting{}),
-	req_recv_from_service(req.socketView(), ServiceReplying{})
+Server::Replica::Replica(Server &_server, PipeID _registration, const HostAddress::Base &_address, Patterns _patterns) :
+	server(_server), registration(_registration), address(_address), patterns(_patterns),
+	pipeWatch(std::make_shared<PipeWatch>(this)),
+	req_sendQueue(_server.qos, _server.trace, metrics),
+	req_send_to_service  (req.socketView(), ClientRequesting{}, &metrics),
+	req_recv_from_service(req.socketView(), ServiceReplying{this}, &metrics)
 {
 	req_send_to_service.send_init(req_sendQueue.weak());
+	req.setPipeHandler(pipeWatch);
 
 	// Route replies from services
 	req_recv_from_service.recv_start(server.reply.get_weak());
 }
-Server::Route::~Route()
+Server::Replica::~Replica()
 {
 	if (!halted)
 	{
@@ -312,19 +465,259 @@ Server::Route::~Route()
 	req_recv_from_service.recv_stop();
 }
 
-void Server::Route::dial(const HostAddress::Base &base)
+void Server::Replica::dial()
 {
-	req.dial(base);
-	push.dial(base);
+	if (patterns.contains(Pattern::REQ_REP))   req .dial(address);
+	if (patterns.contains(Pattern::PUSH_PULL)) push.dial(address);
 }
 
-void Server::Route::sendPush   (nng::msg &&msg)
+void Server::Replica::sendPush   (nng::msg &&msg)
 {
+	if (!patterns.contains(Pattern::PUSH_PULL))
+		throw nng::exception(nng::error::notsup, "Replica::sendPush (service does not pull)");
+
 	std::lock_guard<std::mutex> g(mtx);
 	push.push(std::move(msg));
 }
-void Server::Route::sendRequest(nng::msg &&msg) 
+void Server::Replica::sendRequest(nng::msg &&msg, unsigned priority)
+{
+	if (!patterns.contains(Pattern::REQ_REP))
+		throw nng::exception(nng::error::notsup, "Replica::sendRequest (service does not reply)");
+
+	std::lock_guard<std::mutex> g(mtx);
+	switch (req_sendQueue->admit(priority, msg))
+	{
+	case RequestQueue::SEND_NOW:
+		_sent();
+		try
+		{
+			req_send_to_service.send_msg(std::move(msg));
+		}
+		catch (...)
+		{
+			_replied();
+			req_sendQueue->abandon();
+			throw;
+		}
+		break;
+	case RequestQueue::QUEUED:
+		_sent();
+		break;
+	case RequestQueue::SHED:
+		throw nng::exception(nng::error::again, "Replica::sendRequest (QoS queue limit)");
+	}
+}
+
+uint32_t Server::Replica::load(std::chrono::milliseconds lostAfter) noexcept
+{
+	std::lock_guard<std::mutex> g(load_mtx);
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - windowStart >= lostAfter)
+	{
+		// The older window has waited at least lostAfter; give up on it.
+		sentEarlier = sentRecent;
+		sentRecent  = 0;
+		windowStart = now;
+		outstanding.store(sentEarlier, std::memory_order_relaxed);
+	}
+	return sentRecent + sentEarlier;
+}
+
+void Server::Replica::_sent() noexcept
+{
+	std::lock_guard<std::mutex> g(load_mtx);
+	++sentRecent;
+	outstanding.store(sentRecent + sentEarlier, std::memory_order_relaxed);
+}
+
+void Server::Replica::_replied() noexcept
+{
+	std::lock_guard<std::mutex> g(load_mtx);
+	if      (sentEarlier) --sentEarlier;
+	else if (sentRecent)  --sentRecent;
+	outstanding.store(sentRecent + sentEarlier, std::memory_order_relaxed);
+}
+
+void Server::Replica::_pipeLost() noexcept
+{
+	// Requests sent on the connection won't be answered; queued ones are still to be sent.
+	size_t queued = queueDepth();
+
+	std::lock_guard<std::mutex> g(load_mtx);
+	sentRecent  = uint32_t(std::min<size_t>(queued, sentRecent + sentEarlier));
+	sentEarlier = 0;
+	outstanding.store(sentRecent, std::memory_order_relaxed);
+}
+
+
+
+Server::Route::Route(Server &_server, std::string _path, const Balancing &_balancing) :
+	server(_server), path(_path),
+	balancing(_balancing)
+{
+}
+Server::Route::~Route()
+{
+	// Replicas are normally removed first.
+	for (Replica *replica : replicas) delete replica;
+}
+
+void Server::Route::addReplica(Replica *replica)
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	for (Replica *other : replicas)
+	{
+		if (other->address == replica->address) throw nng::exception(nng::error::addrinuse,
+			"Route::addReplica (address already registered)");
+	}
+
+	replicas.push_back(replica);
+	_buildRing();
+}
+
+bool Server::Route::hasAddress(const HostAddress::Base &address) const
 {
 	std::lock_guard<std::mutex> g(mtx);
-	req_send_to_service.send_msg(std::move(msg));
+
+	return std::any_of(replicas.begin(), replicas.end(),
+		[&](Replica *r) {return r->address == address;});
+}
+
+Server::Replica *Server::Route::removeReplica(PipeID registration)
+{
+	std::lock_guard<std::mutex> g(mtx);
+
+	auto pos = std::find_if(replicas.begin(), replicas.end(),
+		[&](Replica *r) {return r->registration == registration;});
+	if (pos == replicas.end()) return nullptr;
+
+	Replica *replica = *pos;
+	replicas.erase(pos);
+	_buildRing();
+	return replica;
+}
+
+size_t Server::Route::replicaCount() const
+{
+	std::lock_guard<std::mutex> g(mtx);
+	return replicas.size();
+}
+
+void Server::Route::setBalancing(const Balancing &_balancing)
+{
+	std::lock_guard<std::mutex> g(mtx);
+	balancing = _balancing;
+	_buildRing();
+}
+
+void Server::Route::sendPush(nng::msg &&msg, const MsgView::Request &request)
+{
+	std::lock_guard<std::mutex> g(mtx);
+	Replica *replica = _choose(request, Pattern::PUSH_PULL);
+	if (!replica) throw nng::exception(nng::error::connrefused, "Route::sendPush (no replicas pull)");
+	replica->sendPush(std::move(msg));
+}
+void Server::Route::sendRequest(nng::msg &&msg, const MsgView::Request &request, unsigned priority)
+{
+	std::lock_guard<std::mutex> g(mtx);
+	Replica *replica = _choose(request, Pattern::REQ_REP);
+	if (!replica) throw nng::exception(nng::error::connrefused, "Route::sendRequest (no replicas reply)");
+	replica->sendRequest(std::move(msg), priority);
+}
+
+
+namespace
+{
+	// FNV-1a, folded to 32 bits.
+	uint32_t RingHash(std::string_view key, uint64_t seed = 0)
+	{
+		uint64_t h = 14695981039346656037ull ^ seed;
+		for (char c : key) {h ^= uint8_t(c); h *= 1099511628211ull;}
+		return uint32_t(h ^ (h >> 32));
+	}
+}
+
+void Server::Route::_buildRing()
+{
+	ring.clear();
+	if (balancing.strategy != Balancing::CONSISTENT_HASH) return;
+
+	const unsigned points = (balancing.virtualNodes ? balancing.virtualNodes : 1);
+	ring.reserve(replicas.size() * points);
+	for (Replica *replica : replicas)
+	{
+		std::string name = replica->address.base;
+		for (unsigned i = 0; i < points; ++i) ring.emplace_back(RingHash(name, i), replica);
+	}
+	std::sort(ring.begin(), ring.end(),
+		[](const RingPoint &a, const RingPoint &b) {return a.first < b.first;});
+}
+
+Server::Replica *Server::Route::_choose(const MsgView::Request &request, PATTERN pattern)
+{
+	// Only replicas listening with the pattern are candidates.
+	const size_t count = replicas.size();
+	auto serves  = [&](Replica *r) {return r->patterns.contains(pattern);};
+	auto healthy = [&](Replica *r) {return serves(r) && r->healthy(pattern);};
+	if (count <= 1) return (count && serves(replicas[0])) ? replicas[0] : nullptr;
+
+	switch (balancing.strategy)
+	{
+	case Balancing::CONSISTENT_HASH:
+		if (ring.size())
+		{
+			std::string_view key;
+			if (balancing.hashHeader.length()) for (auto &header : request.headers())
+			{
+				if (header.is(balancing.hashHeader)) {key = header.value; break;}
+			}
+			if (!key.data()) key = request.uri().substr(path.length());
+
+			// Walk clockwise from the key to the first healthy replica.
+			uint32_t h = RingHash(key);
+			auto pos = std::lower_bound(ring.begin(), ring.end(), h,
+				[](const RingPoint &p, uint32_t v) {return p.first < v;});
+			for (size_t n = 0; n < ring.size(); ++n, ++pos)
+			{
+				if (pos == ring.end()) pos = ring.begin();
+				if (healthy(pos->second)) return pos->second;
+			}
+		}
+		break;
+
+	case Balancing::LEAST_OUTSTANDING:
+		{
+			Replica *best = nullptr;
+			uint32_t bestLoad = 0;
+			for (size_t n = 0; n < count; ++n)
+			{
+				Replica *r = replicas[(cursor + n) % count];
+				if (!healthy(r)) continue;
+				uint32_t load = r->load(std::chrono::milliseconds(balancing.lostAfter_ms));
+				if (!best || load < bestLoad) {best = r; bestLoad = load;}
+			}
+			++cursor;
+			if (best) return best;
+		}
+		break;
+
+	case Balancing::ROUND_ROBIN:
+	default:
+		for (size_t n = 0; n < count; ++n)
+		{
+			Replica *r = replicas[cursor++ % count];
+			if (healthy(r)) return r;
+		}
+		break;
+	}
+
+	// No replica is connected; queue on one with the pattern until it reconnects.
+	for (size_t n = 0; n < count; ++n)
+	{
+		Replica *r = replicas[cursor++ % count];
+		if (serves(r)) return r;
+	}
+	return nullptr;
 }
@@ -0,0 +1,62 @@
+#include <ostream>
+
+#include <telling/server.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	const char *const SegmentNames[Trace::HOP_COUNT] =
+	{
+		"total",
+		"relay",
+		"routing",
+		"deliver",
+		"service",
+		"return",
+	};
+}
+
+
+void Server::Tracing::record(const Trace::Stamps &stamps) noexcept
+{
+	// Segments with a missing stamp at either end are skipped.
+	for (unsigned i = 1; i < Trace::HOP_COUNT; ++i)
+	{
+		if (stamps[i-1] && stamps[i] >= stamps[i-1])
+			_segments[i].record(stamps[i] - stamps[i-1]);
+	}
+
+	auto first = stamps[Trace::CLIENT_SEND], last = stamps[Trace::SERVER_RELAY];
+	if (first && last >= first) _segments[0].record(last - first);
+}
+
+void Server::Tracing::reset() noexcept
+{
+	for (auto &segment : _segments) segment.reset();
+}
+
+std::vector<Server::Tracing::Report> Server::Tracing::report() const
+{
+	std::vector<Report> reports;
+	for (unsigned i = 1; i <= Trace::HOP_COUNT; ++i)
+	{
+		// The total comes last.
+		auto &h = _segments[i % Trace::HOP_COUNT];
+		reports.push_back(Report{SegmentNames[i % Trace::HOP_COUNT],
+			h.count(), h.percentile(0.50), h.percentile(0.99), h.max()});
+	}
+	return reports;
+}
+
+void Server::Tracing::report(std::ostream &out) const
+{
+	for (auto &r : report())
+	{
+		out << "Trace `" << r.segment << "`: " << r.count
+			<< " samples, p50 " << r.p50 << " us, p99 " << r.p99
+			<< " us, max " << r.max << " us" << std::endl;
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <telling/service.h>
 #include <telling/service_reactor.h>
+#include <telling/msg_writer.h>
 
 
 using namespace telling;
@@ -9,7 +10,12 @@ using namespace telling;
 
 
 Service_Base::Service_Base(std::string _uri, std::string_view serverID) :
-	uri(_uri)
+	Service_Base(_uri, serverID, Patterns::All())
+{
+}
+
+Service_Base::Service_Base(std::string _uri, std::string_view serverID, Patterns _patterns) :
+	uri(_uri), patterns(_patterns)
 {
 	if (serverID.length()) registerURI(serverID);
 }
@@ -23,35 +29,70 @@ void Service_Base::registerURI(std::string_view serverID)
 	if (registration)
 		throw nng::exception(nng::error::busy, "Service Registration already in progress.");
 
-	registration.emplace(uri, uri, serverID);
+	registration.emplace(uri, uri, serverID, patterns);
+}
+
+void Service_Base::registerReplica(std::string_view routeURI, std::string_view serverID)
+{
+	if (registration)
+		throw nng::exception(nng::error::busy, "Service Registration already in progress.");
+
+	registration.emplace(uri, routeURI, serverID, patterns);
+}
+
+
+static Patterns HandlerPatterns(const std::weak_ptr<ServiceHandler_Base> &handler)
+{
+	auto locked = handler.lock();
+	return locked ? locked->patterns() : Patterns::All();
 }
 
 
 Service::Service(std::string _uri, std::string_view serverID)
-	: Service_Base(_uri, serverID)
+	: Service(_uri, serverID, Patterns::All())
+{
+}
+Service::Service(std::string _uri, std::string_view serverID, Patterns _patterns)
+	: Service_Base(_uri, serverID, _patterns)
 	//handler(std::move(_handler)),
 {
+	if (patterns.contains(Pattern::REQ_REP))   _replier  .emplace();
+	if (patterns.contains(Pattern::PUSH_PULL)) _puller   .emplace();
+	if (patterns.contains(Pattern::PUB_SUB))   _publisher.emplace();
 	listen(inProcAddress());
 }
+Service::Service(std::weak_ptr<ServiceHandler_Base> handler, std::string _uri, std::string_view serverID)
+	: Service(_uri, "", HandlerPatterns(handler))
+{
+	initialize(handler);
+	if (serverID.length()) registerURI(serverID);
+}
 Service::~Service()
 {
 	close();
 }
 
-void Service::initialize(std::weak_ptr<ServiceHandler_Base> _handler)
+void Service::initialize(std::weak_ptr<ServiceHandler_Base> _handler, unsigned replyContexts)
 {
-	_replier  .socket()->setPipeHandler(_handler);
-	_puller   .socket()->setPipeHandler(_handler);
-	_publisher.socket()->setPipeHandler(_handler);
-	_replier  .initialize(_handler);
-	_puller   .initialize(_handler);
-	_publisher.initialize(_handler);
+	if (_replier)   _replier  ->socket()->setPipeHandler(_handler);
+	if (_puller)    _puller   ->socket()->setPipeHandler(_handler);
+	if (_publisher) _publisher->socket()->setPipeHandler(_handler);
+	if (_replier)   _replier  ->initialize(_handler, replyContexts);
+	if (_puller)    _puller   ->initialize(_handler);
+	if (_publisher) _publisher->initialize(_handler);
 }
 
 
 Service_Box::Service_Box(std::string _uri, std::string_view serverID)
-	: Service_Base(_uri, serverID)
+	: Service_Box(_uri, serverID, Patterns::All())
 {
+}
+Service_Box::Service_Box(std::string _uri, std::string_view serverID, Patterns _patterns)
+	: Service_Base(_uri, serverID, _patterns)
+{
+	if (patterns.contains(Pattern::REQ_REP))   _replier  .emplace();
+	if (patterns.contains(Pattern::PUB_SUB))   _publisher.emplace();
+	if (patterns.contains(Pattern::PUSH_PULL)) _puller   .emplace();
 	listen(inProcAddress());
 }
 Service_Box::~Service_Box()
@@ -71,3 +112,29 @@ void ServiceHandler::async_sent(Publishing pub)
 	nng::msg next;
 	if (publishQueue.consume(next)) pub.send(std::move(next));
 }
+
+
+#if TELLING_COROUTINES
+nng::msg ServiceHandler_Coro::ExceptionReply(std::exception_ptr ex)
+{
+	try
+	{
+		std::rethrow_exception(ex);
+	}
+	catch (ReplyableException &e)
+	{
+		return e.replyWithError();
+	}
+	catch (std::exception &e)
+	{
+		auto msg = WriteReply(StatusCode::InternalServerError);
+		msg.writeHeader("Content-Type", "text/plain");
+		msg.writeBody() << "C++ exception in service coroutine:\r\n\t" << e.what();
+		return msg.release();
+	}
+	catch (...)
+	{
+		return WriteReply(StatusCode::InternalServerError).release();
+	}
+}
+#endif
@@ -0,0 +1,93 @@
+#include <telling/service_executor.h>
+#include <telling/msg_writer.h>
+
+
+using namespace telling;
+
+
+ServiceHandler_Executor::ServiceHandler_Executor(std::shared_ptr<ServiceHandler_Base> inner,
+	Executor &executor, Executor::PRIORITY priority, size_t capacity) :
+	_inner(std::move(inner)),
+	_queue(executor, priority, capacity)
+{
+	if (!_inner)
+		throw nng::exception(nng::error::inval, "ServiceHandler_Executor (no inner handler)");
+}
+
+ServiceHandler_Executor::~ServiceHandler_Executor()
+{
+	_queue.drain();
+}
+
+
+void ServiceHandler_Executor::async_recv(Replying rep, nng::msg &&request)
+{
+	Reply  *comm = rep.comm;
+	QueryID id   = rep.id;
+
+	bool posted = _queue.post([this, comm, id, request = std::move(request)]() mutable
+	{
+		nng::msg reply;
+		auto failed = [&](const char *what)
+		{
+			AsyncError error(nng::error::internal);
+			error.error_msg = what;
+			_reply().async_error(Replying{comm, id}, error);
+
+			auto msg = WriteReply(StatusCode::InternalServerError);
+			msg.writeHeader("Content-Type", "text/plain");
+			msg.writeBody() << "C++ exception in service handler:\r\n\t" << what;
+			reply = msg.release();
+		};
+
+		try
+		{
+			_reply().async_recv(Replying{comm, id, {&reply}}, std::move(request));
+		}
+		catch (std::exception &e)    {failed(e.what());}
+		catch (...)                   {failed("unknown exception");}
+
+		if (reply) try
+		{
+			comm->respondTo(id, std::move(reply));
+		}
+		catch (nng::exception &e)
+		{
+			AsyncError error(e.get_error());
+			error.error_msg = e.what();
+			_reply().async_error(Replying{comm, id}, error);
+		}
+	});
+
+	if (!posted)
+	{
+		// Backpressure: refuse the request right away.
+		_reply().async_error(Replying{comm, id}, nng::error::again);
+		rep.send(WriteReply(StatusCode::ServiceUnavailable).release());
+	}
+}
+
+void ServiceHandler_Executor::async_recv(Pulling pull, nng::msg &&msg)
+{
+	bool posted = _queue.post([this, pull, msg = std::move(msg)]() mutable
+	{
+		try
+		{
+			_pull().async_recv(pull, std::move(msg));
+		}
+		catch (std::exception &e)
+		{
+			AsyncError error(nng::error::internal);
+			error.error_msg = e.what();
+			_pull().async_error(pull, error);
+		}
+		catch (...)
+		{
+			AsyncError error(nng::error::internal);
+			error.error_msg = "unknown exception";
+			_pull().async_error(pull, error);
+		}
+	});
+
+	if (!posted) _pull().async_error(pull, nng::error::again);
+}
@@ -5,11 +5,32 @@
 using namespace telling;
 
 
-Reactor::Reactor(UriView uri_prefix) :
-	_uri_prefix(uri_prefix)
+Reactor::Reactor(UriView uri_prefix, Concurrency concurrency) :
+	_uri_prefix(uri_prefix), _concurrency(concurrency)
 {
 }
 
+Patterns Reactor::patterns() const noexcept
+{
+	Patterns result = Patterns(Pattern::REQ_REP) + Pattern::PUB_SUB;
+
+	Methods methods = allowed(_uri_prefix);
+	for (int m = int(MethodCode::None)+1; m < int(MethodCode::EndOfValidMethods); ++m)
+	{
+		Method method = MethodCode(m);
+		if (methods.contains(method) && method.allowNoResponse()) result += Pattern::PUSH_PULL;
+	}
+	return result;
+}
+
+std::mutex &Reactor::_pathMutex(UriView uri) noexcept
+{
+	// Stripe on the path, ignoring any query or fragment.
+	std::string_view path = uri;
+	path = path.substr(0, path.find_first_of("?#"));
+	return _path_mutex[std::hash<std::string_view>()(path) % PathStripes];
+}
+
 void Reactor::_handle(Query query, nng::msg &&_msg)
 {
 	try
@@ -22,7 +43,13 @@ void Reactor::_handle(Query query, nng::msg &&_msg)
 			throw status_exceptions::BadGateway(_uri_prefix);
 
 
-		std::lock_guard g(_reactor_mutex);
+		std::unique_lock<std::mutex> lock;
+		switch (_concurrency)
+		{
+		case Concurrency::SERIALIZED: lock = std::unique_lock<std::mutex>(_reactor_mutex);            break;
+		case Concurrency::PER_PATH:   lock = std::unique_lock<std::mutex>(_pathMutex(request.uri())); break;
+		case Concurrency::CONCURRENT: break;
+		}
 
 		nng::msg rep;
 
@@ -6,11 +6,23 @@
 using namespace telling;
 
 
+/*
+	Two lines per service: route URI, then address.
+		Services not using every pattern append a tab and the pattern list.
+*/
+static void WriteEntry(std::ostream &body, std::string_view servicePath, std::string_view servicePath_alias, Patterns patterns)
+{
+	body << (servicePath_alias.length() ? servicePath_alias : servicePath)
+		<< "\n" << servicePath;
+	if (patterns != Patterns::All()) body << '\t' << patterns.toString();
+}
+
 class Registration::Delegate : public AsyncRequest
 {
 public:
-	STATUS         status = INITIAL;
-	nng::exception except  = nng::exception(nng::error::success);
+	STATUS                   status = INITIAL;
+	nng::exception           except  = nng::exception(nng::error::success);
+	std::vector<std::string> failed;
 
 	void async_prep (Requesting, nng::msg &query) final
 	{
@@ -25,6 +37,28 @@ public:
 
 		auto repStatus = reply.status();
 
+		/*
+			Batches with failures list "<status> <route URI>" per line.
+		*/
+		if (repStatus.code == HttpStatus::Code::MultiStatus)
+		{
+			auto text = reply.bodyString();
+			const char *pi = text.data(), *pe = pi+text.length();
+			while (pi != pe)
+			{
+				auto line  = detail::ConsumeLine(pi, pe);
+				auto space = line.find(' ');
+				if (space == std::string_view::npos) continue;
+
+				auto lineStatus = Status::Parse(line.substr(0, space));
+				if (!lineStatus.isSuccessful())
+				{
+					if (failed.empty()) repStatus = lineStatus;
+					failed.emplace_back(line.substr(space+1));
+				}
+			}
+		}
+
 		if (repStatus.isSuccessful())
 		{
 			status = ENLISTED;
@@ -75,17 +109,40 @@ public:
 Registration::Registration(
 	std::string_view servicePath,
 	std::string_view servicePath_alias,
-	std::string_view serverID) :
+	std::string_view serverID,
+	Patterns         patterns) :
 	delegate(std::make_shared<Delegate>()),
 	requester(delegate)
 {
 	requester.dial(HostAddress::Base::InProc(std::string(serverID) + "/register"));
 
-	if (!servicePath_alias.length()) servicePath_alias = servicePath;
+	MsgWriter msg = WriteRequest("*services", MethodCode::POST);
+	{
+		auto body = msg.writeBody();
+		WriteEntry(body, servicePath, servicePath_alias, patterns);
+	}
+
+	requester.request(msg.release());
+}
+
+Registration::Registration(
+	const std::vector<Entry> &entries,
+	std::string_view          serverID) :
+	delegate(std::make_shared<Delegate>()),
+	requester(delegate)
+{
+	requester.dial(HostAddress::Base::InProc(std::string(serverID) + "/register"));
 
 	MsgWriter msg = WriteRequest("*services", MethodCode::POST);
-	msg.writeBody()
-		<< servicePath_alias << "\n" << servicePath;
+	{
+		auto body = msg.writeBody();
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			auto &entry = entries[i];
+			if (i) body << "\n";
+			WriteEntry(body, entry.servicePath, entry.servicePath_alias, entry.patterns);
+		}
+	}
 
 	requester.request(msg.release());
 }
@@ -103,4 +160,9 @@ Registration::STATUS Registration::status() const noexcept
 const nng::exception &Registration::exception() const noexcept
 {
 	return delegate->except;
+}
+
+const std::vector<std::string> &Registration::failures() const noexcept
+{
+	return delegate->failed;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include <telling/service_reply.h>
+#include <telling/trace.h>
+#include <telling/alloc_tracking.h>
 #include <nngpp/protocol/rep0.h>
 
 
@@ -9,7 +11,22 @@ using namespace telling;
 	Reply implementation
 */
 
-void Reply::initialize(std::weak_ptr<AsyncReply> new_handler)
+struct Reply::Slot
+{
+	Reply                *comm  = nullptr;
+	unsigned              index = 0;
+	uint16_t              generation = 0;
+	std::atomic<QueryID>  pending = 0; // QueryID while awaiting a reply, else 0
+	QueryID               sending = 0; // QueryID while the reply is in flight
+	std::atomic<uint32_t> nextFree = 0;
+	nng::ctx              ctx;
+	nng::aio              aio_send;
+	bool                  traced = false; // The request carried a Trace header
+	Trace::Stamps         trace;
+	LatencyHistogram::Clock::time_point since; // When the request arrived
+};
+
+void Reply::initialize(std::weak_ptr<AsyncReply> new_handler, unsigned recvContexts)
 {
 	if (_handler.lock())
 		throw nng::exception(nng::error::busy, "Reply::initialize (already initialized)");
@@ -18,64 +35,174 @@ void Reply::initialize(std::weak_ptr<AsyncReply> new_handler)
 	if (!handler)
 		throw nng::exception(nng::error::closed, "Reply::initialize (handler is expired)");
 
+	if (recvContexts == 0) recvContexts = 1;
+
 	if (handler)
 	{
 		_handler = new_handler;
 
-		ctx_aio_recv = make_ctx();
-
-		aio_send = nng::make_aio(&_aioSent, this);
-		aio_recv = nng::make_aio(&_aioReceived, this);
-		ctx_aio_recv.recv(aio_recv);
+		receivers.reset(new Receiver[recvContexts]);
+		receiverCount = recvContexts;
+		for (unsigned i = 0; i < receiverCount; ++i)
+		{
+			auto &rcv = receivers[i];
+			rcv.comm = this;
+			rcv.ctx  = make_ctx();
+			rcv.aio  = nng::make_aio(&_aioReceived, &rcv);
+		}
+		for (unsigned i = 0; i < receiverCount; ++i)
+			receivers[i].ctx.recv(receivers[i].aio);
 	}
 }
 Reply::~Reply()
 {
-	for (auto id : unresponded)
+	for (unsigned i = 0; i < receiverCount; ++i) receivers[i].aio.stop();
+
+	// Stop sends in flight, then close all contexts.
+	if (auto *table = slotChunks.exchange(nullptr))
+	{
+		for (unsigned c = 0; c < slotChunkCount; ++c)
+		{
+			Slot *chunk = table[c].load(std::memory_order_acquire);
+			for (unsigned i = 0; i < SlotChunkSize; ++i) chunk[i].aio_send.stop();
+		}
+		for (unsigned c = 0; c < slotChunkCount; ++c)
+			delete[] table[c].exchange(nullptr);
+		delete[] table;
+	}
+
+	receivers.reset();
+}
+
+
+Reply::Slot *Reply::_slot(QueryID queryID) const noexcept
+{
+	auto *table = slotChunks.load(std::memory_order_acquire);
+	if (!table) return nullptr;
+
+	unsigned index = queryID & ((1u << SlotIndexBits) - 1);
+	Slot *chunk = table[index >> SlotChunkBits].load(std::memory_order_acquire);
+	return chunk ? &chunk[index & (SlotChunkSize-1)] : nullptr;
+}
+
+size_t Reply::footprint() const noexcept
+{
+	size_t bytes = sizeof(*this) + _sharedFootprint() + receiverCount * sizeof(Receiver);
+
+	std::lock_guard g(slotGrow_mtx);
+	if (slotChunkCount)
+		bytes += MaxSlotChunks * sizeof(std::atomic<Slot*>) + slotChunkCount * SlotChunkSize * sizeof(Slot);
+	return bytes;
+}
+
+Reply::Slot *Reply::_acquireSlot()
+{
+	while (true)
+	{
+		uint64_t head = slotFree.load(std::memory_order_acquire);
+		if (uint32_t top = uint32_t(head))
+		{
+			Slot *slot = _slot(top-1);
+			uint64_t next = ((head >> 32) + 1) << 32 | slot->nextFree.load(std::memory_order_relaxed);
+			if (slotFree.compare_exchange_weak(head, next, std::memory_order_acq_rel)) return slot;
+			continue;
+		}
+
+		// Free list is empty; allocate another chunk.
+		std::lock_guard g(slotGrow_mtx);
+		if (uint32_t(slotFree.load(std::memory_order_acquire))) continue;
+		if (slotChunkCount == MaxSlotChunks) return nullptr;
+
+		auto *table = slotChunks.load(std::memory_order_relaxed);
+		if (!table)
+		{
+			table = new std::atomic<Slot*>[MaxSlotChunks];
+			for (unsigned c = 0; c < MaxSlotChunks; ++c) table[c].store(nullptr, std::memory_order_relaxed);
+			slotChunks.store(table, std::memory_order_release);
+		}
+
+		unsigned c = slotChunkCount;
+		Slot *chunk = new Slot[SlotChunkSize];
+		for (unsigned i = 0; i < SlotChunkSize; ++i)
+		{
+			auto &slot = chunk[i];
+			slot.comm     = this;
+			slot.index    = (c << SlotChunkBits) + i;
+			slot.aio_send = nng::make_aio(&_aioSent, &slot);
+		}
+		table[c].store(chunk, std::memory_order_release);
+		slotChunkCount = c+1;
+
+		// Keep the first slot; free the rest.
+		for (unsigned i = SlotChunkSize; --i > 0;) _releaseSlot(&chunk[i]);
+		return &chunk[0];
+	}
+}
+
+void Reply::_releaseSlot(Slot *slot) noexcept
+{
+	uint64_t head = slotFree.load(std::memory_order_relaxed);
+	do
 	{
-		// Evil unpickling
-		nng_ctx ctx = {id};
-		nng_ctx_close(ctx);
+		slot->nextFree.store(uint32_t(head), std::memory_order_relaxed);
 	}
-	aio_send.stop();
-	aio_recv.stop();
-	aio_send = nng::aio();
-	aio_recv = nng::aio();
+	while (!slotFree.compare_exchange_weak(head,
+		((head >> 32) + 1) << 32 | (slot->index + 1), std::memory_order_release, std::memory_order_relaxed));
 }
 
-void Reply::_aioReceived(void *_comm)
+
+void Reply::_aioReceived(void *_receiver)
 {
-	auto comm = static_cast<Reply*>(_comm);
-	auto &ctx = comm->ctx_aio_recv;
-	auto queryID = ctx.get().id;
+	auto rcv  = static_cast<Receiver*>(_receiver);
+	auto comm = rcv->comm;
+	auto &ctx = rcv->ctx;
 	auto handler = comm->_handler.lock();
 
 	bool cancel = false;
 
 	// Call handler
-	auto error = comm->aio_recv.result();
+	auto error = rcv->aio.result();
 	if (!handler)
 	{
 		// No handler; terminate
-		comm->aio_recv.release_msg();
+		rcv->aio.release_msg();
 		cancel = true;
 	}
 	else switch (error)
 	{
 	case nng::error::success:
 		{
+			Slot *slot = comm->_acquireSlot();
+			if (!slot)
 			{
-				// Pickle the context into a QueryID and store it for later.
-				std::lock_guard g(comm->unresponded_mtx);
-				comm->unresponded.emplace(queryID);
-				ctx.release();
+				// Too many outstanding queries; drop this one.
+				rcv->aio.release_msg();
+				comm->metrics.countError();
+				handler->async_error(Replying{comm, 0}, nng::error::nomem);
+				break;
 			}
 
+			nng::msg request = rcv->aio.release_msg();
+			comm->metrics.countRecv(request.get());
+			slot->since = LatencyHistogram::Clock::now();
+
+			// Traced requests pass their stamps on to the reply.
+			slot->traced = Trace::Stamp(request, Trace::SERVICE_RECV) && Trace::Read(request, slot->trace);
+
+			// Hand the context over to the slot and publish its QueryID.
+			if (++slot->generation == 0) slot->generation = 1;
+			QueryID queryID = (QueryID(slot->generation) << SlotIndexBits) | slot->index;
+			slot->ctx = std::move(ctx);
+			slot->pending.store(queryID, std::memory_order_release);
+
 			// Deliver asynchronous event...
 			nng::msg responseMsg;
-			handler->async_recv(
-				Replying{comm, queryID, {&responseMsg}},
-				comm->aio_recv.release_msg());
+			{
+				TELLING_ALLOC_STAGE(HANDLER);
+				handler->async_recv(
+					Replying{comm, queryID, {&responseMsg}},
+					std::move(request));
+			}
 
 			// Responding through the tag
 			if (responseMsg)
@@ -88,16 +215,16 @@ void Reply::_aioReceived(void *_comm)
 	case nng::error::timedout:
 	default:
 		handler->async_error(
-			Replying{comm, ctx.get().id}, error);
+			Replying{comm, 0}, error);
 		cancel = true;
 		break;
 	}
 
 	if (!cancel)
 	{
-		// Create a new receive-context and receive another message.
-		ctx = comm->make_ctx();
-		ctx.recv(comm->aio_recv);
+		// Create a new receive-context if needed and receive another message.
+		if (!ctx) ctx = comm->make_ctx();
+		ctx.recv(rcv->aio);
 	}
 }
 
@@ -118,63 +245,55 @@ void Reply::respondTo(QueryID queryID, nng::msg &&msg)
 
 	if (!msg) return;
 
-	// Claim and erase the queryID
+	// Claim the query's slot.
+	Slot *slot = _slot(queryID);
+	QueryID expected = queryID;
+	if (!queryID || !slot || !slot->pending.compare_exchange_strong(expected, 0, std::memory_order_acquire))
+		throw nng::exception(nng::error::inval,
+			"respondTo: no outstanding request with this queryID");
+
+	if (slot->traced)
 	{
-		std::lock_guard g(unresponded_mtx);
-		if (unresponded.erase(queryID) == 0)
-			throw nng::exception(nng::error::inval,
-				"respondTo: no outstanding request with this queryID");
+		slot->trace[Trace::SERVICE_REPLY] = Trace::Now();
+		try                     {Trace::Write(msg, slot->trace);}
+		catch (nng::exception&) {} // Send untraced
 	}
 
-	// Unpickle the NNG context and turn it over to sender.
-	nng_ctx _ctx = {queryID};
+	metrics.countSend(msg.get());
+	metrics.recordLatencySince(slot->since);
 
-	// Send or enqueue the reply.
-	OutboxItem to_send = {nng::ctx(_ctx), std::move(msg)};
-	if (outbox.produce(std::move(to_send)))
-	{
-		// AIO processing continues
-	}
-	else
-	{
-		// Immediately claim the message
-		aio_send.set_msg(std::move(to_send.msg));
-		ctx_aio_send = std::move(to_send.ctx);
-		ctx_aio_send.send(aio_send);
-	}
+	// Send the reply on the query's context.
+	slot->sending = queryID;
+	slot->aio_send.set_msg(std::move(msg));
+	slot->ctx.send(slot->aio_send);
 }
 
-void Reply::_aioSent(void *_comm)
+void Reply::_aioSent(void *_slot)
 {
-	auto comm = static_cast<Reply*>(_comm);
+	auto slot = static_cast<Slot*>(_slot);
+	auto comm = slot->comm;
 	auto handler = comm->_handler.lock();
 
-	// Halt?
-	switch (comm->aio_send.result())
+	QueryID queryID = slot->sending;
+	auto    result  = slot->aio_send.result();
+
+	if (result != nng::error::success)
 	{
-	case nng::error::success:  break;
-	case nng::error::canceled:
-	case nng::error::timedout:
-	default:                   return;
+		// The reply was not taken; discard it.
+		nng::msg unsent(slot->aio_send.release_msg());
+		comm->metrics.countError();
+		if (handler && result != nng::error::canceled)
+			handler->async_error(Replying{comm, queryID}, result);
 	}
-
-	QueryID queryID = comm->ctx_aio_send.get().id;
-	handler->async_sent(Replying{comm, queryID});
-
+	else if (handler)
 	{
-		OutboxItem next;
-		if (comm->outbox.consume(next))
-		{
-			// Transmit another message
-			comm->aio_send.set_msg(std::move(next.msg));
-			comm->ctx_aio_send   = std::move(next.ctx);
-			comm->ctx_aio_send.send(comm->aio_send);
-		}
-		else
-		{
-			// AIO sequence completes
-		}
+		handler->async_sent(Replying{comm, queryID});
 	}
+
+	// Close the context and recycle the slot.
+	slot->ctx     = nng::ctx();
+	slot->sending = 0;
+	comm->_releaseSlot(slot);
 }
 
 
@@ -220,6 +339,11 @@ Reply_Box::~Reply_Box()
 {
 }
 
+size_t Reply_Box::footprint() const noexcept
+{
+	return Reply::footprint() + (sizeof(Reply_Box) - sizeof(Reply)) + sizeof(Delegate);
+}
+
 void Reply_Box::_init()
 {
 	initialize(_replyBox = std::make_shared<Delegate>());
@@ -245,6 +369,24 @@ bool Reply_Box::receive(nng::msg  &request)
 	else return false;
 }
 
+size_t Reply_Box::receiveBatch(MsgBatch &batch, size_t max)
+{
+	if (!isReady())
+		throw nng::exception(nng::error::closed, "Reply Communicator is not ready.");
+
+	if (current_query != 0)
+		throw nng::exception(nng::error::state,
+			"Reply: must reply before receiving a new message.");
+
+	size_t first = batch.size();
+	size_t n = _replyBox->inbox.pull_n(max, [&](Delegate::Pending &&pending)
+	{
+		batch._append(std::move(pending.msg), pending.id);
+	});
+	batch._parse(first);
+	return n;
+}
+
 void Reply_Box::respond(nng::msg &&msg)
 {
 	if (!isReady())
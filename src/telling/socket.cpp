@@ -1,5 +1,6 @@
 #define SOCKET_LOGGING 0
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <mutex>
@@ -50,12 +51,26 @@ Socket::ListenerOrDialer::ListenerOrDialer(nng::listener &&listener)
 }
 Socket::ListenerOrDialer::~ListenerOrDialer()
 {
+	if (!handle.id) return;
 	if (isListener)
 		reinterpret_cast<nng::listener&>(handle).~listener();
 	else
 		reinterpret_cast<nng::dialer  &>(handle).~dialer();
 }
 
+Socket::ListenerOrDialer::ListenerOrDialer(ListenerOrDialer &&other) noexcept :
+	isListener(other.isListener), handle(other.handle)
+{
+	other.handle.id = 0;
+}
+Socket::ListenerOrDialer &Socket::ListenerOrDialer::operator=(ListenerOrDialer &&other) noexcept
+{
+	// The old handle is closed when `other` is destroyed.
+	std::swap(isListener, other.isListener);
+	std::swap(handle,     other.handle);
+	return *this;
+}
+
 Socket::ListenerOrDialer::operator bool() const noexcept
 {
 	return handle.id != 0;
@@ -197,36 +212,48 @@ void Socket::_pipeCallback(nng_pipe _pipe, nng_pipe_ev _event, void *_self)
 
 
 
+std::vector<Socket::Connector>::iterator Socket::_findConnector(std::string_view uri) noexcept
+{
+	return std::find_if(_connectors.begin(), _connectors.end(),
+		[&](const Connector &c) {return c.uri == uri;});
+}
+
 void Socket::dial(const std::string &uri)
 {
 	std::lock_guard g(_mtx);
 	if (!_socket) throw nng::exception(nng::error::closed, "The socket is not open.");
 
-	auto p = _connectors.emplace(uri, nng::make_dialer  (_socket, uri.c_str(), nng::flag::nonblock));
+	// Already connected to this address
+	if (_findConnector(uri) != _connectors.end()) return;
+
+	_connectors.push_back(Connector{uri, nng::make_dialer  (_socket, uri.c_str(), nng::flag::nonblock)});
 
-	LogSocketEvent(*this, "DIAL", uri, p.first->second.id());
+	LogSocketEvent(*this, "DIAL", uri, _connectors.back().handle.id());
 }
 void Socket::listen(const std::string &uri)
 {
 	std::lock_guard g(_mtx);
 	if (!_socket) throw nng::exception(nng::error::closed, "The socket is not open.");
 
-	auto p = _connectors.emplace(uri, nng::make_listener(_socket, uri.c_str(), nng::flag::nonblock));
+	if (_findConnector(uri) != _connectors.end()) return;
 
-	LogSocketEvent(*this, "LISTEN", uri, p.first->second.id());
+	_connectors.push_back(Connector{uri, nng::make_listener(_socket, uri.c_str(), nng::flag::nonblock)});
+
+	LogSocketEvent(*this, "LISTEN", uri, _connectors.back().handle.id());
 }
 
 void Socket::disconnect(const std::string &uri) noexcept
 {
 	std::lock_guard g(_mtx);
-#if SOCKET_LOGGING
-	{
-		auto p = _connectors.find(uri);
-		LogSocketEvent(*this, "DISCONN", uri, p->second.id());
-	}
-#endif
 
-	_connectors.erase(uri);
+	auto pos = _findConnector(uri);
+	if (pos == _connectors.end()) return;
+
+	LogSocketEvent(*this, "DISCONN", uri, pos->handle.id());
+
+	// Order doesn't matter; move the last connector into the gap.
+	if (pos+1 != _connectors.end()) *pos = std::move(_connectors.back());
+	_connectors.pop_back();
 }
 
 void Socket::disconnectAll() noexcept
@@ -235,4 +262,15 @@ void Socket::disconnectAll() noexcept
 	LogSocketEvent(*this, "DISCONN", "(ALL)");
 
 	_connectors.clear();
+	_connectors.shrink_to_fit();
+}
+
+size_t Socket::footprint() const noexcept
+{
+	std::lock_guard g(_mtx);
+
+	size_t bytes = sizeof(Socket) + _connectors.capacity() * sizeof(Connector);
+	for (auto &c : _connectors)
+		if (c.uri.capacity() > std::string().capacity()) bytes += c.uri.capacity() + 1;
+	return bytes;
 }
@@ -0,0 +1,207 @@
+#include <chrono>
+#include <cstring>
+
+#include <telling/trace.h>
+#include <telling/msg_util.h>
+
+
+using namespace telling;
+
+
+namespace
+{
+	const char  HeaderPrefix[] = "Trace:";
+	const size_t PrefixSize    = sizeof(HeaderPrefix) - 1;
+
+	const char HeaderName[] = "Trace";
+
+	// In binary framing, find the header table size; the Trace entry comes first in the table.
+	char *FindBinaryTable(char *data, size_t size) noexcept
+	{
+		const char *pos = data;
+		if (!detail::SkipBinaryStart(pos, data + size) || data + size - pos < 2) return nullptr;
+		return data + (pos - data);
+	}
+
+	// Find the first entry of the header table, past any dictionary prefix.  Entries in indexed tables begin with a code.
+	char *FindBinaryEntries(char *data, size_t size, char *table, bool &indexed) noexcept
+	{
+		const char *pos = table + 2, *end = data + size;
+		uint8_t  id;
+		uint16_t fingerprint;
+		indexed = uint8_t(data[1]) & detail::BinaryIndexed;
+		if (indexed && !detail::ReadBinaryDictionary(pos, end, id, fingerprint)) return nullptr;
+		return data + (pos - data);
+	}
+
+	char *FindBinaryValue(char *data, size_t size) noexcept
+	{
+		char *table = FindBinaryTable(data, size);
+		if (!table) return nullptr;
+
+		bool indexed;
+		const char *pos = FindBinaryEntries(data, size, table, indexed), *end = data + size;
+		if (!pos) return nullptr;
+
+		// Traces are always literal entries (code 0) in indexed tables.
+		if (indexed && (pos == end || *pos++ != 0)) return nullptr;
+
+		std::string_view name, value;
+		if (!detail::ReadBinaryString(pos, end, name) || name != HeaderName
+			|| !detail::ReadBinaryString(pos, end, value) || value.size() != Trace::ValueSize)
+			return nullptr;
+		return data + (value.data() - data);
+	}
+
+	/*
+		Locate the Trace header value, which must directly follow the start-line.
+			Only the start-line is scanned, so untraced messages cost little.
+	*/
+	char *FindValue(nng_msg *msg) noexcept
+	{
+		if (!msg) return nullptr;
+
+		char  *data = static_cast<char*>(nng_msg_body(msg));
+		size_t size = nng_msg_len(msg);
+
+		if (detail::IsBinaryFrame(data, size)) return FindBinaryValue(data, size);
+
+		auto nl = static_cast<char*>(std::memchr(data, '\n', size));
+		if (!nl) return nullptr;
+
+		char  *header = nl + 1;
+		size_t rest   = size - size_t(header - data);
+		if (rest < PrefixSize + Trace::ValueSize || std::memcmp(header, HeaderPrefix, PrefixSize) != 0)
+			return nullptr;
+
+		char *value = header + PrefixSize;
+		for (unsigned i = 1; i < Trace::HOP_COUNT; ++i)
+			if (value[i * (Trace::FieldWidth+1) - 1] != '.') return nullptr;
+		return value;
+	}
+
+	void WriteField(char *field, uint64_t stamp) noexcept
+	{
+		static const char digits[] = "0123456789abcdef";
+		for (size_t i = Trace::FieldWidth; i--; stamp >>= 4) field[i] = digits[stamp & 15];
+	}
+
+	uint64_t ReadField(const char *field) noexcept
+	{
+		uint64_t stamp = 0;
+		for (size_t i = 0; i < Trace::FieldWidth; ++i)
+		{
+			char c = field[i];
+			unsigned d = (c >= '0' && c <= '9') ? unsigned(c - '0')
+				: (c >= 'a' && c <= 'f') ? unsigned(c - 'a' + 10)
+				: (c >= 'A' && c <= 'F') ? unsigned(c - 'A' + 10) : 0;
+			stamp = (stamp << 4) | d;
+		}
+		return stamp;
+	}
+}
+
+
+uint64_t Trace::Now() noexcept
+{
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// Stamps wrap after about 9 years of uptime; zero is reserved.
+	uint64_t stamp = uint64_t(us) & ((uint64_t(1) << (4*FieldWidth)) - 1);
+	return stamp ? stamp : 1;
+}
+
+bool Trace::Stamp(nng::msg &msg, HOP hop) noexcept
+{
+	char *value = FindValue(msg.get());
+	if (!value) return false;
+
+	WriteField(value + hop * (FieldWidth+1), Now());
+	return true;
+}
+
+bool Trace::Read(const nng::msg &msg, Stamps &stamps) noexcept
+{
+	const char *value = FindValue(msg.get());
+	if (!value) return false;
+
+	for (unsigned i = 0; i < HOP_COUNT; ++i) stamps[i] = ReadField(value + i * (FieldWidth+1));
+	return true;
+}
+
+void Trace::Format(char *value, const Stamps &stamps) noexcept
+{
+	for (unsigned i = 0; i < HOP_COUNT; ++i)
+	{
+		WriteField(value + i * (FieldWidth+1), stamps[i]);
+		if (i) value[i * (FieldWidth+1) - 1] = '.';
+	}
+}
+
+void Trace::Write(nng::msg &msg, const Stamps &stamps)
+{
+	if (char *value = FindValue(msg.get()))
+	{
+		Format(value, stamps);
+		return;
+	}
+
+	char  *data = static_cast<char*>(nng_msg_body(msg.get()));
+	size_t size = nng_msg_len(msg.get());
+
+	if (detail::IsBinaryFrame(data, size))
+	{
+		bool  indexed = false;
+		char *table   = FindBinaryTable(data, size);
+		char *entries = table ? FindBinaryEntries(data, size, table, indexed) : nullptr;
+		if (!entries) throw nng::exception(nng::error::inval, "Trace::Write (malformed binary frame)");
+
+		// Insert the entry at the front of the header table, as a literal if the table is indexed.
+		size_t sizeAt    = size_t(table - data);
+		size_t offset    = size_t(entries - data);
+		size_t length    = 2 + (sizeof(HeaderName)-1) + ValueSize + (indexed ? 1 : 0);
+		size_t tableSize = uint8_t(table[0]) | (size_t(uint8_t(table[1])) << 8);
+		if (sizeAt + 2 + tableSize + length > 0xFFFF)
+			throw nng::exception(nng::error::nospc, "Trace::Write (headers too large)");
+
+		if (int err = nng_msg_realloc(msg.get(), size + length))
+			throw nng::exception(nng::error(err), "Trace::Write (resize)");
+		data = static_cast<char*>(nng_msg_body(msg.get()));
+		std::memmove(data + offset + length, data + offset, size - offset);
+
+		tableSize += length;
+		data[sizeAt]   = char(uint8_t(tableSize));
+		data[sizeAt+1] = char(uint8_t(tableSize >> 8));
+
+		// Both lengths fit in one varint byte.
+		static_assert(ValueSize < 0x80, "Trace value length must be a one-byte varint");
+		char *entry = data + offset;
+		if (indexed) *entry++ = 0;
+		entry[0] = char(sizeof(HeaderName)-1);
+		std::memcpy(entry + 1, HeaderName, sizeof(HeaderName)-1);
+		entry[sizeof(HeaderName)] = char(ValueSize);
+		Format(entry + sizeof(HeaderName) + 1, stamps);
+		return;
+	}
+
+	auto nl = static_cast<char*>(std::memchr(data, '\n', size));
+	if (!nl) throw nng::exception(nng::error::inval, "Trace::Write (no start-line)");
+
+	// Match the start-line's newline.
+	bool   crlf   = (nl > data && nl[-1] == '\r');
+	size_t offset = size_t(nl + 1 - data);
+	size_t length = PrefixSize + ValueSize + (crlf ? 2 : 1);
+
+	// Make room after the start-line.
+	if (int err = nng_msg_realloc(msg.get(), size + length))
+		throw nng::exception(nng::error(err), "Trace::Write (resize)");
+	data = static_cast<char*>(nng_msg_body(msg.get()));
+	std::memmove(data + offset + length, data + offset, size - offset);
+
+	char *header = data + offset;
+	std::memcpy(header, HeaderPrefix, PrefixSize);
+	Format(header + PrefixSize, stamps);
+	if (crlf) header[length-2] = '\r';
+	header[length-1] = '\n';
+}